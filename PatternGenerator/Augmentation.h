@@ -0,0 +1,482 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <random>
+
+using namespace std;
+
+/************************************************************
+#############################################################
+#   Bit Canvas Class
+#############################################################
+#
+#   A pattern held as bits, 64 pixels to a word. Every row
+#	starts on a new word so whole rows can be shifted, ORed
+#	and ANDed a word at a time. Pixel x of a row is bit
+#	(x % 64) of word (x / 64). Bits past the width are
+#	always kept at 0.
+#
+#	Operations read from a source canvas and write into
+#	this one, so callers ping-pong between two canvases.
+************************************************************/
+class BitCanvas {
+private:
+	int height = 0;				/* rows */
+	int width = 0;				/* pixels per row */
+	int wordsPerRow = 0;		/* words per row */
+	uint64_t lastWordMask = 0;	/* valid bits of the last word in a row */
+	uint64_t* words = nullptr;	/* height * wordsPerRow words */
+	uint64_t* scratch = nullptr;	/* one row of working space */
+
+	/* reverses the bits of a word */
+	static uint64_t ReverseBits(uint64_t v) {
+		v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+		v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+		v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+		v = ((v >> 8) & 0x00FF00FF00FF00FFULL) | ((v & 0x00FF00FF00FF00FFULL) << 8);
+		v = ((v >> 16) & 0x0000FFFF0000FFFFULL) | ((v & 0x0000FFFF0000FFFFULL) << 16);
+		return (v >> 32) | (v << 32);
+	}
+
+	/* transposes a 64x64 bit block in place - bit j of a[i] swaps with bit i of a[j] */
+	static void Transpose64(uint64_t a[64]) {
+		uint64_t m = 0x00000000FFFFFFFFULL;
+		for (int j = 32; j != 0; j >>= 1, m ^= (m << j)) {
+			for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+				uint64_t t = ((a[k] >> j) ^ a[k | j]) & m;
+				a[k] ^= (t << j);
+				a[k | j] ^= t;
+			}
+		}
+	}
+
+	/**************************************************************
+	* ShiftRow
+	***************************************************************
+	* Writes src (srcWords long) into dst (dstWords long) moved
+	* dx pixels to the right (left when negative). Anything
+	* shifted past either end is dropped and the gap is 0.
+	**************************************************************/
+	static void ShiftRow(const uint64_t* src, const int& srcWords, uint64_t* dst, const int& dstWords, const int& dx) {
+		int wordShift = (dx >= 0) ? (dx / 64) : -((-dx + 63) / 64);
+		int bitShift = dx - (wordShift * 64);	/* always 0 - 63 */
+		for (int k = 0; k < dstWords; k++) {
+			int s = k - wordShift;
+			uint64_t low = (s >= 0 && s < srcWords) ? src[s] : 0;
+			uint64_t carry = (s - 1 >= 0 && s - 1 < srcWords) ? src[s - 1] : 0;
+			dst[k] = (bitShift == 0) ? low : ((low << bitShift) | (carry >> (64 - bitShift)));
+		}
+	}
+
+	uint64_t* Row(const int& r) { return words + ((size_t)r * wordsPerRow); }
+	const uint64_t* Row(const int& r) const { return words + ((size_t)r * wordsPerRow); }
+
+	/* clears the bits past the width on every row */
+	void MaskRows() {
+		for (int r = 0; r < height; r++) {
+			Row(r)[wordsPerRow - 1] &= lastWordMask;
+		}
+	}
+
+public:
+	BitCanvas(const int& height, const int& width)
+		: height(height), width(width), wordsPerRow((width + 63) / 64) {
+		if (wordsPerRow == 0) {
+			wordsPerRow = 1;
+		}
+		lastWordMask = ((width % 64) == 0) ? ~0ULL : ((1ULL << (width % 64)) - 1);
+		words = new uint64_t[(size_t)height * wordsPerRow]();
+		scratch = new uint64_t[wordsPerRow]();
+	}
+	BitCanvas(const BitCanvas& copy) = delete;
+	void operator=(const BitCanvas& copy) = delete;
+	~BitCanvas() {
+		delete[] words;
+		delete[] scratch;
+	}
+
+	int GetHeight() const { return height; }
+	int GetWidth() const { return width; }
+
+	/* reads a packed record (see PatternStream) */
+	void LoadPacked(const unsigned char* packed) {
+		size_t totalBytes = (((size_t)height * width) + 7) / 8;
+		for (int r = 0; r < height; r++) {
+			uint64_t* row = Row(r);
+			for (int k = 0; k < wordsPerRow; k++) {
+				size_t start = ((size_t)r * width) + ((size_t)k * 64);
+				size_t byte = start >> 3;
+				int shift = (int)(start & 7);
+				uint64_t low = 0;
+				for (int i = 0; i < 8 && byte + i < totalBytes; i++) {
+					low |= (uint64_t)packed[byte + i] << (8 * i);
+				}
+				uint64_t extra = (byte + 8 < totalBytes) ? packed[byte + 8] : 0;
+				row[k] = (shift == 0) ? low : ((low >> shift) | (extra << (64 - shift)));
+			}
+			/* the last word picked up the start of the next row */
+			row[wordsPerRow - 1] &= lastWordMask;
+		}
+	}
+
+	/* writes a packed record (see PatternStream) */
+	void StorePacked(unsigned char* packed) const {
+		size_t totalBytes = (((size_t)height * width) + 7) / 8;
+		memset(packed, 0, totalBytes);
+		for (int r = 0; r < height; r++) {
+			const uint64_t* row = Row(r);
+			for (int k = 0; k < wordsPerRow; k++) {
+				size_t start = ((size_t)r * width) + ((size_t)k * 64);
+				size_t byte = start >> 3;
+				int shift = (int)(start & 7);
+				uint64_t low = row[k] << shift;
+				uint64_t high = (shift == 0) ? 0 : (row[k] >> (64 - shift));
+				for (int i = 0; i < 8 && byte + i < totalBytes; i++) {
+					packed[byte + i] |= (unsigned char)(low >> (8 * i));
+				}
+				if (byte + 8 < totalBytes) {
+					packed[byte + 8] |= (unsigned char)high;
+				}
+			}
+		}
+	}
+
+	/* copies a canvas of the same size */
+	void CopyFrom(const BitCanvas& src) {
+		memcpy(words, src.words, sizeof(uint64_t) * (size_t)height * wordsPerRow);
+	}
+
+	/**************************************************************
+	* PlaceFrom
+	***************************************************************
+	* Draws src with its top left corner at (dy, dx) and clears
+	* everything else. src can be any size - this is translation
+	* when the sizes match and a centered crop/pad when they
+	* do not.
+	**************************************************************/
+	void PlaceFrom(const BitCanvas& src, const int& dy, const int& dx) {
+		for (int r = 0; r < height; r++) {
+			int s = r - dy;
+			if (s < 0 || s >= src.height) {
+				memset(Row(r), 0, sizeof(uint64_t) * wordsPerRow);
+				continue;
+			}
+			ShiftRow(src.Row(s), src.wordsPerRow, Row(r), wordsPerRow, dx);
+		}
+		MaskRows();
+	}
+
+	/* mirrors left to right */
+	void FlipHorizontal(const BitCanvas& src) {
+		int spare = (wordsPerRow * 64) - width;
+		for (int r = 0; r < height; r++) {
+			const uint64_t* in = src.Row(r);
+			for (int k = 0; k < wordsPerRow; k++) {
+				scratch[k] = ReverseBits(in[wordsPerRow - 1 - k]);
+			}
+			/* the reversed row starts with the unused bits - shift them out */
+			ShiftRow(scratch, wordsPerRow, Row(r), wordsPerRow, -spare);
+		}
+		MaskRows();
+	}
+
+	/* mirrors top to bottom */
+	void FlipVertical(const BitCanvas& src) {
+		for (int r = 0; r < height; r++) {
+			memcpy(Row(r), src.Row(height - 1 - r), sizeof(uint64_t) * wordsPerRow);
+		}
+	}
+
+	/* swaps rows and columns 64x64 bits at a time - this canvas must be src.width x src.height */
+	void Transpose(const BitCanvas& src) {
+		uint64_t block[64];
+		for (int rowBlock = 0; rowBlock < src.height; rowBlock += 64) {
+			for (int k = 0; k < src.wordsPerRow; k++) {
+				for (int t = 0; t < 64; t++) {
+					block[t] = (rowBlock + t < src.height) ? src.Row(rowBlock + t)[k] : 0;
+				}
+				Transpose64(block);
+				for (int t = 0; t < 64 && (k * 64) + t < height; t++) {
+					Row((k * 64) + t)[rowBlock / 64] = block[t];
+				}
+			}
+		}
+		MaskRows();
+	}
+
+	/* shifts every row right by factor * (row - center) pixels - one pass of a shear rotation */
+	void ShearRows(const BitCanvas& src, const double& factor, const double& center) {
+		for (int r = 0; r < height; r++) {
+			int dx = (int)floor((factor * (r - center)) + 0.5);
+			ShiftRow(src.Row(r), wordsPerRow, Row(r), wordsPerRow, dx);
+		}
+		MaskRows();
+	}
+
+	/* grows every shape by one pixel (3x3 square) */
+	void Dilate(const BitCanvas& src) {
+		for (int r = 0; r < height; r++) {
+			uint64_t* out = Row(r);
+			for (int k = 0; k < wordsPerRow; k++) {
+				out[k] = 0;
+			}
+			for (int s = r - 1; s <= r + 1; s++) {
+				if (s < 0 || s >= height) {
+					continue;
+				}
+				const uint64_t* in = src.Row(s);
+				for (int k = 0; k < wordsPerRow; k++) {
+					uint64_t left = (k > 0) ? in[k - 1] : 0;
+					uint64_t right = (k + 1 < wordsPerRow) ? in[k + 1] : 0;
+					out[k] |= in[k] | (in[k] << 1) | (left >> 63) | (in[k] >> 1) | (right << 63);
+				}
+			}
+		}
+		MaskRows();
+	}
+
+	/* shrinks every shape by one pixel (3x3 square) - pixels off the canvas count as empty */
+	void Erode(const BitCanvas& src) {
+		for (int r = 0; r < height; r++) {
+			uint64_t* out = Row(r);
+			for (int k = 0; k < wordsPerRow; k++) {
+				out[k] = ~0ULL;
+			}
+			for (int s = r - 1; s <= r + 1; s++) {
+				if (s < 0 || s >= height) {
+					for (int k = 0; k < wordsPerRow; k++) {
+						out[k] = 0;
+					}
+					break;
+				}
+				const uint64_t* in = src.Row(s);
+				for (int k = 0; k < wordsPerRow; k++) {
+					/* pixels past the width are 0, so the right edge erodes like the others */
+					uint64_t left = (k > 0) ? in[k - 1] : 0;
+					uint64_t right = (k + 1 < wordsPerRow) ? in[k + 1] : 0;
+					out[k] &= in[k] & ((in[k] << 1) | (left >> 63)) & ((in[k] >> 1) | (right << 63));
+				}
+			}
+		}
+		MaskRows();
+	}
+
+	/**************************************************************
+	* AddNoise
+	***************************************************************
+	* Salt and pepper in place: each pixel is turned on with
+	* probability / 2 and off with probability / 2. Masks are
+	* built a word at a time from the binary expansion of the
+	* probability (8 bits) - an AND of two random words is 1/4,
+	* an OR is 3/4 and so on.
+	**************************************************************/
+	void AddNoise(const double& probability, mt19937_64& engine) {
+		int level = (int)floor((probability * 0.5 * 256.0) + 0.5);
+		if (level <= 0) {
+			return;
+		}
+		if (level > 255) {
+			level = 255;
+		}
+		for (int r = 0; r < height; r++) {
+			uint64_t* row = Row(r);
+			for (int k = 0; k < wordsPerRow; k++) {
+				uint64_t salt = 0;
+				uint64_t pepper = 0;
+				for (int b = 0; b < 8; b++) {
+					uint64_t s = engine();
+					uint64_t p = engine();
+					salt = ((level >> b) & 1) ? (salt | s) : (salt & s);
+					pepper = ((level >> b) & 1) ? (pepper | p) : (pepper & p);
+				}
+				row[k] = (row[k] | salt) & ~pepper;
+			}
+		}
+		MaskRows();
+	}
+};
+/************************************************************
+* ///////////////////////////|\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\
+* \\\\\\\\\\\\\\\\\\\\\\\\\\\|///////////////////////////////
+************************************************************/
+
+
+/************************************************************
+#############################################################
+#   Augmentation Settings
+#############################################################
+#
+#   Which random changes are made to each variant. Every
+#	change is drawn independently per variant.
+************************************************************/
+struct AugmentationSettings {
+	int variantsPerPattern = 0;			/* K variants per generated pattern - 0 turns augmentation off */
+	bool keepOriginal = true;			/* also hand out the unchanged pattern */
+	int maxTranslation = 0;				/* largest shift in pixels along each axis */
+	bool rotate90 = false;				/* random quarter turns (cropped/padded back to size when not square) */
+	double maxRotationDegrees = 0.0;	/* largest rotation either way on top of the quarter turns */
+	bool flipHorizontal = false;		/* mirror left to right half the time */
+	bool flipVertical = false;			/* mirror top to bottom half the time */
+	double noiseProbability = 0.0;		/* chance a pixel is replaced with salt or pepper */
+	double morphologyProbability = 0.0;	/* chance of a one pixel dilate or erode (even odds) */
+};
+
+/************************************************************
+#############################################################
+#   Pattern Augmenter Class
+#############################################################
+#
+#   Turns one packed pattern into random variants of the
+#	same size. Everything runs on BitCanvas so the work is
+#	a word (64 pixels) at a time:
+#		flips		- bit reversal / row swaps
+#		quarter turns	- 64x64 block transposes
+#		rotations	- three shears (rows shifted by a
+#					  varying amount, the middle one on
+#					  the transposed canvas)
+#		translation	- row shifts
+#		dilate/erode	- shifted ORs / ANDs of 3 rows
+#		noise		- masks built from random words
+#
+#	Variants only depend on the seed, so a seeded stream
+#	hands out the same data set every time.
+************************************************************/
+class PatternAugmenter {
+private:
+	AugmentationSettings settings;	/* what to change */
+	int height = 0;					/* height of the patterns */
+	int width = 0;					/* width of the patterns */
+	mt19937_64 engine;				/* random engine for every draw */
+
+	BitCanvas* front = nullptr;		/* current state of the variant */
+	BitCanvas* back = nullptr;		/* target of the next step */
+	BitCanvas* tall = nullptr;		/* width x height canvas for transposed steps */
+	BitCanvas* tallBack = nullptr;	/* second transposed canvas */
+
+	/* makes back the current canvas */
+	void Flip() {
+		BitCanvas* t = front;
+		front = back;
+		back = t;
+	}
+
+	/* rotates front by a small angle with three shears */
+	void Shear(const double& radians) {
+		double a = -tan(radians / 2.0);
+		double b = sin(radians);
+		back->ShearRows(*front, a, (height - 1) / 2.0);
+		tall->Transpose(*back);
+		tallBack->ShearRows(*tall, b, (width - 1) / 2.0);
+		front->Transpose(*tallBack);
+		back->ShearRows(*front, a, (height - 1) / 2.0);
+		Flip();
+	}
+
+	/* quarter turns of front - 1 is clockwise */
+	void QuarterTurns(const int& turns) {
+		if (turns == 2) {
+			back->FlipHorizontal(*front);
+			front->FlipVertical(*back);
+			return;
+		}
+		tall->Transpose(*front);
+		if (turns == 1) {
+			tallBack->FlipHorizontal(*tall);
+		}
+		else {
+			tallBack->FlipVertical(*tall);
+		}
+		front->PlaceFrom(*tallBack, (height - width) / 2, (width - height) / 2);
+	}
+
+public:
+	PatternAugmenter(const AugmentationSettings& settings, const int& height, const int& width, const unsigned int& seed)
+		: settings(settings), height(height), width(width), engine(seed) {
+		front = new BitCanvas(height, width);
+		back = new BitCanvas(height, width);
+		tall = new BitCanvas(width, height);
+		tallBack = new BitCanvas(width, height);
+	}
+	PatternAugmenter(const PatternAugmenter& copy) = delete;
+	void operator=(const PatternAugmenter& copy) = delete;
+	~PatternAugmenter() {
+		delete front;
+		delete back;
+		delete tall;
+		delete tallBack;
+	}
+
+	/* starts the random draws over */
+	void Seed(const unsigned int& seed) {
+		engine.seed(seed);
+	}
+
+	int GetVariantsPerPattern() const { return settings.variantsPerPattern; }
+	bool KeepOriginal() const { return settings.keepOriginal; }
+
+	/**************************************************************
+	* Augment
+	***************************************************************
+	* Writes one random variant of packedIn into packedOut (both
+	* height * width packed records, see PatternStream)
+	**************************************************************/
+	void Augment(const unsigned char* packedIn, unsigned char* packedOut) {
+		uniform_real_distribution<double> unit(0.0, 1.0);
+		front->LoadPacked(packedIn);
+
+		if (settings.flipHorizontal && (engine() & 1)) {
+			back->FlipHorizontal(*front);
+			Flip();
+		}
+		if (settings.flipVertical && (engine() & 1)) {
+			back->FlipVertical(*front);
+			Flip();
+		}
+		if (settings.rotate90) {
+			int turns = (int)(engine() % 4);
+			if (turns != 0) {
+				QuarterTurns(turns);
+			}
+		}
+		if (settings.maxRotationDegrees > 0.0) {
+			double degrees = ((unit(engine) * 2.0) - 1.0) * settings.maxRotationDegrees;
+			/* large angles are quarter turns plus a shear of at most 45 degrees */
+			int turns = (int)floor((degrees / 90.0) + 0.5);
+			degrees -= turns * 90.0;
+			turns = ((turns % 4) + 4) % 4;
+			if (turns != 0) {
+				QuarterTurns(turns);
+			}
+			if (degrees != 0.0) {
+				Shear(degrees * 3.14159265358979323846 / 180.0);
+			}
+		}
+		if (settings.maxTranslation > 0) {
+			int range = (2 * settings.maxTranslation) + 1;
+			int dy = (int)(engine() % range) - settings.maxTranslation;
+			int dx = (int)(engine() % range) - settings.maxTranslation;
+			back->PlaceFrom(*front, dy, dx);
+			Flip();
+		}
+		if (settings.morphologyProbability > 0.0 && unit(engine) < settings.morphologyProbability) {
+			if (engine() & 1) {
+				back->Dilate(*front);
+			}
+			else {
+				back->Erode(*front);
+			}
+			Flip();
+		}
+		if (settings.noiseProbability > 0.0) {
+			front->AddNoise(settings.noiseProbability, engine);
+		}
+
+		front->StorePacked(packedOut);
+	}
+};
+/************************************************************
+* ///////////////////////////|\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\
+* \\\\\\\\\\\\\\\\\\\\\\\\\\\|///////////////////////////////
+************************************************************/
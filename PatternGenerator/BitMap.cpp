@@ -1,6 +1,6 @@
 #include <iostream>
 #include <fstream>
-#include "bitmap.h"
+#include "BitMap.h"
 #include <cstdlib>
 
 typedef unsigned char uchar_t;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Array.h"
+#include <cmath>
 
 using namespace std;
 
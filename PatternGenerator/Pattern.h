@@ -40,7 +40,7 @@ enum PatternType
 };
 
 /* Helper function to return the number of scales a pattern requires */
-int GetScalesForPattern(const PatternType &pt) {
+inline int GetScalesForPattern(const PatternType &pt) {
 	switch (pt) {
 	case(SQUARE): case(HORIZONTAL_STRIPES): case(VERTICAL_STRIPES): case(CIRCLE): case(STAR) : case(HEART): case(CAT): { return 1;}
 	case(RECTANGLE): case(DIAMOND): case(CROSS): case(CRESCENT):case(SPIKE): case(ARROW): case(TILDE): case(ZIGZAG): case(CANE): { return 2; }
@@ -55,7 +55,7 @@ int GetScalesForPattern(const PatternType &pt) {
 }
 
 /* Helper function to get the name of a pattern as a string */
-string GetNameForPattern(const PatternType& pt) {
+inline string GetNameForPattern(const PatternType& pt) {
 	switch (pt) {
 	case(SQUARE): { return "Square"; }
 	case(HORIZONTAL_STRIPES): { return "HorizontalStripe"; }
@@ -84,6 +84,15 @@ string GetNameForPattern(const PatternType& pt) {
 	return "";
 }
 
+/* Helper function to get a pattern from its name - inverse of GetNameForPattern */
+inline PatternType GetPatternForName(const string& name) {
+	for (int pt = SQUARE; pt < DEFAULT_PATTERN; pt++) {
+		if (GetNameForPattern((PatternType)pt) == name) {
+			return (PatternType)pt;
+		}
+	}
+	return DEFAULT_PATTERN;
+}
 
 /**************************************************************
 * SpecialProcessing
@@ -99,7 +108,7 @@ string GetNameForPattern(const PatternType& pt) {
 * Currently stripes are excluded from this because they will not be used in the first
 * iteration of this project
 **************************************************************/
-bool SpecialProcessing(const PatternType& pt) {
+inline bool SpecialProcessing(const PatternType& pt) {
 	switch(pt){
 	case(RECTANGLE): case(TRAPEZOID): case(CRESCENT): { return true; }
 	default: { return false; }
@@ -107,6 +116,29 @@ bool SpecialProcessing(const PatternType& pt) {
 	return false;
 }
 
+/* how an untransformed vertex list is turned into pixels - each one reproduces the drawing code the shape always used */
+enum ShapeFill
+{
+	POLYGON_FILL		/* plot the edges of the outline and fill with Polygon::isInsidePolygon */
+	, EDGE_SCAN_FILL	/* plot the edges and the vertices and fill with the lone edge scan (IsInsidePolygon) */
+	, POINT_SCAN_FILL	/* plot only the vertices and fill with the lone edge scan - the vertices are every edge pixel (circle) */
+	, POINTS_ONLY		/* the vertices are the pixels (tilde) */
+};
+
+/************************************************************
+#############################################################
+#   Vertex List Struct
+#############################################################
+#
+#   Describes a unit pattern before it is rasterized - the 
+#	closed outline of the shape in drawing order (or the 
+#	pixels themselves for POINTS_ONLY) plus how to fill it.
+************************************************************/
+struct VertexList {
+	Array<Coordinate> vertices;		/* outline of the shape */
+	ShapeFill fill = POLYGON_FILL;	/* how to fill it when it is not transformed */
+};
+
 /************************************************************
 #############################################################
 #   Unit Pattern Class
@@ -117,6 +149,10 @@ bool SpecialProcessing(const PatternType& pt) {
 #
 #	An object of this class will contain an image
 #	
+#	Derived classes only describe their shape as a vertex
+#	list (BuildVertexList). GenerateUnitPattern applies the
+#	optional transform to the vertices and rasterizes them,
+#	so rotated or skewed units stay crisp.
 ************************************************************/
 class UnitPattern {
 public:
@@ -154,6 +190,7 @@ protected:
 	bool verticalOffsetAllowed = true;				/* currently unused member that determines if a unit pattern can have space between a vertical partner unit */
 	bool horizontalOffsetAllowed = true;			/* currently unused member that determines if a unit pattern can have space between a horizontal partner unit */
 	PatternType patternType;						/* identifier for the type of image that is stored here */
+	AffineTransform transform;						/* applied to the vertex list before rasterizing - identity keeps the original drawing */
 
 private:
 
@@ -303,6 +340,269 @@ protected:
 		}
 	}
 
+	/**************************************************************
+	* FillInLoneEdgeShape
+	***************************************************************
+	* Plots the vertices and fills with IsInsidePolygon. The 
+	* lone edge points are the left-most vertex on the top and
+	* bottom rows of the shape.
+	**************************************************************/
+	void FillInLoneEdgeShape(const Array<Coordinate>& c) {
+		Array<Coordinate> loneEdgePoints;
+		Array<int> edgePointCounter;
+		for (int i = 0; i < height; i++) {
+			edgePointCounter.push(0);
+		}
+
+		for (int i = 0; i < c.getSize(); i++) {
+			edgePointCounter[c.at(i).y] += 1;
+			pattern[c.at(i).y][c.at(i).x] = 1;
+		}
+
+		int minHeight = 0, maxHeight = 0;
+		for (int i = 0; i < edgePointCounter.getSize(); i++) {
+			if (edgePointCounter[i] >= 1) {
+				minHeight = i;
+				break;
+			}
+		}
+
+		for (int i = ((int)edgePointCounter.getSize()) - 1; i >= 0; i--) {
+			if (edgePointCounter[i] >= 1) {
+				maxHeight = i;
+				break;
+			}
+		}
+
+		bool foundMinCoord = false, foundMaxCoord = false;
+		Coordinate minCoordinate;
+		Coordinate maxCoordinate;
+		for (int j = 0; j < c.getSize(); j++) {
+
+			if (minHeight == c.at(j).y) {
+				if (foundMinCoord) {
+					if (minCoordinate.x > c.at(j).x) {
+						minCoordinate = c.at(j);
+					}
+				}
+				else {
+					minCoordinate = c.at(j);
+					foundMinCoord = true;
+				}
+			}
+
+			if (maxHeight == c.at(j).y) {
+				if (foundMaxCoord) {
+					if (maxCoordinate.x > c.at(j).x) {
+						maxCoordinate = c.at(j);
+					}
+				}
+				else {
+					maxCoordinate = c.at(j);
+					foundMaxCoord = true;
+				}
+			}
+
+		}
+
+		loneEdgePoints.push(minCoordinate);
+		loneEdgePoints.push(maxCoordinate);
+
+		FillInPolygon(loneEdgePoints);
+	}
+
+	/* edges joining each vertex to the next (and the last back to the first) */
+	static Array<Edge> GetOutlineEdges(const Array<Coordinate>& c) {
+		Array<Edge> edges;
+		for (int i = 0; i < c.getSize(); i++) {
+			edges.push(Edge(c.at(i), c.at((i + 1) % c.getSize())));
+		}
+		return edges;
+	}
+
+	/* rounds to the nearest pixel - RoundDouble truncates negative values */
+	static int NearestPixel(double d) {
+		return (int)floor(d + 0.5);
+	}
+
+	/**************************************************************
+	* FillInTransformedOutline
+	***************************************************************
+	* Rasterizes a transformed outline. The edges are plotted 
+	* with ComputeStraitLine like the untransformed shapes, 
+	* then every row is filled between pairs of edge crossings
+	* (even-odd), which works for any closed outline. Anything
+	* outside the grid is dropped.
+	**************************************************************/
+	void FillInTransformedOutline(const double* ys, const double* xs, const int& count) {
+		if (count < 2) {
+			return;
+		}
+
+		/* edges */
+		for (int i = 0; i < count; i++) {
+			int j = (i + 1) % count;
+			Array<Coordinate> line = Polygon::ComputeStraitLine(
+				Coordinate(NearestPixel(ys[i]), NearestPixel(xs[i]))
+				, Coordinate(NearestPixel(ys[j]), NearestPixel(xs[j]))
+			);
+			for (int k = 0; k < line.getSize(); k++) {
+				if (line[k].y >= 0 && line[k].y < height && line[k].x >= 0 && line[k].x < width) {
+					pattern[line[k].y][line[k].x] = 1;
+				}
+			}
+		}
+
+		/* inside - rows are sampled at pixel centers */
+		double* crossings = new double[count];
+		for (int h = 0; h < height; h++) {
+			int n = 0;
+			for (int i = 0; i < count; i++) {
+				int j = (i + 1) % count;
+				if ((ys[i] <= h && ys[j] > h) || (ys[j] <= h && ys[i] > h)) {
+					crossings[n] = xs[i] + ((h - ys[i]) * (xs[j] - xs[i]) / (ys[j] - ys[i]));
+					n += 1;
+				}
+			}
+
+			/* insertion sort - only a handful of crossings per row */
+			for (int i = 1; i < n; i++) {
+				double v = crossings[i];
+				int k = i - 1;
+				while (k >= 0 && crossings[k] > v) {
+					crossings[k + 1] = crossings[k];
+					k -= 1;
+				}
+				crossings[k + 1] = v;
+			}
+
+			for (int i = 0; i + 1 < n; i += 2) {
+				int start = (int)ceil(crossings[i]);
+				int end = (int)floor(crossings[i + 1]);
+				if (start < 0) { start = 0; }
+				if (end >= width) { end = width - 1; }
+				for (int w = start; w <= end; w++) {
+					pattern[h][w] = 1;
+				}
+			}
+		}
+		delete[] crossings;
+	}
+
+	/* orders outline points by angle around the center - the circle's points come out grouped by octant */
+	static void SortByAngle(Array<Coordinate>& c, const Coordinate& center) {
+		for (int i = 1; i < c.getSize(); i++) {
+			Coordinate v = c[i];
+			double angle = atan2((double)(v.y - center.y), (double)(v.x - center.x));
+			int k = i - 1;
+			while (k >= 0 && atan2((double)(c[k].y - center.y), (double)(c[k].x - center.x)) > angle) {
+				c[k + 1] = c[k];
+				k -= 1;
+			}
+			c[k + 1] = v;
+		}
+	}
+
+	/**************************************************************
+	* RasterizeVertexList
+	***************************************************************
+	* Draws a vertex list into the grid. Untransformed shapes 
+	* are drawn exactly the way they always were. Transformed
+	* outlines are drawn with FillInTransformedOutline; point
+	* shapes (tilde) have no outline so their pixels are 
+	* mapped back through the inverse transform.
+	**************************************************************/
+	void RasterizeVertexList(const VertexList& shape) {
+		if (transform.IsIdentity()) {
+			switch (shape.fill) {
+			case(POLYGON_FILL): {
+				Polygon p(GetOutlineEdges(shape.vertices));
+				p.plotPolygon(pattern);
+				FillInPolygon(p);
+				break;
+			}
+			case(EDGE_SCAN_FILL): {
+				Polygon p(GetOutlineEdges(shape.vertices));
+				p.plotPolygon(pattern);
+				FillInLoneEdgeShape(shape.vertices);
+				break;
+			}
+			case(POINT_SCAN_FILL): {
+				FillInLoneEdgeShape(shape.vertices);
+				break;
+			}
+			case(POINTS_ONLY): {
+				for (int i = 0; i < shape.vertices.getSize(); i++) {
+					pattern[shape.vertices.at(i).y][shape.vertices.at(i).x] = 1;
+				}
+				break;
+			}
+			}
+			return;
+		}
+
+		Coordinate center;
+		GetCenter(height, width, center.y, center.x);
+
+		if (shape.fill == POINTS_ONLY) {
+			AffineTransform inverse;
+			if (!transform.Invert(inverse)) {
+				return;
+			}
+			/* stamp the untransformed points, then pull every pixel back through the inverse */
+			char** source = new char* [height];
+			for (int h = 0; h < height; h++) {
+				source[h] = new char[width];
+				for (int w = 0; w < width; w++) {
+					source[h][w] = 0;
+				}
+			}
+			for (int i = 0; i < shape.vertices.getSize(); i++) {
+				source[shape.vertices.at(i).y][shape.vertices.at(i).x] = 1;
+			}
+			double sy = 0, sx = 0;
+			for (int h = 0; h < height; h++) {
+				for (int w = 0; w < width; w++) {
+					inverse.Apply(h, w, center.y, center.x, sy, sx);
+					int y = NearestPixel(sy);
+					int x = NearestPixel(sx);
+					if (y >= 0 && y < height && x >= 0 && x < width && source[y][x] != 0) {
+						pattern[h][w] = 1;
+					}
+				}
+			}
+			for (int h = 0; h < height; h++) {
+				delete[] source[h];
+			}
+			delete[] source;
+			return;
+		}
+
+		Array<Coordinate> outline = shape.vertices;
+		if (shape.fill == POINT_SCAN_FILL) {
+			SortByAngle(outline, center);
+		}
+
+		int count = outline.getSize();
+		double* ys = new double[count];
+		double* xs = new double[count];
+		for (int i = 0; i < count; i++) {
+			transform.Apply(outline[i].y, outline[i].x, center.y, center.x, ys[i], xs[i]);
+		}
+		FillInTransformedOutline(ys, xs, count);
+		delete[] ys;
+		delete[] xs;
+	}
+
+	/* Pure abstract function so you cannot instantiate this object :) */
+	virtual void BuildVertexList(VertexList& shape) = 0; /* This is the function used to describe the shape within the grid */
+
+	/* This is the function used to draw the shape within the grid */
+	void GenerateUnitPattern() {
+		VertexList shape;
+		BuildVertexList(shape);
+		RasterizeVertexList(shape);
+	}
 
 private:
 
@@ -328,7 +628,7 @@ private:
 public:
 
 	/* parameter constructor - allocates memory needed */
-	UnitPattern(int height, int width, PatternType patternType) : height(height), width(width), patternType(patternType) {
+	UnitPattern(int height, int width, PatternType patternType, const AffineTransform& transform = AffineTransform()) : height(height), width(width), patternType(patternType), transform(transform) {
 		/* alter height and width so that there is a single pixel center */
 		DetermineHeightAndWidthWithTrueCenter(this->height, this->width);
 
@@ -353,6 +653,7 @@ public:
 		numberOfScales = copy.numberOfScales;
 		height = copy.height;
 		width = copy.width;
+		transform = copy.transform;
 		pattern = new char* [height];
 		for (int i = 0; i < height; i++) {
 			pattern[i] = new char[width];
@@ -390,6 +691,7 @@ public:
 	int GetWidth() const { return width; }
 	int GetScales() const { return numberOfScales; }
 	PatternType GetPatternType() const { return patternType; }
+	AffineTransform GetTransform() const { return transform; }
 	bool allowsVerticalOffset() const { return verticalOffsetAllowed; }
 	bool allowsHorizontalOffset() const { return horizontalOffsetAllowed; }
 
@@ -398,9 +700,6 @@ public:
 		return pattern[h][w];
 	}
 
-	/* Pure abstract function so you cannot instantiate this object :) */
-	virtual void GenerateUnitPattern() = 0; /* This is the function used to draw the shape within the grid */
-
 };
 
 /*
@@ -425,7 +724,7 @@ class SquarePattern : public UnitPattern {
 private:
 	const int scale1 = 0; 
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		int centerHeight = 0, centerWidth = 0;
 		GetCenter(height, width, centerHeight, centerWidth);
 		int radius = (scales[scale1] * ((height < width) ? height : width)) / 2;
@@ -446,22 +745,16 @@ private:
 		c[2] = Coordinate(endHeight, endWidth);
 		c[3] = Coordinate(endHeight, startWidth);
 
-		Array<Edge> edges;
-		edges.push(Edge(c[0], c[1]));
-		edges.push(Edge(c[1], c[2]));
-		edges.push(Edge(c[2], c[3]));
-		edges.push(Edge(c[3], c[0]));
+		for (int i = 0; i < 4; i++) {
+			shape.vertices.push(c[i]);
+		}
 
 		delete[] c;
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
 	}
 
 public:
 
-	SquarePattern(int height, int width, const double* s) : UnitPattern(height, width, SQUARE) {
+	SquarePattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, SQUARE, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -478,7 +771,7 @@ private:
 	const int widthScale = 0;
 	const int heightScale = 1;
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		int centerHeight = 0, centerWidth = 0;
 		GetCenter(height, width, centerHeight, centerWidth);
 		int widthRadius = (scales[widthScale] * width) / 2;
@@ -494,22 +787,16 @@ private:
 		c[2] = Coordinate(centerHeight - heightRadius, centerWidth);
 		c[3] = Coordinate(centerHeight, centerWidth + widthRadius);
 
-		Array<Edge> edges;
-		edges.push(Edge(c[0], c[1]));
-		edges.push(Edge(c[1], c[2]));
-		edges.push(Edge(c[2], c[3]));
-		edges.push(Edge(c[3], c[0]));
+		for (int i = 0; i < 4; i++) {
+			shape.vertices.push(c[i]);
+		}
 
 		delete[] c;
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
 	}
 
 public:
 
-	DiamondPattern(int height, int width, const double* s) : UnitPattern(height, width, DIAMOND) {
+	DiamondPattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, DIAMOND, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -530,7 +817,7 @@ private:
 		return sqrt((c * c) - (a_or_b * a_or_b));
 	}
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		int centerHeight = 0, centerWidth = 0;
 		GetCenter(height, width, centerHeight, centerWidth); 
 		double radius = (scales[scale1] * ((height < width) ? height : width)) / 2;
@@ -571,72 +858,13 @@ private:
 			}
 		}
 
-		Array<int> edgePointCounter;
-		for (int i = 0; i < height; i++) {
-			edgePointCounter.push(0);
-		}
-
-		for (int i = 0; i < circlePoints.getSize(); i++) {
-			edgePointCounter[circlePoints[i].y] += 1;
-			pattern[circlePoints[i].y][circlePoints[i].x] = 1;
-		}
-
-		int minHeight = 0, maxHeight = 0;
-		for (int i = 0; i < edgePointCounter.getSize(); i++) {
-			if (edgePointCounter[i] >= 1) {
-				minHeight = i;
-				break;
-			}
-		}
-
-		for (int i = ((int)edgePointCounter.getSize()) - 1; i >= 0; i--) {
-			if (edgePointCounter[i] >= 1) {
-				maxHeight = i;
-				break;
-			}
-		}
-
-		bool foundMinCoord = false, foundMaxCoord = false;
-		Coordinate minCoordinate;
-		Coordinate maxCoordinate;
-		for (int j = 0; j < circlePoints.getSize(); j++) {
-
-			if (minHeight == circlePoints[j].y) {
-				if (foundMinCoord) {
-					if (minCoordinate.x > circlePoints[j].x) {
-						minCoordinate = circlePoints[j];
-					}
-				}
-				else {
-					minCoordinate = circlePoints[j];
-					foundMinCoord = true;
-				}
-			}
-
-			if (maxHeight == circlePoints[j].y) {
-				if (foundMaxCoord) {
-					if (maxCoordinate.x > circlePoints[j].x) {
-						maxCoordinate = circlePoints[j];
-					}
-				}
-				else {
-					maxCoordinate = circlePoints[j];
-					foundMaxCoord = true;
-				}
-			}
-
-		}
-
-		Array<Coordinate> loneEdgePoints;
-		loneEdgePoints.push(minCoordinate);
-		loneEdgePoints.push(maxCoordinate);
-
-		FillInPolygon(loneEdgePoints);
+		shape.vertices = circlePoints;
+		shape.fill = POINT_SCAN_FILL;
 	}
 
 public:
 
-	CirclePattern(int height, int width, const double* s) : UnitPattern(height, width, CIRCLE) {
+	CirclePattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, CIRCLE, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -652,7 +880,7 @@ public:
 class TrianglePattern : public UnitPattern {
 private:
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x);
 		
@@ -670,19 +898,12 @@ private:
 			c.push(Polygon::ComputePointGivenAngleAndDistance(180.0 + (i * split), scales[i] * t, centerCoord));
 		}
 		
-		Array<Edge> edges;
-		for (int i = 0; i < sides; i++) {
-			edges.push(Edge(c[i], c[(i+1) % sides]));
-		}
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
+		shape.vertices = c;
 	}
 
 public:
 
-	TrianglePattern(int height, int width, const double* s) : UnitPattern(height, width, TRIANGLE) {
+	TrianglePattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, TRIANGLE, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -698,7 +919,7 @@ public:
 class PentagonPattern : public UnitPattern {
 private:
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x); 
 
@@ -716,19 +937,12 @@ private:
 			c.push(Polygon::ComputePointGivenAngleAndDistance(180.0 + (i * split), scales[i] * t, centerCoord));
 		}
 
-		Array<Edge> edges;
-		for (int i = 0; i < sides; i++) {
-			edges.push(Edge(c[i], c[(i + 1) % sides]));
-		}
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
+		shape.vertices = c;
 	}
 
 public:
 
-	PentagonPattern(int height, int width, const double* s) : UnitPattern(height, width, PENTAGON) {
+	PentagonPattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, PENTAGON, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -744,7 +958,7 @@ class StarPattern : public UnitPattern {
 private:
 	const int scale1 = 0; 
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x);	
 		int radius = (scales[scale1] * ((height < width) ? height : width)) / 2; 
@@ -770,29 +984,17 @@ private:
 		c[9] = Polygon::ComputeCentroid(c[8], c[0], centerCoord);
 
 
-		Array<Edge> edges;
-		edges.push(Edge(c[0], c[1]));
-		edges.push(Edge(c[1], c[2]));
-		edges.push(Edge(c[2], c[3]));
-		edges.push(Edge(c[3], c[4]));
-		edges.push(Edge(c[4], c[5]));
-		edges.push(Edge(c[5], c[6]));
-		edges.push(Edge(c[6], c[7]));
-		edges.push(Edge(c[7], c[8]));
-		edges.push(Edge(c[8], c[9]));
-		edges.push(Edge(c[9], c[0]));
+		for (int i = 0; i < 10; i++) {
+			shape.vertices.push(c[i]);
+		}
 
 		delete[] c;
 
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
-
 	}
 
 public:
 
-	StarPattern(int height, int width, const double* s) : UnitPattern(height, width, STAR) {
+	StarPattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, STAR, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -808,7 +1010,7 @@ class HorizontalStripePattern : public UnitPattern {
 private:
 	const int scale1 = 0; 
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x);					 
 		int radius = (scales[scale1] * ((height < width) ? height : width)) / 2; 
@@ -825,22 +1027,16 @@ private:
 		c[3] = Coordinate(centerCoord.y + radius, height - 1);
 
 
-		Array<Edge> edges;
-		edges.push(Edge(c[0], c[1]));
-		edges.push(Edge(c[1], c[2]));
-		edges.push(Edge(c[2], c[3]));
-		edges.push(Edge(c[3], c[0]));
+		for (int i = 0; i < 4; i++) {
+			shape.vertices.push(c[i]);
+		}
 
 		delete[] c;
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
 	}
 
 public:
 
-	HorizontalStripePattern(int height, int width, const double* s) : UnitPattern(height, width, HORIZONTAL_STRIPES) {
+	HorizontalStripePattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, HORIZONTAL_STRIPES, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -857,7 +1053,7 @@ class VerticalStripePattern : public UnitPattern {
 private:
 	const int scale1 = 0; // Scale that square uses
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x);					 
 		int radius = (scales[scale1] * ((height < width) ? height : width)) / 2; 
@@ -874,22 +1070,16 @@ private:
 		c[3] = Coordinate(width - 1, centerCoord.x + radius);
 
 
-		Array<Edge> edges;
-		edges.push(Edge(c[0], c[1]));
-		edges.push(Edge(c[1], c[2]));
-		edges.push(Edge(c[2], c[3]));
-		edges.push(Edge(c[3], c[0]));
+		for (int i = 0; i < 4; i++) {
+			shape.vertices.push(c[i]);
+		}
 
 		delete[] c;
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
 	}
 
 public:
 
-	VerticalStripePattern(int height, int width, const double* s) : UnitPattern(height, width, VERTICAL_STRIPES) {
+	VerticalStripePattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, VERTICAL_STRIPES, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -906,7 +1096,7 @@ private:
 	const int widthScale = 0;
 	const int heightScale = 1;
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		int centerHeight = 0, centerWidth = 0;
 		GetCenter(height, width, centerHeight, centerWidth); 
 		int widthRadius = (scales[widthScale] * width) / 2;
@@ -928,22 +1118,16 @@ private:
 		c[2] = Coordinate(endHeight, endWidth);
 		c[3] = Coordinate(endHeight, startWidth);
 
-		Array<Edge> edges;
-		edges.push(Edge(c[0], c[1]));
-		edges.push(Edge(c[1], c[2]));
-		edges.push(Edge(c[2], c[3]));
-		edges.push(Edge(c[3], c[0]));
+		for (int i = 0; i < 4; i++) {
+			shape.vertices.push(c[i]);
+		}
 
 		delete[] c;
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
 	}
 
 public:
 
-	RectanglePattern(int height, int width, const double* s) : UnitPattern(height, width, RECTANGLE) {
+	RectanglePattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, RECTANGLE, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -959,7 +1143,7 @@ public:
 class HexagonPattern : public UnitPattern {
 private:
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x); 
 
@@ -977,19 +1161,12 @@ private:
 			c.push(Polygon::ComputePointGivenAngleAndDistance(180.0 + (i * split), scales[i] * t, centerCoord));
 		}
 
-		Array<Edge> edges;
-		for (int i = 0; i < sides; i++) {
-			edges.push(Edge(c[i], c[(i + 1) % sides]));
-		}
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
+		shape.vertices = c;
 	}
 
 public:
 
-	HexagonPattern(int height, int width, const double* s) : UnitPattern(height, width, HEXAGON) {
+	HexagonPattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, HEXAGON, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -1005,7 +1182,7 @@ public:
 class HeptagonPattern : public UnitPattern {
 private:
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x); 
 
@@ -1023,19 +1200,12 @@ private:
 			c.push(Polygon::ComputePointGivenAngleAndDistance(180.0 + (i * split), scales[i] * t, centerCoord));
 		}
 
-		Array<Edge> edges;
-		for (int i = 0; i < sides; i++) {
-			edges.push(Edge(c[i], c[(i + 1) % sides]));
-		}
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
+		shape.vertices = c;
 	}
 
 public:
 
-	HeptagonPattern(int height, int width, const double* s) : UnitPattern(height, width, HEPTAGON) {
+	HeptagonPattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, HEPTAGON, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -1051,7 +1221,7 @@ public:
 class OctogonPattern : public UnitPattern {
 private:
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x); 
 
@@ -1069,19 +1239,12 @@ private:
 			c.push(Polygon::ComputePointGivenAngleAndDistance(180.0 + (i * split), scales[i] * t, centerCoord));
 		}
 
-		Array<Edge> edges;
-		for (int i = 0; i < sides; i++) {
-			edges.push(Edge(c[i], c[(i + 1) % sides]));
-		}
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
+		shape.vertices = c;
 	}
 
 public:
 
-	OctogonPattern(int height, int width, const double* s) : UnitPattern(height, width, OCTAGON) {
+	OctogonPattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, OCTAGON, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -1100,7 +1263,7 @@ private:
 	const int width2Scale = 1;
 	const int heightScale = 2;
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x); 
 
@@ -1113,20 +1276,15 @@ private:
 		int topWidth = scales[width2Scale] * t;
 		int tHeight = scales[heightScale] * t;
 	
-		Array<Edge> edges;
-		edges.push(Edge(Coordinate(centerCoord.y - tHeight, centerCoord.x - topWidth), Coordinate(centerCoord.y - tHeight, centerCoord.x + topWidth)));
-		edges.push(Edge(Coordinate(centerCoord.y - tHeight, centerCoord.x + topWidth), Coordinate(centerCoord.y + tHeight, centerCoord.x + bottomWidth)));
-		edges.push(Edge(Coordinate(centerCoord.y + tHeight, centerCoord.x + bottomWidth), Coordinate(centerCoord.y + tHeight, centerCoord.x - bottomWidth)));
-		edges.push(Edge(Coordinate(centerCoord.y + tHeight, centerCoord.x - bottomWidth), Coordinate(centerCoord.y - tHeight, centerCoord.x - topWidth)));
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
+		shape.vertices.push(Coordinate(centerCoord.y - tHeight, centerCoord.x - topWidth));
+		shape.vertices.push(Coordinate(centerCoord.y - tHeight, centerCoord.x + topWidth));
+		shape.vertices.push(Coordinate(centerCoord.y + tHeight, centerCoord.x + bottomWidth));
+		shape.vertices.push(Coordinate(centerCoord.y + tHeight, centerCoord.x - bottomWidth));
 	}
 
 public:
 
-	TrapezoidPattern(int height, int width, const double* s) : UnitPattern(height, width, TRAPEZOID) {
+	TrapezoidPattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, TRAPEZOID, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -1143,7 +1301,7 @@ class HeartPattern : public UnitPattern {
 private:
 	const int s1 = 0;
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x); 
 
@@ -1181,20 +1339,13 @@ private:
 			c.push(Polygon::ComputePointGivenAngleAndDistance(180.0 + currentAngle, td2, centerFanCoord));
 		}
 
-		Array<Edge> edges;
-		for (int i = 0; i < c.getSize(); i++) {
-			edges.push(Edge(c[i], c[ (i+1) % c.getSize() ]));
-		}
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
+		shape.vertices = c;
 
 	}
 
 public:
 
-	HeartPattern(int height, int width, const double* s) : UnitPattern(height, width, HEART) {
+	HeartPattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, HEART, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -1212,7 +1363,7 @@ private:
 	const int s1 = 0;
 	const int s2 = 0;
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x); 
 
@@ -1243,83 +1394,13 @@ private:
 		c.push(Coordinate(centerCoord.y - limbRadius, centerCoord.x - limbRadius));
 		c.push(Coordinate(centerCoord.y - halfRadius, centerCoord.x - limbRadius));
 
-		Array<Edge> edges;
-		for (int i = 0; i < c.getSize(); i++) {
-			edges.push(Edge(c[i], c[(i + 1) % c.getSize()]));
-		}
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-
-		/******************
-			Relatively garbage code to fill in difficult shapes
-		**********************/
-		Array<Coordinate> loneEdgePoints;
-		Array<int> edgePointCounter;
-		for (int i = 0; i < height; i++) {
-			edgePointCounter.push(0);
-		}
-
-		for (int i = 0; i < c.getSize(); i++) {
-			edgePointCounter[c[i].y] += 1;
-			pattern[c[i].y][c[i].x] = 1;
-		}
-
-		int minHeight = 0, maxHeight = 0;
-		for (int i = 0; i < edgePointCounter.getSize(); i++) {
-			if (edgePointCounter[i] >= 1) {
-				minHeight = i;
-				break;
-			}
-		}
-
-		for (int i = ((int)edgePointCounter.getSize()) - 1; i >= 0; i--) {
-			if (edgePointCounter[i] >= 1) {
-				maxHeight = i;
-				break;
-			}
-		}
-
-		bool foundMinCoord = false, foundMaxCoord = false;
-		Coordinate minCoordinate;
-		Coordinate maxCoordinate;
-		for (int j = 0; j < c.getSize(); j++) {
-
-			if (minHeight == c[j].y) {
-				if (foundMinCoord) {
-					if (minCoordinate.x > c[j].x) {
-						minCoordinate = c[j];
-					}
-				}
-				else {
-					minCoordinate = c[j];
-					foundMinCoord = true;
-				}
-			}
-
-			if (maxHeight == c[j].y) {
-				if (foundMaxCoord) {
-					if (maxCoordinate.x > c[j].x) {
-						maxCoordinate = c[j];
-					}
-				}
-				else {
-					maxCoordinate = c[j];
-					foundMaxCoord = true;
-				}
-			}
-
-		}
-
-		loneEdgePoints.push(minCoordinate);
-		loneEdgePoints.push(maxCoordinate);
-
-		FillInPolygon(loneEdgePoints);
+		shape.vertices = c;
+		shape.fill = EDGE_SCAN_FILL;
 	}
 
 public:
 
-	CrossPattern(int height, int width, const double* s) : UnitPattern(height, width, CROSS) {
+	CrossPattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, CROSS, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -1337,7 +1418,7 @@ private:
 	const int s1 = 0;
 	const int s2 = 1;
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x); 
 
@@ -1364,20 +1445,13 @@ private:
 			c.push(Coordinate(c[i].y, c[i].x + (distanceFromCenter * scales[s2])));
 		}
 
-		Array<Edge> edges;
-		for (int i = 0; i < c.getSize(); i++) {
-			edges.push(Edge(c[i], c[(i + 1) % c.getSize()]));
-		}
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
+		shape.vertices = c;
 
 	}
 
 public:
 
-	CrescentPattern(int height, int width, const double* s) : UnitPattern(height, width, CRESCENT) {
+	CrescentPattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, CRESCENT, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -1395,7 +1469,7 @@ private:
 	const int s1 = 0;
 	const int s2 = 1;
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x); 
 
@@ -1421,20 +1495,13 @@ private:
 			swap = !swap;
 		}
 
-		Array<Edge> edges;
-		for (int i = 0; i < c.getSize(); i++) {
-			edges.push(Edge(c[i], c[(i + 1) % c.getSize()]));
-		}
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
+		shape.vertices = c;
 
 	}
 
 public:
 
-	SpikePattern(int height, int width, const double* s) : UnitPattern(height, width, SPIKE) {
+	SpikePattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, SPIKE, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -1452,7 +1519,7 @@ private:
 	const int s1 = 0;
 	const int s2 = 1;
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x); 
 
@@ -1474,83 +1541,13 @@ private:
 		c.push(Coordinate(centerCoord.y, centerCoord.x - stemRadius));
 		c.push(Coordinate(centerCoord.y, centerCoord.x - widthRadius));
 
-		Array<Edge> edges;
-		for (int i = 0; i < c.getSize(); i++) {
-			edges.push(Edge(c[i], c[(i + 1) % c.getSize()]));
-		}
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-
-		/******************
-			Relatively garbage code to fill in difficult shapes
-		**********************/
-		Array<Coordinate> loneEdgePoints;
-		Array<int> edgePointCounter;
-		for (int i = 0; i < height; i++) {
-			edgePointCounter.push(0);
-		}
-
-		for (int i = 0; i < c.getSize(); i++) {
-			edgePointCounter[c[i].y] += 1;
-			pattern[c[i].y][c[i].x] = 1;
-		}
-
-		int minHeight = 0, maxHeight = 0;
-		for (int i = 0; i < edgePointCounter.getSize(); i++) {
-			if (edgePointCounter[i] >= 1) {
-				minHeight = i;
-				break;
-			}
-		}
-
-		for (int i = ((int)edgePointCounter.getSize()) - 1; i >= 0; i--) {
-			if (edgePointCounter[i] >= 1) {
-				maxHeight = i;
-				break;
-			}
-		}
-
-		bool foundMinCoord = false, foundMaxCoord = false;
-		Coordinate minCoordinate;
-		Coordinate maxCoordinate;
-		for (int j = 0; j < c.getSize(); j++) {
-
-			if (minHeight == c[j].y) {
-				if (foundMinCoord) {
-					if (minCoordinate.x > c[j].x) {
-						minCoordinate = c[j];
-					}
-				}
-				else {
-					minCoordinate = c[j];
-					foundMinCoord = true;
-				}
-			}
-
-			if (maxHeight == c[j].y) {
-				if (foundMaxCoord) {
-					if (maxCoordinate.x > c[j].x) {
-						maxCoordinate = c[j];
-					}
-				}
-				else {
-					maxCoordinate = c[j];
-					foundMaxCoord = true;
-				}
-			}
-
-		}
-
-		loneEdgePoints.push(minCoordinate);
-		loneEdgePoints.push(maxCoordinate);
-
-		FillInPolygon(loneEdgePoints);
+		shape.vertices = c;
+		shape.fill = EDGE_SCAN_FILL;
 	}
 
 public:
 
-	ArrowPattern(int height, int width, const double* s) : UnitPattern(height, width, ARROW) {
+	ArrowPattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, ARROW, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -1568,7 +1565,7 @@ private:
 	const int s1 = 0;
 	const int s2 = 1;
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x); 
 
@@ -1607,15 +1604,14 @@ private:
 			}
 		}
 		
-		for (int i = 0; i < c.getSize(); i++) {
-			pattern[c[i].y][c[i].x] = 1;
-		}
+		shape.vertices = c;
+		shape.fill = POINTS_ONLY;
 
 	}
 
 public:
 
-	TildePattern(int height, int width, const double* s) : UnitPattern(height, width, TILDE) {
+	TildePattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, TILDE, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -1633,7 +1629,7 @@ private:
 	const int s1 = 0;
 	const int s2 = 1;
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x); 
 
@@ -1658,20 +1654,13 @@ private:
 		c.push(Coordinate(centerCoord.y - halfRadius2, centerCoord.x - halfRadius1));
 
 
-		Array<Edge> edges;
-		for (int i = 0; i < c.getSize(); i++) {
-			edges.push(Edge(c[i], c[(i + 1) % c.getSize()]));
-		}
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
+		shape.vertices = c;
 
 	}
 
 public:
 
-	ZigzagPattern(int height, int width, const double* s) : UnitPattern(height, width, ZIGZAG) {
+	ZigzagPattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, ZIGZAG, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -1689,7 +1678,7 @@ private:
 	const int s1 = 0;
 	const int s2 = 1;
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x); 
 
@@ -1717,20 +1706,13 @@ private:
 		c.push(Coordinate(centerCoord.y - heightRadius + thickness, centerCoord.x - widthRadius + thickness));
 		c.push(Coordinate(centerCoord.y + heightRadius, centerCoord.x - widthRadius + thickness));
 		
-		Array<Edge> edges;
-		for (int i = 0; i < c.getSize(); i++) {
-			edges.push(Edge(c[i], c[(i + 1) % c.getSize()]));
-		}
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
+		shape.vertices = c;
 
 	}
 
 public:
 
-	CanePattern(int height, int width, const double* s) : UnitPattern(height, width, CANE) {
+	CanePattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, CANE, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -1747,7 +1729,7 @@ class CatPattern : public UnitPattern {
 private:
 	const int s1 = 0;
 
-	void GenerateUnitPattern() {
+	void BuildVertexList(VertexList& shape) {
 		Coordinate centerCoord;
 		GetCenter(height, width, centerCoord.y, centerCoord.x); 
 
@@ -1776,20 +1758,13 @@ private:
 		c.push(Coordinate(centerCoord.y, centerCoord.x - halfRadius - fourthRadius - (eigthRadius / 2))); /* left face */
 		c.push(Coordinate(centerCoord.y + halfRadius, centerCoord.x - halfRadius - fourthRadius)); /* left cheek */
 
-		Array<Edge> edges;
-		for (int i = 0; i < c.getSize(); i++) {
-			edges.push(Edge(c[i], c[(i + 1) % c.getSize()]));
-		}
-
-		Polygon p(edges);
-		p.plotPolygon(pattern);
-		FillInPolygon(p);
+		shape.vertices = c;
 
 	}
 
 public:
 
-	CatPattern(int height, int width, const double* s) : UnitPattern(height, width, CANE) {
+	CatPattern(int height, int width, const double* s, const AffineTransform& t = AffineTransform()) : UnitPattern(height, width, CANE, t) {
 		SetScale(GetScalesForPattern(patternType), s);
 		GenerateUnitPattern();
 	}
@@ -2038,6 +2013,36 @@ public:
 		return s;
 	}
 
+	/* number of bytes needed to hold the image as packed bits */
+	int GetPackedSize() const { return ((height * width) + 7) / 8; }
+
+	/**************************************************************
+	* GetPackedData
+	***************************************************************
+	* Same content as GetRawDataAsString but packed 8 pixels to a 
+	* byte in row-major order. Pixel i lives in byte (i / 8) at 
+	* bit (i % 8). The buffer must hold GetPackedSize() bytes.
+	**************************************************************/
+	void GetPackedData(unsigned char* out) const {
+		int i = 0;
+		unsigned char current = 0;
+		for (int h = 0; h < height; h++) {
+			for (int w = 0; w < width; w++) {
+				if (canvas[h][w] != 0) {
+					current |= (unsigned char)(1 << (i & 7));
+				}
+				i += 1;
+				if ((i & 7) == 0) {
+					out[(i >> 3) - 1] = current;
+					current = 0;
+				}
+			}
+		}
+		if ((i & 7) != 0) {
+			out[i >> 3] = current;
+		}
+	}
+
 	/* function to copy canvas into a pixel vector and use the bitmap class which I got from Kevin Buffardi (check the file) */
 	void SavePatternToBmp(string fileName) {
 		PixelMatrix pm;
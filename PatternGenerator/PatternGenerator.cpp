@@ -1,436 +1,292 @@
-#include <fstream>
-#include "Pattern.h"
+#include "PatternGenerator.h"
+#include "PatternStream.h"
+#include "RecordStream.h"
+#include <csignal>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 using namespace std;
 
-/************************************************************
-#############################################################
-#   PatternGenerator Class
-#############################################################
-#
-#   Class used to generate a WHOLE data set 
-************************************************************/
-class PatternGenerator {
-private:
-	Array<PatternType> patternList; /* classes to generate */
-	int totalImages = 0;			/* total images in the data set */
-
-	int unitPatternWidth = 50;		/* size of the units */
-	int unitPatternHeight = 50;		/* size of the units */
-
-	int patternWidth = 50;			/* size of the images */
-	int patternHeight = 50;			/* size of the images */
-
-	double minScale = 0;			/* used to control how small a unit can be */
-	double scaleStep = 0;			/* used to change the scale to generate unique units */
-	double maxScale = 0;			/* used to control how large a unit can be */
-
-	int allowedNumberOfScales = 0;	/* used to limit the number of scales allowed to be used for units - I think this is currently unused */
-
-	const int minPixelsAllowed = 30;		/* generating images using math gets tough if the image is too small */
-	const int maximumPossibleScales = 8;	/* max possible ways a unit MIGHT be scaled (like.. an octogon) */
-
-	bool clipping = false;			/* can the units be clipped off the edge */
-	bool center = true;				/* are the images centered */
+/* reports a bad --stream argument and how to use it - returns the exit code */
+int StreamUsage(const string& problem)
+{
+	cerr << problem << endl
+		<< "Usage: PatternGenerator --stream [--random count] [--seed value] [--transforms K] [--unit-... value] [--augment K] [--augment-... value] [destinations...]" << endl
+		<< "       --unit-... is rotation, stretch or shear" << endl
+		<< "       --augment-... is keep-original, translation, rotate90, rotation, flip-horizontal, flip-vertical, noise or morphology" << endl;
+	return 1;
+}
 
-	double percentageOfPatternsToKeep = 0.01;	/* percentage of unit combinations to actually generate - used to limit compute */
+/* reads a whole number no bigger than maximum - false for anything else (signs, spaces, trailing text, overflow) */
+bool ReadCount(const char* text, const unsigned long long& maximum, unsigned long long& value)
+{
+	if (*text < '0' || *text > '9') {
+		return false;
+	}
+	char* end = nullptr;
+	errno = 0;
+	value = strtoull(text, &end, 10);
+	return errno == 0 && *end == '\0' && value <= maximum;
+}
 
-	string outputDirectory = "";	/* where am I saving this data */
-	ofstream dataFile;				/* and here is the file "object" to save to */
+/* reads a number from 0 to maximum - false for anything else */
+bool ReadAmount(const char* text, const double& maximum, double& value)
+{
+	if ((*text < '0' || *text > '9') && *text != '.') {
+		return false;
+	}
+	char* end = nullptr;
+	double read = strtod(text, &end);
+	if (*end != '\0' || !(read <= maximum)) {
+		return false;
+	}
+	value = read;
+	return true;
+}
 
-	Array<Array<UnitPattern*>> unitPatterns;	/* the set of all unit patterns that can be used to generate patterns */
-	Array<Array<int>> unitPatternIndexes;		/* set to assign IDs to the above patterns - used for determining a combination */
+/* reads true or false - false for anything else */
+bool ReadSwitch(const char* text, bool& value)
+{
+	string s = text;
+	if (s != "true" && s != "false") {
+		return false;
+	}
+	value = (s == "true");
+	return true;
+}
 
-	/* cleaner function to return allocated memory */
-	void deallocateAllUnitPattens() {
-		for (int i = 0; i < unitPatterns.getSize(); i++) {
-			for (int j = 0; j < unitPatterns[i].getSize(); j++) {
-				if (unitPatterns[i][j] != nullptr) {
-					delete unitPatterns[i][j];
-					unitPatterns[i][j] = nullptr;
-				}
+/**************************************************************
+* StreamRecords
+***************************************************************
+* Writes the data set as a record stream (see RecordStream.h)
+* instead of data.csv. Arguments:
+*	--random count	draw count random records (0 = until
+*					every reader has gone away) instead of
+*					walking the data set once
+*	--seed value	seed for --random and --augment
+*	--transforms K	add K rotated/stretched/sheared copies
+*					of every unit pattern (drawn before
+*					rasterizing, so they stay crisp). How
+*					far a copy may go:
+*		--unit-rotation degrees					(30)
+*		--unit-stretch share					(0.15)
+*		--unit-shear shear						(0.2)
+*	--augment K		follow every pattern with K augmented
+*					variants - by default shifted up to 3
+*					pixels, rotated up to 15 degrees,
+*					flipped either way, 1% of the pixels
+*					turned to noise and a 25% chance of a
+*					dilate/erode. These change that:
+*		--augment-keep-original true|false		(true)
+*		--augment-translation pixels			(3)
+*		--augment-rotate90 true|false			(false)
+*		--augment-rotation degrees				(15)
+*		--augment-flip-horizontal true|false	(true)
+*		--augment-flip-vertical true|false		(true)
+*		--augment-noise probability				(0.01)
+*		--augment-morphology probability		(0.25)
+*	destinations	files or named pipes to write to, "-" is
+*					stdout (the default). Every destination
+*					gets the same records, so one generator
+*					can feed several trainers.
+* Any other argument starting with "--", or a flag without a
+* valid value after it, prints the usage and returns 1.
+* Status goes to cerr so stdout stays clean for the stream.
+**************************************************************/
+int StreamRecords(PatternStreamSettings settings, int argc, char** argv)
+{
+	unsigned long long randomCount = 0;
+	unsigned long long number = 0;
+	Array<string> destinations;
+
+	/* what --transforms K and --augment K vary unless the --unit-... and --augment-... flags say otherwise */
+	settings.maxUnitRotationDegrees = 30.0;
+	settings.maxUnitStretch = 0.15;
+	settings.maxUnitShear = 0.2;
+	settings.augmentation.maxTranslation = 3;
+	settings.augmentation.maxRotationDegrees = 15.0;
+	settings.augmentation.flipHorizontal = true;
+	settings.augmentation.flipVertical = true;
+	settings.augmentation.noiseProbability = 0.01;
+	settings.augmentation.morphologyProbability = 0.25;
+
+	for (int i = 0; i < argc; i++) {
+		string arg = argv[i];
+		if (arg.compare(0, 2, "--") != 0) {
+			destinations.push(arg);
+		}
+		else if (arg == "--random") {
+			if (i + 1 >= argc || !ReadCount(argv[++i], ULLONG_MAX, number)) {
+				return StreamUsage("--random needs a record count");
 			}
+			settings.randomSampling = true;
+			randomCount = number;
 		}
-		unitPatterns.reset();
-		unitPatternIndexes.reset();
-	}
-	
-	/* function used to standardize all the class members so that things work nicely */
-	void cleanAndStandardizeMembers(bool smartScaleDetection, bool enforceBorders) {
-
-		/* The unit pattern must always be smaller than the big pattern */
-		if (unitPatternWidth > patternWidth) { patternWidth = unitPatternWidth; }
-		if (unitPatternHeight > patternHeight) { patternHeight = unitPatternHeight; }
-
-		/* No dupes */
-		patternList.removeDuplicates();
-
-		/* Scales */
-		double smallestDimension = (unitPatternWidth < unitPatternHeight) ? unitPatternWidth : unitPatternHeight;
-		if (smartScaleDetection) {
-			scaleStep = 1.0 / smallestDimension;
-			minScale = 0.2;
-			maxScale = 0.9;
+		else if (arg == "--seed") {
+			if (i + 1 >= argc || !ReadCount(argv[++i], UINT_MAX, number)) {
+				return StreamUsage("--seed needs a whole number");
+			}
+			settings.seed = (unsigned int)number;
 		}
-
-		/*
-			Scale is between 0 and 1
-			When the scale changes, there needs to be a visible change in the image
-
-			for example:
-				- A scale step of 0.01 is acceptable for 100 pixels because ((0.01) * (100)) = 1 pixel
-				- A scale step of 0.01 is NOT acceptable for 50 pixels because ((0.01) * (50)) = 0 pixels
-
-			So, we take 1 / (minimum dimension) and if the scale step is smaller than that, we correct. 
-		*/
-		if ((1.0 / smallestDimension) > scaleStep) {
-			scaleStep = 1.0 / smallestDimension;
+		else if (arg == "--transforms") {
+			if (i + 1 >= argc || !ReadCount(argv[++i], INT_MAX, number)) {
+				return StreamUsage("--transforms needs a number of copies");
+			}
+			settings.unitTransformVariants = (int)number;
 		}
-
-		/* we should not make any shapes where the lesser dimension of the shape will be just a few pixels */
-		/* Anything dimension that is less than 30 pixels might be too "grainy" to recognize */
-		if ((minScale * smallestDimension) < minPixelsAllowed) {
-			minScale = (double)minPixelsAllowed / smallestDimension;
+		else if (arg == "--unit-rotation") {
+			if (i + 1 >= argc || !ReadAmount(argv[++i], 180.0, settings.maxUnitRotationDegrees)) {
+				return StreamUsage("--unit-rotation needs degrees from 0 to 180");
+			}
 		}
-
-		if (enforceBorders) {
-			/* we should allow at least 10 pixels to border the picture */
-			int allowedBorder = (minPixelsAllowed / 2);
-			double border = (smallestDimension)-(smallestDimension * maxScale);
-			if (border < allowedBorder) {
-				maxScale = (smallestDimension - allowedBorder) / smallestDimension;
+		else if (arg == "--unit-stretch") {
+			if (i + 1 >= argc || !ReadAmount(argv[++i], 0.9, settings.maxUnitStretch)) {
+				return StreamUsage("--unit-stretch needs a share from 0 to 0.9");
 			}
 		}
-
-	}
-
-	/* helper function to easily get a unit pattern */
-	UnitPattern* GetUnitPattern(PatternType p, double* scaleSet) {
-		switch (p) {
-		case(SQUARE): { return new SquarePattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(RECTANGLE): { return new RectanglePattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(DIAMOND): { return new DiamondPattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(TRIANGLE): { return new TrianglePattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(HORIZONTAL_STRIPES): { return new HorizontalStripePattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(VERTICAL_STRIPES): { return new VerticalStripePattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(CIRCLE): { return new CirclePattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(HEXAGON): { return new HexagonPattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(PENTAGON): { return new PentagonPattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(HEPTAGON): { return new HeptagonPattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(STAR): { return new StarPattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(OCTAGON): { return new OctogonPattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(TRAPEZOID): { return new TrapezoidPattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(HEART): { return new HeartPattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(CROSS): { return new CrossPattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(CRESCENT): { return new CrescentPattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(SPIKE): { return new SpikePattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(ARROW): { return new ArrowPattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(TILDE): { return new TildePattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(ZIGZAG): { return new ZigzagPattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(CANE): { return new CanePattern(unitPatternHeight, unitPatternWidth, scaleSet); }
-		case(CAT): { return new CatPattern(unitPatternHeight, unitPatternWidth, scaleSet); }
+		else if (arg == "--unit-shear") {
+			if (i + 1 >= argc || !ReadAmount(argv[++i], 1.0, settings.maxUnitShear)) {
+				return StreamUsage("--unit-shear needs a shear from 0 to 1");
+			}
 		}
-		return nullptr;
-	}
-
-	/* function to determine how many unit patterns will fit in the pattern - needed to determine how large a combination is */
-	int GetNumberOfUnitPatternsPerPattern(const int &verticalOffset, const int &horizontalOffset) const {
-
-		double tUnitHeight = unitPatternHeight + verticalOffset;
-		double tUnitWidth = unitPatternWidth + horizontalOffset;
-
-		double tHeightUnits = (double)patternHeight / tUnitHeight;
-		double tWidthUnits = (double)patternWidth / tUnitWidth;
-
-		if (clipping) {
-			tHeightUnits = ceil(tHeightUnits);
-			tWidthUnits = ceil(tWidthUnits);
+		else if (arg == "--augment") {
+			if (i + 1 >= argc || !ReadCount(argv[++i], INT_MAX, number)) {
+				return StreamUsage("--augment needs a number of variants");
+			}
+			settings.augmentation.variantsPerPattern = (int)number;
 		}
-		else {
-			tHeightUnits = floor(tHeightUnits);
-			tWidthUnits = floor(tWidthUnits);
+		else if (arg == "--augment-keep-original") {
+			if (i + 1 >= argc || !ReadSwitch(argv[++i], settings.augmentation.keepOriginal)) {
+				return StreamUsage("--augment-keep-original needs true or false");
+			}
 		}
-		
-		return (int)(tHeightUnits * tWidthUnits);
-	}
-
-	/* function to generate pattern combinations to use when generating images */
-	Array<Array<int>> GetPatternCombinations(int pattern, const int& verticalOffset, const int& horizontalOffset) const {
-		int totalUnitsPerPattern = GetNumberOfUnitPatternsPerPattern(verticalOffset, horizontalOffset);
-		return SomeCombinations(unitPatternIndexes.at(pattern), totalUnitsPerPattern, percentageOfPatternsToKeep);
-	}
-
-	/* function to generate pattern combinations to use when generating images - this one has the percentage as a parameter */
-	Array<Array<int>> GetPatternCombinations(int pattern, const int& verticalOffset, const int& horizontalOffset, const double& perc) const {
-		int totalUnitsPerPattern = GetNumberOfUnitPatternsPerPattern(verticalOffset, horizontalOffset);
-		return SomeCombinations(unitPatternIndexes.at(pattern), totalUnitsPerPattern, perc);
-	}
-
-	/* function to generate an image based on a combination */
-	Pattern GetPattern(int pattern, const int& verticalOffset, const int& horizontalOffset, const Array<int>& combination) const {
-		return Pattern(patternList.at(pattern), patternHeight, patternWidth, verticalOffset, horizontalOffset, clipping, center, unitPatterns.at(pattern), combination);
-	}
-
-	/*******************************************
-	* GenerateAllUnitPatterns
-	********************************************
-	* function to generate all possible 
-	* unit patterns to use when generating
-	* images
-	*******************************************/
-	void GenerateAllUnitPatterns() {
-
-		/* Reset the object */
-		deallocateAllUnitPattens();
-
-		/* Get all scales to iterate through */
-		Array<double> scales;
-		for (double s = minScale; s < maxScale; s += scaleStep) {
-			scales.push(s);
+		else if (arg == "--augment-translation") {
+			if (i + 1 >= argc || !ReadCount(argv[++i], INT_MAX, number)) {
+				return StreamUsage("--augment-translation needs a number of pixels");
+			}
+			settings.augmentation.maxTranslation = (int)number;
 		}
-
-		/* honestly, not sure why this is here... gonna assume I was testing something */
-		/* scales.at(0) = 0.1; */
-
-		/* Set up an array to store all unit patterns */
-		for (int p = 0; p < patternList.getSize(); p++) {
-			Array<UnitPattern*> unitPatternSet;
-			unitPatterns.push(unitPatternSet);
+		else if (arg == "--augment-rotate90") {
+			if (i + 1 >= argc || !ReadSwitch(argv[++i], settings.augmentation.rotate90)) {
+				return StreamUsage("--augment-rotate90 needs true or false");
+			}
 		}
-
-		/* Make an array to store scales - will need enough space for maximum possible scales
-			- At the time of 2023-09-18, the max scales required for a unit pattern is 8 (octogon) 
-		*/
-		double* scaleForPattern = new double[maximumPossibleScales];
-
-		/* For all scales */
-		for (int i = 0; i < scales.getSize(); i++) {
-
-			/* default all scales to be the same
-				- This code my change for future iterations of the project
-			*/
-			for (int j = 0; j < maximumPossibleScales; j++) {
-				scaleForPattern[j] = scales[i];
+		else if (arg == "--augment-rotation") {
+			if (i + 1 >= argc || !ReadAmount(argv[++i], 180.0, settings.augmentation.maxRotationDegrees)) {
+				return StreamUsage("--augment-rotation needs degrees from 0 to 180");
 			}
-
-			/* Make a pattern for all pattern types that will be unique with any scale */
-			for (int p = 0; p < patternList.getSize(); p++) {
-				if (!SpecialProcessing(patternList[p])) {
-					unitPatterns[p].push(GetUnitPattern(patternList[p], scaleForPattern));
-				}
+		}
+		else if (arg == "--augment-flip-horizontal") {
+			if (i + 1 >= argc || !ReadSwitch(argv[++i], settings.augmentation.flipHorizontal)) {
+				return StreamUsage("--augment-flip-horizontal needs true or false");
 			}
-
-			/* Make a pattern for all pattern types that will NOT be unique with any scale */
-			/* This solution is obviously very hardcoded but will be necesarry for now */
-			int firstScale = 0, secondScale = 1, thirdScale = 2;
-			for (int p = 0; p < patternList.getSize(); p++) {
-				if (SpecialProcessing(patternList[p])) {
-					switch (patternList[p]) {
-					case(RECTANGLE): {
-						if (maximumPossibleScales > secondScale) {
-							scaleForPattern[secondScale] = 0.5 * scaleForPattern[firstScale];
-						}
-						break;
-					}
-					case(TRAPEZOID): {
-						if (maximumPossibleScales > thirdScale) {
-							scaleForPattern[secondScale] = 0.5 * scaleForPattern[firstScale];
-							scaleForPattern[thirdScale] = 0.5 * scaleForPattern[firstScale];
-						}
-						break;
-					}
-					case(CRESCENT): {
-						if (maximumPossibleScales > secondScale) {
-							scaleForPattern[secondScale] = 0.55;
-						}
-						break;
-					}
-					default: { break; }
-					}
-					unitPatterns[p].push(GetUnitPattern(patternList[p], scaleForPattern));
-				}
+		}
+		else if (arg == "--augment-flip-vertical") {
+			if (i + 1 >= argc || !ReadSwitch(argv[++i], settings.augmentation.flipVertical)) {
+				return StreamUsage("--augment-flip-vertical needs true or false");
 			}
 		}
-
-		for (int i = 0; i < unitPatterns.getSize(); i++) {
-			unitPatternIndexes.push(Array<int>());
-			for (int j = 0; j < unitPatterns[i].getSize(); j++) {
-				unitPatternIndexes[i].push(j);
+		else if (arg == "--augment-noise") {
+			if (i + 1 >= argc || !ReadAmount(argv[++i], 1.0, settings.augmentation.noiseProbability)) {
+				return StreamUsage("--augment-noise needs a probability from 0 to 1");
 			}
 		}
-
-		delete[] scaleForPattern;
+		else if (arg == "--augment-morphology") {
+			if (i + 1 >= argc || !ReadAmount(argv[++i], 1.0, settings.augmentation.morphologyProbability)) {
+				return StreamUsage("--augment-morphology needs a probability from 0 to 1");
+			}
+		}
+		else {
+			return StreamUsage("Unknown argument " + arg);
+		}
 	}
-
-public:
-	/* Parameter constructor */
-	PatternGenerator(
-		Array<PatternType> patternList
-		, int unitPatternWidth
-		, int unitPatternHeight
-		, int patternWidth
-		, int patternHeight
-		, double minScale
-		, double scaleStep
-		, double maxScale
-		, int allowedNumberOfScales
-		, string outputDirectory
-		, bool clipping = false
-		, bool center = true
-		, double percentageOfPatternsToKeep = 0.01
-		, bool smartScaleDetection = false
-		, bool enforceBorderRequirements = false
-	) : patternList(patternList), unitPatternWidth(unitPatternWidth), unitPatternHeight(unitPatternHeight)
-		, patternWidth(patternWidth), patternHeight(patternHeight), minScale(minScale), scaleStep(scaleStep)
-		, maxScale(maxScale), outputDirectory(outputDirectory), allowedNumberOfScales(allowedNumberOfScales)
-		, clipping(clipping), center(center), percentageOfPatternsToKeep(percentageOfPatternsToKeep)
-	{
-		cleanAndStandardizeMembers(smartScaleDetection, enforceBorderRequirements);
-		allowedNumberOfScales = 1; /* Not going to incorporate multiple scales just yet. */
-		dataFile.open(outputDirectory + "data.csv");
-		dataFile.close();
-		GenerateAllUnitPatterns();
+	if (destinations.getSize() == 0) {
+		destinations.push("-");
 	}
 
-	/* destructor */
-	~PatternGenerator() {
-		deallocateAllUnitPattens();
+#ifdef _WIN32
+	_setmode(_fileno(stdout), _O_BINARY);
+#else
+	/* a reader going away should drop that destination, not kill the generator */
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	PatternStream stream(settings);
+
+	int numberOfDestinations = destinations.getSize();
+	FILE** files = new FILE*[numberOfDestinations];
+	RecordStreamWriter** writers = new RecordStreamWriter*[numberOfDestinations];
+	string* classNames = new string[stream.GetNumberOfClasses()];
+	for (int i = 0; i < stream.GetNumberOfClasses(); i++) {
+		classNames[i] = stream.GetClassName(i);
 	}
 
-	/* function to generate a data set */
-	void MakePatterns(bool makeBMPs, bool saveToFile) {
-		
-		if (saveToFile) {
-			dataFile.open(outputDirectory + "data.csv", ios_base::app);
+	int open = 0;
+	for (int i = 0; i < numberOfDestinations; i++) {
+		files[i] = (destinations[i] == "-") ? stdout : fopen(destinations[i].c_str(), "wb");
+		writers[i] = nullptr;
+		if (files[i] == nullptr) {
+			cerr << "Unable to open " << destinations[i] << " for the record stream" << endl;
+			continue;
 		}
-
-		unsigned int verticalOffset = 0;
-		unsigned int horizontalOffset = 0;
-
-		/* determine the number of vertical offsets to use */
-		double pd = patternHeight;
-		double upd = unitPatternHeight;
-		int totalFit = patternHeight / unitPatternHeight;
-		unsigned int verticalSteps = (totalFit > 1) ? ceil((((pd / 2.0) + 1.0) - upd)) : 0;
-
-		/* determine the number of horizontal offsets to use */
-		pd = patternWidth;
-		upd = unitPatternWidth;
-		totalFit = patternWidth / unitPatternWidth;
-		unsigned int horizontalSteps = (totalFit > 1) ? ceil((((pd / 2.0) + 1.0) - upd)) : 0;
-
-		int tImgs = 0; /* total images */
-		/* for all vertical offset */
-		for(verticalOffset = 0; verticalOffset <= verticalSteps; verticalOffset += 1){
-			/* for all horizontal offset */
-			for (horizontalOffset = 0; horizontalOffset <= horizontalSteps; horizontalOffset += 1) {
-				/* for each pattern */
-				for (int currentPattern = 0; currentPattern < patternList.getSize(); currentPattern++) {
-					/* Generate the possible combinations */
-					Array<Array<int>> allCombinations = GetPatternCombinations(currentPattern, verticalOffset, horizontalOffset);
-					string outputFile;
-					string currentPatternString = GetNameForPattern(patternList.at(currentPattern));
-					/* For all combinations */
-					for (int i = 0; i < allCombinations.getSize(); i++) {
-						/* Generate a pattern */
-						Pattern p = GetPattern(currentPattern, verticalOffset, horizontalOffset, allCombinations[i]);
-						if (makeBMPs) {
-							outputFile = outputDirectory + currentPatternString + "_" + to_string(tImgs) + ".bmp";
-							p.SavePatternToBmp(outputFile);
-						}
-						if (saveToFile) {
-							dataFile << p.GetRawDataAsString() << endl;
-						}
-						tImgs += 1;
-					}
-				}
-			}
-		}
-
-		if (saveToFile) {
-			dataFile.close();
+		writers[i] = new RecordStreamWriter(files[i]);
+		if (!writers[i]->WriteHeader(stream.GetHeight(), stream.GetWidth(), stream.GetBytesPerRecord(), stream.GetNumberOfClasses(), classNames)) {
+			delete writers[i];
+			writers[i] = nullptr;
+			continue;
 		}
+		open += 1;
 	}
 
-	/* helper function to generate sample images for the paper
-		- Same as above except instead of generating all combinations, it just
-		picks a random sample to generate
-	*/
-	void MakePatternSamples(bool makeBMPs, bool saveToFile) {
-
-		if (saveToFile) {
-			dataFile.open(outputDirectory + "data.csv", ios_base::app);
+	const int batchSize = 256;
+	unsigned int* classIds = new unsigned int[batchSize];
+	unsigned char* packed = new unsigned char[(size_t)batchSize * stream.GetBytesPerRecord()];
+	unsigned long long written = 0;
+	while (open > 0) {
+		int wanted = batchSize;
+		if (settings.randomSampling && randomCount > 0 && randomCount - written < (unsigned long long)batchSize) {
+			wanted = (int)(randomCount - written);
 		}
-
-		unsigned int verticalOffset = 0;
-		unsigned int horizontalOffset = 0;
-
-		double pd = patternHeight;
-		double upd = unitPatternHeight;
-		int totalFit = patternHeight / unitPatternHeight;
-		unsigned int verticalSteps = (totalFit > 1) ? ceil((((pd / 2.0) + 1.0) - upd)) : 0;
-
-		pd = patternWidth;
-		upd = unitPatternWidth;
-		totalFit = patternWidth / unitPatternWidth;
-		unsigned int horizontalSteps = (totalFit > 1) ? ceil((((pd / 2.0) + 1.0) - upd)) : 0;
-
-		cout << verticalSteps << " , " << horizontalSteps << endl;
-
-		int tImgs = 0;
-		for (verticalOffset = 0; verticalOffset <= verticalSteps; verticalOffset += 1) {
-			for (horizontalOffset = 0; horizontalOffset <= horizontalSteps; horizontalOffset += 1) {
-				for (int currentPattern = 0; currentPattern < patternList.getSize(); currentPattern++) {
-					int totalUnitsPerPattern = GetNumberOfUnitPatternsPerPattern(verticalOffset, horizontalOffset);
-					double percToKeep = 1.0;
-					if (totalUnitsPerPattern >= 9) {
-						percToKeep = 0.0001;
-					}
-					else if (totalUnitsPerPattern >= 6) {
-						percToKeep = 0.01;
-					}
-					Array<Array<int>> allCombinations = GetPatternCombinations(currentPattern, verticalOffset, horizontalOffset, percToKeep);
-					string outputFile;
-					string currentPatternString = GetNameForPattern(patternList.at(currentPattern));
-					if (allCombinations.getSize() > 0) {
-						int randomSample = rand() % allCombinations.getSize();
-						Pattern p = GetPattern(currentPattern, verticalOffset, horizontalOffset, allCombinations[randomSample]);
-						if (makeBMPs) {
-							outputFile = outputDirectory + currentPatternString + "_" + to_string(tImgs) + ".bmp";
-							p.SavePatternToBmp(outputFile);
-						}
-						if (saveToFile) {
-							dataFile << p.GetRawDataAsString() << endl;
-						}
-						tImgs += 1;
-					}
-				}
-			}
+		int count = (wanted > 0) ? stream.NextBatch(wanted, classIds, packed) : 0;
+		if (count == 0) {
+			break;
 		}
-
-		if (saveToFile) {
-			dataFile.close();
+		for (int i = 0; i < numberOfDestinations; i++) {
+			if (writers[i] != nullptr && !writers[i]->WriteBatch(count, classIds, packed)) {
+				cerr << "Record stream to " << destinations[i] << " closed" << endl;
+				delete writers[i];
+				writers[i] = nullptr;
+				open -= 1;
+			}
 		}
+		written += count;
 	}
 
-	/* helper function to generate all unit pattern images for viewing */
-	void SaveUnitPatternPNGs() {
-		string outputFile;
-		int tImgs = 0;
-		for (int p = 0; p < patternList.getSize(); p++) {
-			string currentPattern = GetNameForPattern(patternList[p]);
-			for (int i = 0; i < unitPatterns[p].getSize(); i++) {
-				UnitPattern* up = unitPatterns[p][i];
-				outputFile = outputDirectory + currentPattern + "_" + to_string(tImgs) + ".bmp";
-				Pattern p = Pattern(up->GetPatternType(), unitPatternHeight, unitPatternWidth, 0, 0, clipping, center, up);
-				p.SavePatternToBmp(outputFile);
-				tImgs += 1;
-			}
+	for (int i = 0; i < numberOfDestinations; i++) {
+		if (writers[i] != nullptr) {
+			writers[i]->Finish();
+			delete writers[i];
+		}
+		if (files[i] != nullptr && files[i] != stdout) {
+			fclose(files[i]);
 		}
 	}
-};
+	cerr << "Streamed " << written << " records" << endl;
+
+	delete[] classIds;
+	delete[] packed;
+	delete[] classNames;
+	delete[] writers;
+	delete[] files;
+	return 0;
+}
 
-int main()
+int main(int argc, char** argv)
 {
 	Array<PatternType> patternList;
 	patternList.push(SQUARE);
@@ -454,6 +310,24 @@ int main()
 	patternList.push(CANE);
 	patternList.push(CAT);
 
+	// "PatternGenerator --stream ..." writes a record stream instead of data.csv (see StreamRecords)
+	if (argc >= 2 && string(argv[1]) == "--stream") {
+		string* classNames = new string[patternList.getSize()];
+		for (int i = 0; i < patternList.getSize(); i++) {
+			classNames[i] = GetNameForPattern(patternList[i]);
+		}
+		PatternStreamSettings settings;
+		settings.classNames = classNames;
+		settings.numberOfClasses = patternList.getSize();
+		settings.unitPatternHeight = 50;
+		settings.unitPatternWidth = 50;
+		settings.patternHeight = 65;	// the csv PatternGenerator below takes width first, so its images are 465 wide and 65 high
+		settings.patternWidth = 465;
+		int result = StreamRecords(settings, argc - 2, argv + 2);
+		delete[] classNames;
+		return result;
+	}
+
 	PatternGenerator pg(
 		patternList
 		, 50	// Unit Pattern height
@@ -0,0 +1,269 @@
+#include "PatternStream.h"
+#include "PatternGenerator.h"
+#include <random>
+#include <cstring>
+
+using namespace std;
+
+/************************************************************
+#############################################################
+#   Pattern Stream State
+#############################################################
+#
+#   The generator plus a cursor into the data set. The cursor
+#	walks vertical offset -> horizontal offset -> pattern ->
+#	combination, the same order MakePatterns uses.
+************************************************************/
+struct PatternStreamState {
+	PatternGenerator* generator = nullptr;	/* generator that owns all the unit patterns */
+
+	unsigned int verticalSteps = 0;			/* number of vertical offsets in the data set */
+	unsigned int horizontalSteps = 0;		/* number of horizontal offsets in the data set */
+
+	unsigned int verticalOffset = 0;		/* current vertical offset */
+	unsigned int horizontalOffset = 0;		/* current horizontal offset */
+	int currentPattern = -1;				/* current class - starts before the first one */
+
+	Array<Array<int>> combinations;			/* combinations for the current offsets and class */
+	int currentCombination = 0;				/* next combination to generate */
+
+	bool finished = false;					/* has the whole data set been handed out */
+
+	bool randomSampling = false;			/* draw records at random instead of walking the data set */
+	unsigned int seed = 0;					/* seed the random engine starts from (and returns to on Reset) */
+	default_random_engine engine;			/* random engine for sampling */
+
+	PatternAugmenter* augmenter = nullptr;	/* makes the variants - null when augmentation is off */
+	unsigned char* base = nullptr;			/* packed pattern the variants are made from */
+	unsigned int baseClass = 0;				/* class of base */
+	int variantsRemaining = 0;				/* variants of base still to hand out */
+
+	/* moves the cursor to the next combination that exists - returns false at the end of the data set */
+	bool Advance() {
+		while (!finished && currentCombination >= combinations.getSize()) {
+			currentPattern += 1;
+			if (currentPattern >= generator->GetNumberOfPatternTypes()) {
+				currentPattern = 0;
+				horizontalOffset += 1;
+				if (horizontalOffset > horizontalSteps) {
+					horizontalOffset = 0;
+					verticalOffset += 1;
+					if (verticalOffset > verticalSteps) {
+						finished = true;
+						break;
+					}
+				}
+			}
+			combinations = generator->GetPatternCombinations(currentPattern, verticalOffset, horizontalOffset);
+			currentCombination = 0;
+		}
+		return !finished;
+	}
+
+	/* picks a random class, offsets and combination - returns false if no class has any unit patterns */
+	bool Sample() {
+		int numberOfPatterns = generator->GetNumberOfPatternTypes();
+		for (int attempt = 0; attempt < numberOfPatterns; attempt++) {
+			currentPattern = engine() % numberOfPatterns;
+			int numberOfUnits = generator->GetNumberOfUnitPatterns(currentPattern);
+			if (numberOfUnits == 0) {
+				continue;
+			}
+			verticalOffset = engine() % (verticalSteps + 1);
+			horizontalOffset = engine() % (horizontalSteps + 1);
+			int unitsPerPattern = generator->GetNumberOfUnitPatternsPerPattern(verticalOffset, horizontalOffset);
+			Array<int> combination;
+			for (int i = 0; i < unitsPerPattern; i++) {
+				combination.push(engine() % numberOfUnits);
+			}
+			combinations.reset();
+			combinations.push(combination);
+			currentCombination = 0;
+			return true;
+		}
+		return false;
+	}
+
+	/* puts the cursor back at the start of the data set */
+	void Reset() {
+		generator->GetOffsetSteps(verticalSteps, horizontalSteps);
+		verticalOffset = 0;
+		horizontalOffset = 0;
+		currentPattern = -1;
+		combinations.reset();
+		currentCombination = 0;
+		finished = (generator->GetNumberOfPatternTypes() == 0);
+		engine.seed(seed);
+		variantsRemaining = 0;
+		if (augmenter != nullptr) {
+			augmenter->Seed(seed);
+		}
+	}
+};
+
+/**************************************************************
+* PatternStream constructor
+***************************************************************
+* Classes that are not recognized are reported and skipped
+**************************************************************/
+PatternStream::PatternStream(const PatternStreamSettings& settings) {
+	Array<PatternType> patternList;
+	for (int i = 0; i < settings.numberOfClasses; i++) {
+		PatternType pt = GetPatternForName(settings.classNames[i]);
+		if (pt == DEFAULT_PATTERN) {
+			cerr << "PatternStream: unknown pattern class \"" << settings.classNames[i] << "\" - skipping" << endl;
+			continue;
+		}
+		patternList.push(pt);
+	}
+
+	/* random transforms for the unit pattern copies - always the same ones for a seed */
+	Array<AffineTransform> unitTransforms;
+	default_random_engine transformEngine(settings.seed);
+	uniform_real_distribution<double> unit(-1.0, 1.0);
+	for (int i = 0; i < settings.unitTransformVariants; i++) {
+		double degrees = unit(transformEngine) * settings.maxUnitRotationDegrees;
+		double stretchY = 1.0 + (unit(transformEngine) * settings.maxUnitStretch);
+		double stretchX = 1.0 + (unit(transformEngine) * settings.maxUnitStretch);
+		double shearY = unit(transformEngine) * settings.maxUnitShear;
+		double shearX = unit(transformEngine) * settings.maxUnitShear;
+		unitTransforms.push(AffineTransform::Rotation(degrees) * AffineTransform::Shear(shearY, shearX) * AffineTransform::Scale(stretchY, stretchX));
+	}
+
+	state = new PatternStreamState;
+	state->generator = new PatternGenerator(
+		patternList
+		, settings.unitPatternWidth
+		, settings.unitPatternHeight
+		, settings.patternWidth
+		, settings.patternHeight
+		, settings.minScale
+		, settings.scaleStep
+		, settings.maxScale
+		, 1		/* scales allowed */
+		, ""	/* nothing is written to disk */
+		, settings.clipping
+		, settings.center
+		, settings.percentageOfPatternsToKeep
+		, settings.smartScaleDetection
+		, settings.enforceBorderRequirements
+		, unitTransforms
+	);
+
+	state->randomSampling = settings.randomSampling;
+	state->seed = settings.seed;
+
+	height = state->generator->GetPatternHeight();
+	width = state->generator->GetPatternWidth();
+	bytesPerRecord = ((height * width) + 7) / 8;
+
+	if (settings.augmentation.variantsPerPattern > 0) {
+		state->augmenter = new PatternAugmenter(settings.augmentation, height, width, settings.seed);
+		state->base = new unsigned char[bytesPerRecord];
+	}
+
+	state->Reset();
+}
+
+/* destructor */
+PatternStream::~PatternStream() {
+	if (state != nullptr) {
+		delete state->generator;
+		delete state->augmenter;
+		delete[] state->base;
+		delete state;
+		state = nullptr;
+	}
+}
+
+/* accessor for the number of classes */
+int PatternStream::GetNumberOfClasses() const {
+	return state->generator->GetNumberOfPatternTypes();
+}
+
+/* accessor for the name of a class id */
+string PatternStream::GetClassName(const unsigned int& classId) const {
+	if ((int)classId >= state->generator->GetNumberOfPatternTypes()) {
+		return "";
+	}
+	return GetNameForPattern(state->generator->GetPatternType(classId));
+}
+
+/* accessor for the number of unit patterns (all scales and copies) of a class id */
+int PatternStream::GetNumberOfUnitPatterns(const unsigned int& classId) const {
+	if ((int)classId >= state->generator->GetNumberOfPatternTypes()) {
+		return 0;
+	}
+	return state->generator->GetNumberOfUnitPatterns(classId);
+}
+
+/* start over from the first record */
+void PatternStream::Reset() {
+	state->Reset();
+}
+
+/**************************************************************
+* NextBatch
+***************************************************************
+* Generates up to maxRecords patterns into the caller's buffers.
+* Variants of a pattern can carry over into the next batch.
+**************************************************************/
+int PatternStream::NextBatch(const int& maxRecords, unsigned int classIds[], unsigned char packedPixels[]) {
+	int records = 0;
+	while (records < maxRecords) {
+		unsigned char* out = packedPixels + ((size_t)records * bytesPerRecord);
+
+		/* finish the variants of the last pattern first */
+		if (state->variantsRemaining > 0) {
+			state->augmenter->Augment(state->base, out);
+			classIds[records] = state->baseClass;
+			state->variantsRemaining -= 1;
+			records += 1;
+			continue;
+		}
+
+		if (!((state->randomSampling) ? state->Sample() : state->Advance())) {
+			break;
+		}
+		Pattern p = state->generator->GetPattern(state->currentPattern, state->verticalOffset, state->horizontalOffset, state->combinations[state->currentCombination]);
+		state->currentCombination += 1;
+
+		if (state->augmenter == nullptr) {
+			classIds[records] = state->currentPattern;
+			p.GetPackedData(out);
+			records += 1;
+			continue;
+		}
+
+		p.GetPackedData(state->base);
+		state->baseClass = state->currentPattern;
+		state->variantsRemaining = state->augmenter->GetVariantsPerPattern();
+		if (state->augmenter->KeepOriginal()) {
+			memcpy(out, state->base, bytesPerRecord);
+			classIds[records] = state->baseClass;
+			records += 1;
+		}
+	}
+	return records;
+}
+
+/**************************************************************
+* ForEach
+***************************************************************
+* Push interface - every remaining record is handed to the
+* callback one at a time until the data set runs out or the
+* callback returns false
+**************************************************************/
+int PatternStream::ForEach(PatternStreamCallback callback, void* userData) {
+	unsigned int classId = 0;
+	unsigned char* record = new unsigned char[bytesPerRecord];
+	int records = 0;
+	while (NextBatch(1, &classId, record) == 1) {
+		records += 1;
+		if (!callback(classId, record, userData)) {
+			break;
+		}
+	}
+	delete[] record;
+	return records;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <string>
+#include "Augmentation.h"
+
+using namespace std;
+
+/************************************************************
+#############################################################
+#   Pattern Stream Settings
+#############################################################
+#
+#   Everything needed to describe the data set a stream
+#	will produce. Mirrors the PatternGenerator constructor.
+#
+#	Classes are given by name (see GetNameForPattern) so
+#	programs using the stream never need the generator
+#	headers.
+************************************************************/
+struct PatternStreamSettings {
+	const string* classNames = nullptr;		/* names of the classes to generate - only read during construction */
+	int numberOfClasses = 0;				/* number of names in classNames */
+
+	int unitPatternWidth = 50;				/* size of the units */
+	int unitPatternHeight = 50;				/* size of the units */
+	int patternWidth = 50;					/* size of the images */
+	int patternHeight = 50;					/* size of the images */
+
+	double minScale = 0.2;					/* used to control how small a unit can be */
+	double scaleStep = 0.3;					/* used to change the scale to generate unique units */
+	double maxScale = 0.97;					/* used to control how large a unit can be */
+
+	bool clipping = false;					/* can the units be clipped off the edge */
+	bool center = true;						/* are the images centered */
+	double percentageOfPatternsToKeep = 1.0;	/* percentage of unit combinations to actually generate */
+	bool smartScaleDetection = false;		/* let the generator pick the scales */
+	bool enforceBorderRequirements = false;	/* keep a border around every unit */
+
+	int unitTransformVariants = 0;			/* rotated/stretched/sheared copies of every unit pattern (drawn from the seed) */
+	double maxUnitRotationDegrees = 0.0;	/* largest rotation of a copy either way */
+	double maxUnitStretch = 0.0;			/* largest change in size along each axis (0.1 = 90% to 110%) */
+	double maxUnitShear = 0.0;				/* largest shear along each axis */
+
+	bool randomSampling = false;			/* draw random records forever instead of walking the data set once */
+	unsigned int seed = 0;					/* seed for random sampling and augmentation */
+
+	AugmentationSettings augmentation;		/* optional random variants of every pattern - off by default */
+};
+
+/* callback for the push based interface - return false to stop the stream early */
+typedef bool (*PatternStreamCallback)(const unsigned int& classId, const unsigned char* packedPixels, void* userData);
+
+/* generator state lives in PatternStream.cpp so it stays out of this header */
+struct PatternStreamState;
+
+/************************************************************
+#############################################################
+#   Pattern Stream Class
+#############################################################
+#
+#   Produces the same records as PatternGenerator::MakePatterns
+#	(same order) but hands them to the caller in memory
+#	instead of writing data.csv.
+#
+#	Records are a class id plus the image packed 8 pixels
+#	to a byte in row-major order (pixel i is bit (i % 8)
+#	of byte (i / 8)). Class ids index the stream's class
+#	list - see GetClassName.
+#
+#	Pull: NextBatch fills caller-provided buffers
+#	Push: ForEach hands each record to a callback
+#
+#	With randomSampling on, every record is drawn at random
+#	(class, offsets and the unit in every slot) and the
+#	stream never runs out.
+#
+#	With augmentation.variantsPerPattern = K every generated
+#	pattern is followed by K augmented variants (see
+#	PatternAugmenter), all with the pattern's class.
+************************************************************/
+class PatternStream {
+private:
+	PatternStreamState* state = nullptr;	/* the generator and where the stream is in the data set */
+	int height = 0;							/* height of every image in the stream */
+	int width = 0;							/* width of every image in the stream */
+	int bytesPerRecord = 0;					/* size of one packed image */
+
+public:
+	/* a stream always needs settings and owns its generator */
+	PatternStream() = delete;
+	PatternStream(const PatternStream& copy) = delete;
+	void operator=(const PatternStream& copy) = delete;
+
+	/* builds every unit pattern up front - the stream is ready to read once this returns */
+	PatternStream(const PatternStreamSettings& settings);
+
+	/* destructor */
+	~PatternStream();
+
+	/* accessors */
+	int GetHeight() const { return height; }
+	int GetWidth() const { return width; }
+	int GetBytesPerRecord() const { return bytesPerRecord; }
+	int GetNumberOfClasses() const;
+	string GetClassName(const unsigned int& classId) const;
+	int GetNumberOfUnitPatterns(const unsigned int& classId) const;		/* 0 means the class can never be generated */
+
+	/* start over from the first record */
+	void Reset();
+
+	/**************************************************************
+	* NextBatch
+	***************************************************************
+	* Generates up to maxRecords patterns. classIds must hold
+	* maxRecords ids and packedPixels must hold maxRecords *
+	* GetBytesPerRecord() bytes. Returns the number of records
+	* written - 0 once the data set is exhausted (never happens
+	* when sampling at random).
+	**************************************************************/
+	int NextBatch(const int& maxRecords, unsigned int classIds[], unsigned char packedPixels[]);
+
+	/* hands every remaining record to the callback - returns the number of records handed out
+	*  (when sampling at random this only ends when the callback returns false) */
+	int ForEach(PatternStreamCallback callback, void* userData);
+
+	/* helper to expand one packed record to 0.0/1.0 values */
+	static void UnpackRecord(const unsigned char* packedPixels, const int& totalPixels, double* out) {
+		for (int i = 0; i < totalPixels; i++) {
+			out[i] = (packedPixels[i >> 3] >> (i & 7)) & 1;
+		}
+	}
+};
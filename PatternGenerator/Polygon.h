@@ -16,7 +16,7 @@ using namespace std;
 * 
 * if 0.5 or above, round up. If < 0.5, round down.
 **************************************************************/
-int RoundDouble(double d) {
+inline int RoundDouble(double d) {
 	int i = d;
 	double decimal = d - i;
 	return (decimal >= 0.5) ? i + 1 : i;
@@ -503,3 +503,85 @@ public:
 	}
 
 };
+
+/************************************************************
+#############################################################
+#   Affine Transform Class
+#############################################################
+#
+#   Linear transform applied to the vertices of a unit 
+#	pattern around its center before it is rasterized 
+#	(rotation, stretching along either axis and shear).
+#
+#	A point (y, x) relative to the center becomes:
+#		x' = (xx * x) + (xy * y)
+#		y' = (yx * x) + (yy * y)
+#
+#	Transforms combine with *, the right hand side is 
+#	applied first.
+************************************************************/
+class AffineTransform {
+public:
+	double xx = 1.0, xy = 0.0;	/* row for the new x */
+	double yx = 0.0, yy = 1.0;	/* row for the new y */
+
+	/* default constructor - identity */
+	AffineTransform() { }
+
+	/* parameter constructor */
+	AffineTransform(double xx, double xy, double yx, double yy) : xx(xx), xy(xy), yx(yx), yy(yy) { }
+
+	/* rotation - positive degrees turn clockwise on the image (y grows downward) */
+	static AffineTransform Rotation(double degrees) {
+		double radians = (degrees * 3.141592653589793) / 180.0;
+		double c = cos(radians);
+		double s = sin(radians);
+		return AffineTransform(c, -s, s, c);
+	}
+
+	/* stretch along each axis */
+	static AffineTransform Scale(double scaleY, double scaleX) {
+		return AffineTransform(scaleX, 0.0, 0.0, scaleY);
+	}
+
+	/* shear - x moves by shearX * y and y moves by shearY * x */
+	static AffineTransform Shear(double shearY, double shearX) {
+		return AffineTransform(1.0, shearX, shearY, 1.0);
+	}
+
+	/* combine - t is applied first, then this */
+	AffineTransform operator*(const AffineTransform& t) const {
+		return AffineTransform(
+			(xx * t.xx) + (xy * t.yx), (xx * t.xy) + (xy * t.yy)
+			, (yx * t.xx) + (yy * t.yx), (yx * t.xy) + (yy * t.yy)
+		);
+	}
+
+	/* the identity leaves the original rasterization alone */
+	bool IsIdentity() const {
+		return xx == 1.0 && xy == 0.0 && yx == 0.0 && yy == 1.0;
+	}
+
+	/* transforms the point (y, x) around the point (centerY, centerX) */
+	void Apply(double y, double x, double centerY, double centerX, double& outY, double& outX) const {
+		double dy = y - centerY;
+		double dx = x - centerX;
+		outX = centerX + (xx * dx) + (xy * dy);
+		outY = centerY + (yx * dx) + (yy * dy);
+	}
+
+	/* inverse transform - returns false if the transform flattens everything to a line */
+	bool Invert(AffineTransform& inverse) const {
+		double determinant = (xx * yy) - (xy * yx);
+		if (fabs(determinant) < 1e-12) {
+			return false;
+		}
+		inverse = AffineTransform(yy / determinant, -xy / determinant, -yx / determinant, xx / determinant);
+		return true;
+	}
+
+	/* to string function for debugging */
+	string ToString() const {
+		return "[" + to_string(xx) + " " + to_string(xy) + " ; " + to_string(yx) + " " + to_string(yy) + "]";
+	}
+};
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+/************************************************************
+#############################################################
+#   Record Stream Format
+#############################################################
+#
+#   Framed binary form of a PatternStream so records can be
+#	piped between processes (generator | trainer) instead of
+#	staged in data.csv. All integers are uint32 in the host
+#	byte order.
+#
+#	Header:
+#		"PGRS" magic, version, height, width, bytesPerRecord,
+#		numberOfClasses, then for every class its name as a
+#		length followed by that many characters
+#
+#	Batches (repeated):
+#		count, count class ids, count packed records of
+#		bytesPerRecord bytes each (same packing as
+#		PatternStream). A count of 0 ends the stream.
+#
+#	Only needs the standard library so either program can
+#	include it.
+************************************************************/
+const char RECORD_STREAM_MAGIC[4] = { 'P', 'G', 'R', 'S' };
+const uint32_t RECORD_STREAM_VERSION = 1;
+
+/************************************************************
+#############################################################
+#   Record Stream Writer Class
+#############################################################
+#
+#   Writes the header once and then batches. Every write
+#	returns false once the destination stops accepting data
+#	(for example the reading end of a pipe closed).
+************************************************************/
+class RecordStreamWriter {
+private:
+	FILE* file = nullptr;		/* destination - not owned */
+	uint32_t bytesPerRecord = 0;	/* size of one packed record */
+
+	bool WriteUint(const uint32_t& value) {
+		return fwrite(&value, sizeof(uint32_t), 1, file) == 1;
+	}
+
+public:
+	RecordStreamWriter(FILE* file) : file(file) {}
+
+	/* writes the header - must come before any batch */
+	bool WriteHeader(const int& height, const int& width, const int& bytesPerRecord, const int& numberOfClasses, const string classNames[]) {
+		this->bytesPerRecord = bytesPerRecord;
+		if (fwrite(RECORD_STREAM_MAGIC, 1, 4, file) != 4) {
+			return false;
+		}
+		bool ok = WriteUint(RECORD_STREAM_VERSION)
+			&& WriteUint(height)
+			&& WriteUint(width)
+			&& WriteUint(bytesPerRecord)
+			&& WriteUint(numberOfClasses);
+		for (int i = 0; ok && i < numberOfClasses; i++) {
+			ok = WriteUint(classNames[i].size())
+				&& fwrite(classNames[i].data(), 1, classNames[i].size(), file) == classNames[i].size();
+		}
+		return ok;
+	}
+
+	/* writes one batch of count records - count must be greater than 0 */
+	bool WriteBatch(const uint32_t& count, const unsigned int classIds[], const unsigned char packedPixels[]) {
+		if (count == 0) {
+			return true;
+		}
+		if (!WriteUint(count)) {
+			return false;
+		}
+		for (uint32_t i = 0; i < count; i++) {
+			if (!WriteUint(classIds[i])) {
+				return false;
+			}
+		}
+		size_t bytes = (size_t)count * bytesPerRecord;
+		return fwrite(packedPixels, 1, bytes, file) == bytes;
+	}
+
+	/* writes the end marker and flushes */
+	bool Finish() {
+		bool ok = WriteUint(0);
+		return (fflush(file) == 0) && ok;
+	}
+};
+/************************************************************
+* ///////////////////////////|\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\
+* \\\\\\\\\\\\\\\\\\\\\\\\\\\|///////////////////////////////
+************************************************************/
+
+
+/************************************************************
+#############################################################
+#   Record Stream Reader Class
+#############################################################
+#
+#   Reads a stream written by RecordStreamWriter. Batch
+#	framing is hidden - ReadRecords hands out any number of
+#	records regardless of how the writer batched them.
+************************************************************/
+class RecordStreamReader {
+private:
+	FILE* file = nullptr;			/* source - not owned */
+	uint32_t height = 0;			/* height of every image */
+	uint32_t width = 0;				/* width of every image */
+	uint32_t bytesPerRecord = 0;	/* size of one packed record */
+	uint32_t numberOfClasses = 0;	/* number of class names */
+	string* classNames = nullptr;	/* name of every class id */
+
+	uint32_t remainingInBatch = 0;	/* records left in the batch being read */
+	uint32_t* batchClassIds = nullptr;	/* class ids of the batch being read */
+	uint32_t batchCapacity = 0;		/* size of batchClassIds */
+	uint32_t batchPosition = 0;		/* next class id to hand out */
+	bool finished = false;			/* end marker (or a broken stream) seen */
+
+	bool ReadUint(uint32_t& value) {
+		return fread(&value, sizeof(uint32_t), 1, file) == 1;
+	}
+
+	/* reads the next batch header and its class ids */
+	bool NextBatch() {
+		uint32_t count = 0;
+		if (!ReadUint(count) || count == 0) {
+			finished = true;
+			return false;
+		}
+		if (count > batchCapacity) {
+			delete[] batchClassIds;
+			batchClassIds = new uint32_t[count];
+			batchCapacity = count;
+		}
+		if (fread(batchClassIds, sizeof(uint32_t), count, file) != count) {
+			finished = true;
+			return false;
+		}
+		remainingInBatch = count;
+		batchPosition = 0;
+		return true;
+	}
+
+public:
+	RecordStreamReader(FILE* file) : file(file) {}
+	RecordStreamReader(const RecordStreamReader& copy) = delete;
+	void operator=(const RecordStreamReader& copy) = delete;
+
+	~RecordStreamReader() {
+		delete[] classNames;
+		delete[] batchClassIds;
+	}
+
+	/* reads and checks the header - returns false if this is not a record stream */
+	bool ReadHeader() {
+		char magic[4];
+		uint32_t version = 0;
+		if (fread(magic, 1, 4, file) != 4 || memcmp(magic, RECORD_STREAM_MAGIC, 4) != 0) {
+			return false;
+		}
+		if (!ReadUint(version) || version != RECORD_STREAM_VERSION) {
+			return false;
+		}
+		if (!ReadUint(height) || !ReadUint(width) || !ReadUint(bytesPerRecord) || !ReadUint(numberOfClasses)) {
+			return false;
+		}
+		if (bytesPerRecord != ((height * width) + 7) / 8) {
+			return false;
+		}
+		delete[] classNames;
+		classNames = new string[numberOfClasses];
+		for (uint32_t i = 0; i < numberOfClasses; i++) {
+			uint32_t length = 0;
+			if (!ReadUint(length)) {
+				return false;
+			}
+			classNames[i].resize(length);
+			if (length > 0 && fread(&classNames[i][0], 1, length, file) != length) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/* accessors - valid after ReadHeader */
+	int GetHeight() const { return height; }
+	int GetWidth() const { return width; }
+	int GetBytesPerRecord() const { return bytesPerRecord; }
+	int GetNumberOfClasses() const { return numberOfClasses; }
+	string GetClassName(const unsigned int& classId) const { return (classId < numberOfClasses) ? classNames[classId] : ""; }
+
+	/**************************************************************
+	* ReadRecords
+	***************************************************************
+	* Reads up to maxRecords records into the caller's buffers
+	* (same layout as PatternStream::NextBatch). Returns the
+	* number read - 0 once the stream has ended.
+	**************************************************************/
+	int ReadRecords(const int& maxRecords, unsigned int classIds[], unsigned char packedPixels[]) {
+		int records = 0;
+		while (records < maxRecords && !finished) {
+			if (remainingInBatch == 0 && !NextBatch()) {
+				break;
+			}
+			uint32_t take = (uint32_t)(maxRecords - records);
+			if (take > remainingInBatch) {
+				take = remainingInBatch;
+			}
+			size_t bytes = (size_t)take * bytesPerRecord;
+			if (fread(packedPixels + ((size_t)records * bytesPerRecord), 1, bytes, file) != bytes) {
+				finished = true;
+				break;
+			}
+			for (uint32_t i = 0; i < take; i++) {
+				classIds[records + i] = batchClassIds[batchPosition + i];
+			}
+			batchPosition += take;
+			remainingInBatch -= take;
+			records += take;
+		}
+		return records;
+	}
+};
+/************************************************************
+* ///////////////////////////|\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\
+* \\\\\\\\\\\\\\\\\\\\\\\\\\\|///////////////////////////////
+************************************************************/
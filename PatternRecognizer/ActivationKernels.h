@@ -0,0 +1,116 @@
+#pragma once
+
+/* Headers */
+#include <cstddef>
+#include <cmath>
+#include "SimdKernels.h"
+
+/************************************************************
+#############################################################
+#   Activation Kernels
+#############################################################
+#
+#   The activation functions as passes over a whole range of
+#   nodes, one struct per function. fcnn picks the struct once
+#   per range (see activateNodes and derivativeNodes), so the
+#   loops below never branch on the function and the exp they
+#   need is a vector SimdKernels pass (logistic or exponential).
+#
+#   forward(s, y, n)     y = f(s)
+#   backward(y, s, e, n) e *= f'(s), from y = f(s) or s
+************************************************************/
+
+#define ACTIVATION_CHUNK 64     /* nodes per pass when a kernel needs scratch space */
+
+/******************************************************************************
+ * SigmoidActivation
+-------------------------------------------------------------------------------
+ * f(s) = 1 / (1 + exp(-s)), f'(s) = y (1 - y)
+*******************************************************************************/
+struct SigmoidActivation {
+    template<typename T>
+    static void forward(const T* s, T* y, const size_t& n) {
+        SimdKernels::logistic(s, y, n);
+    }
+    template<typename T>
+    static void backward(const T* y, const T* /* s */, T* e, const size_t& n) {
+        for (size_t i = 0; i < n; i++) {
+            e[i] *= y[i] * ((T)1 - y[i]);
+        }
+    }
+};
+
+/******************************************************************************
+ * TanhActivation
+-------------------------------------------------------------------------------
+ * f(s) = tanh(s) = 2 logistic(2s) - 1, f'(s) = 1 - y^2
+*******************************************************************************/
+struct TanhActivation {
+    template<typename T>
+    static void forward(const T* s, T* y, const size_t& n) {
+        for (size_t i = 0; i < n; i++) {
+            y[i] = (T)2 * s[i];
+        }
+        SimdKernels::logistic(y, y, n);
+        for (size_t i = 0; i < n; i++) {
+            y[i] = (T)2 * y[i] - (T)1;
+        }
+    }
+    template<typename T>
+    static void backward(const T* y, const T* /* s */, T* e, const size_t& n) {
+        for (size_t i = 0; i < n; i++) {
+            e[i] *= (T)1 - y[i] * y[i];
+        }
+    }
+};
+
+/******************************************************************************
+ * SoftplusActivation
+-------------------------------------------------------------------------------
+ * f(s) = log(1 + exp(s)), taken as max(s, 0) + log1p(exp(-|s|)) so it cannot
+ * overflow. f'(s) is the sigmoid of s.
+*******************************************************************************/
+struct SoftplusActivation {
+    template<typename T>
+    static void forward(const T* s, T* y, const size_t& n) {
+        for (size_t i = 0; i < n; i++) {
+            y[i] = -fabs(s[i]);
+        }
+        SimdKernels::exponential(y, y, n);
+        for (size_t i = 0; i < n; i++) {
+            y[i] = ((s[i] > (T)0) ? s[i] : (T)0) + log1p(y[i]);
+        }
+    }
+    template<typename T>
+    static void backward(const T* /* y */, const T* s, T* e, const size_t& n) {
+        T scratch[ACTIVATION_CHUNK];
+        for (size_t first = 0; first < n; first += ACTIVATION_CHUNK) {
+            size_t count = (n - first < ACTIVATION_CHUNK) ? n - first : ACTIVATION_CHUNK;
+            SimdKernels::logistic(s + first, scratch, count);
+            for (size_t i = 0; i < count; i++) {
+                e[first + i] *= scratch[i];
+            }
+        }
+    }
+};
+
+/******************************************************************************
+ * RectifierActivation
+-------------------------------------------------------------------------------
+ * f(s) = max(s, 0) + SLOPE_TENTHS / 10 * min(s, 0) - relu with 0, leaky relu
+ * with 1. f'(s) is 1 above 0, the slope below.
+*******************************************************************************/
+template<int SLOPE_TENTHS>
+struct RectifierActivation {
+    template<typename T>
+    static void forward(const T* s, T* y, const size_t& n) {
+        SimdKernels::rectify(s, y, n, (T)(SLOPE_TENTHS * 0.1));
+    }
+    template<typename T>
+    static void backward(const T* /* y */, const T* s, T* e, const size_t& n) {
+        const T slope = (T)(SLOPE_TENTHS * 0.1);
+        for (size_t i = 0; i < n; i++) {
+            e[i] *= (s[i] > (T)0) ? (T)1 : slope;
+        }
+    }
+};
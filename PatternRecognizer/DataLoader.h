@@ -0,0 +1,776 @@
+#pragma once
+
+/* Headers */
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <pthread.h>
+#include "Array.h"
+#include "LabelDictionary.h"
+#include "FCNN.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/************************************************************
+#############################################################
+#   Mapped File Class
+#############################################################
+#
+#   Read-only memory map of a whole file, so the parser
+#   works straight out of the page cache instead of
+#   copying every line into a string.
+************************************************************/
+class MappedFile {
+private:
+    const char* bytes = nullptr;    /* start of the mapping */
+    size_t length = 0;              /* size of the file */
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    int file = -1;
+#endif
+
+public:
+    MappedFile() { }
+    MappedFile(const MappedFile& copy) = delete;
+    void operator=(const MappedFile& copy) = delete;
+    ~MappedFile() { close(); }
+
+    /* maps the file - returns false if it can not be opened (an empty file maps to 0 bytes) */
+    /* sequential files are read ahead as they are walked, the rest are read ahead all at once */
+    bool open(const string& path, const bool& sequential = true) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        GetFileSizeEx(file, &size);
+        length = (size_t)size.QuadPart;
+        if (length == 0) {
+            return true;
+        }
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL) {
+            close();
+            return false;
+        }
+        bytes = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(file, &info) != 0) {
+            close();
+            return false;
+        }
+        length = (size_t)info.st_size;
+        if (length == 0) {
+            return true;
+        }
+        void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+        if (view == MAP_FAILED) {
+            close();
+            return false;
+        }
+        madvise(view, length, sequential ? MADV_SEQUENTIAL : MADV_WILLNEED);
+        bytes = (const char*)view;
+#endif
+        if (bytes == nullptr) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    /* unmaps the file */
+    void close() {
+#ifdef _WIN32
+        if (bytes != nullptr) { UnmapViewOfFile(bytes); }
+        if (mapping != NULL) { CloseHandle(mapping); }
+        if (file != INVALID_HANDLE_VALUE) { CloseHandle(file); }
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (bytes != nullptr) { munmap((void*)bytes, length); }
+        if (file >= 0) { ::close(file); }
+        file = -1;
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+/************************************************************
+* ///////////////////////////|\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\
+* \\\\\\\\\\\\\\\\\\\\\\\\\\\|///////////////////////////////
+************************************************************/
+
+
+/************************************************************
+#############################################################
+#   Packed Data Set Struct
+#############################################################
+#
+#   Every image of a data set packed 8 pixels to a byte in
+#   row-major order (pixel i is bit (i % 8) of byte (i / 8),
+#   same as the PatternGenerator's PatternStream) plus the
+#   class id of every image.
+#
+#   A data set read from a cache file points into a read-only
+#   mapping of it instead of owning its arrays.
+************************************************************/
+struct PackedDataSet {
+    unsigned int count = 0;             /* number of images */
+    unsigned int height = 0;            /* height of every image */
+    unsigned int width = 0;             /* width of every image */
+    size_t bytesPerRecord = 0;          /* size of one packed image */
+    unsigned char* packed = nullptr;    /* count * bytesPerRecord bytes */
+    unsigned int* labels = nullptr;     /* class id of every image */
+    MappedFile* mapping = nullptr;      /* cache file packed points into, if any */
+    bool labelsMapped = false;          /* labels point into mapping too */
+
+    PackedDataSet() { }
+    PackedDataSet(const PackedDataSet& copy) = delete;
+    void operator=(const PackedDataSet& copy) = delete;
+    ~PackedDataSet() { release(); }
+
+    /* frees (or unmaps) the images and labels */
+    void release() {
+        if (mapping == nullptr) { delete[] packed; }
+        if (!labelsMapped) { delete[] labels; }
+        delete mapping;
+        packed = nullptr;
+        labels = nullptr;
+        mapping = nullptr;
+        labelsMapped = false;
+        count = 0;
+        height = 0;
+        width = 0;
+        bytesPerRecord = 0;
+    }
+
+    const unsigned char* getRecord(const unsigned int& i) const { return packed + ((size_t)i * bytesPerRecord); }
+};
+
+
+/******************************************************************************
+ * packPixels
+-------------------------------------------------------------------------------
+ * Turns count '0'/'1' characters into packed bits. A register of characters
+ * (32 with AVX2, 16 with SSE2, picked at startup by SimdKernels) is compared
+ * against '1' at once and the compare mask is exactly the packed bits for
+ * those pixels. dst must hold (count + 7) / 8 bytes.
+*******************************************************************************/
+inline void packPixels(const char* src, const size_t& count, unsigned char* dst) {
+    SimdKernels::packOnes(src, dst, count);
+}
+
+/* expands count packed pixels into 0.0 / 1.0 doubles */
+inline void unpackPixels(const unsigned char* src, const size_t& count, double* dst) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        unsigned char bits = src[i >> 3];
+        for (unsigned int b = 0; b < 8; b++) {
+            dst[i + b] = (double)((bits >> b) & 1);
+        }
+    }
+    for (; i < count; i++) {
+        dst[i] = (double)((src[i >> 3] >> (i & 7)) & 1);
+    }
+}
+
+/* parses an unsigned number in place - returns false if there are no digits */
+inline bool parseUnsigned(const char*& p, const char* end, unsigned int& value) {
+    const char* start = p;
+    value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = (value * 10) + (unsigned int)(*p - '0');
+        p += 1;
+    }
+    return p != start;
+}
+
+/* One data.csv line split into its fields */
+struct CsvRecord {
+    const char* name = nullptr;     /* class name - not terminated */
+    size_t nameLength = 0;          /* length of the class name */
+    unsigned int height = 0;        /* height of the image */
+    unsigned int width = 0;         /* width of the image */
+    const char* pixels = nullptr;   /* height * width '0'/'1' characters */
+};
+
+/******************************************************************************
+ * parseCsvLine
+-------------------------------------------------------------------------------
+ * Splits the line [p, lineEnd) (newline and any '\r' already left off) into
+ * name,height,width,pixels in place. Returns false if it does not parse or
+ * is too short for its own dimensions.
+*******************************************************************************/
+inline bool parseCsvLine(const char* p, const char* lineEnd, CsvRecord& record) {
+    const char* comma = (const char*)memchr(p, ',', lineEnd - p);
+    if (comma == nullptr) {
+        return false;
+    }
+    const char* field = comma + 1;
+    bool ok = parseUnsigned(field, lineEnd, record.height) && field < lineEnd && *(field++) == ','
+        && parseUnsigned(field, lineEnd, record.width) && field < lineEnd && *(field++) == ','
+        && (size_t)(lineEnd - field) >= (size_t)record.height * record.width;
+    record.name = p;
+    record.nameLength = comma - p;
+    record.pixels = field;
+    return ok;
+}
+
+/* finds the end of the line starting at p (before any '\r') and where the next one starts */
+inline void findLine(const char* p, const char* end, const char*& lineEnd, const char*& next) {
+    const char* newline = (const char*)memchr(p, '\n', end - p);
+    lineEnd = (newline == nullptr) ? end : newline;
+    next = (newline == nullptr) ? end : newline + 1;
+    if (lineEnd > p && lineEnd[-1] == '\r') {
+        lineEnd -= 1;
+    }
+}
+
+/************************************************************
+#############################################################
+#   Csv Range Struct
+#############################################################
+#
+#   One thread's share of loadCsvDataSet - a byte range of
+#   whole lines parsed into its own segment of the arena.
+#   Class ids are local to the range until they are merged.
+************************************************************/
+struct CsvRange {
+    const char* begin = nullptr;        /* first byte of the range */
+    const char* end = nullptr;          /* one past the last byte */
+    size_t lines = 0;                   /* lines in the range */
+    size_t firstLine = 0;               /* line number of the first line in the file */
+    unsigned int height = 0;            /* image size every record must have */
+    unsigned int width = 0;
+    size_t bytesPerRecord = 0;          /* size of one packed image */
+    unsigned char* packed = nullptr;    /* where this range's images go */
+    unsigned int* labels = nullptr;     /* where this range's (local) class ids go */
+    unsigned int count = 0;             /* images parsed */
+    LabelDictionary classes;            /* class names in the order this range saw them */
+    Array<size_t> skipped;              /* line numbers (in the range) that were skipped */
+};
+
+/* counts the lines of a range */
+inline void* countCsvRange(void* args) {
+    CsvRange* range = (CsvRange*)args;
+    range->lines = 0;
+    for (const char* p = range->begin; p < range->end; ) {
+        const char* newline = (const char*)memchr(p, '\n', range->end - p);
+        range->lines += 1;
+        p = (newline == nullptr) ? range->end : newline + 1;
+    }
+    return nullptr;
+}
+
+/* parses a range into its segment */
+inline void* parseCsvRange(void* args) {
+    CsvRange* range = (CsvRange*)args;
+    CsvRecord record;
+    size_t lineNumber = 0;
+    const char* lineEnd = nullptr;
+    const char* next = nullptr;
+    for (const char* p = range->begin; p < range->end; p = next) {
+        findLine(p, range->end, lineEnd, next);
+        lineNumber += 1;
+        if (lineEnd == p) {
+            continue;
+        }
+        if (!parseCsvLine(p, lineEnd, record) || record.height != range->height || record.width != range->width) {
+            range->skipped.add(lineNumber);
+            continue;
+        }
+        packPixels(record.pixels, (size_t)record.height * record.width, range->packed + ((size_t)range->count * range->bytesPerRecord));
+        range->labels[range->count] = range->classes.intern(record.name, record.nameLength);
+        range->count += 1;
+    }
+    return nullptr;
+}
+
+/******************************************************************************
+ * loadCsvDataSet
+-------------------------------------------------------------------------------
+ * Reads a PatternGenerator data.csv (name,height,width,pixels per line)
+ * into a PackedDataSet. The file is memory mapped, lines are found with
+ * memchr and the header fields are parsed in place.
+ *
+ * The file is split into numThreads byte ranges at line boundaries (0 means
+ * one per core). Each thread counts its lines, the counts are summed to give
+ * every range its own segment of the arena, and each thread then parses its
+ * range into that segment. The segments are closed up afterwards if any
+ * lines were skipped.
+ *
+ * Class ids follow the order names are first seen in the file, whatever the
+ * number of threads - the ranges' class lists are merged in file order.
+ * Names already in classes keep their ids. maxRecords of 0 reads every
+ * line, otherwise the first maxRecords lines. Lines that do not parse or do
+ * not match the size of the first image are reported and skipped.
+*******************************************************************************/
+inline bool loadCsvDataSet(const string& path, LabelDictionary& classes, PackedDataSet& out, const unsigned int& maxRecords = 0, unsigned int numThreads = 0) {
+    MappedFile file;
+    if (!file.open(path)) {
+        cout << "ERROR: Could not open data file" << endl;
+        return false;
+    }
+    const char* begin = file.data();
+    const char* end = begin + file.size();
+
+    out.release();
+
+    /* only read the first maxRecords lines */
+    if (maxRecords > 0) {
+        const char* p = begin;
+        for (unsigned int i = 0; i < maxRecords && p < end; i++) {
+            const char* newline = (const char*)memchr(p, '\n', end - p);
+            p = (newline == nullptr) ? end : newline + 1;
+        }
+        end = p;
+    }
+
+    /* the first good line sets the image size */
+    CsvRecord record;
+    const char* lineEnd = nullptr;
+    const char* next = nullptr;
+    for (const char* p = begin; p < end && out.bytesPerRecord == 0; p = next) {
+        findLine(p, end, lineEnd, next);
+        if (lineEnd > p && parseCsvLine(p, lineEnd, record)) {
+            out.height = record.height;
+            out.width = record.width;
+            out.bytesPerRecord = (((size_t)record.height * record.width) + 7) / 8;
+        }
+    }
+    if (out.bytesPerRecord == 0) {
+        return true;
+    }
+
+    /* split into ranges of whole lines - at least a megabyte each */
+    if (numThreads == 0) {
+        numThreads = thread::hardware_concurrency();
+    }
+    size_t bytes = end - begin;
+    size_t maxUseful = (bytes >> 20) + 1;
+    if (numThreads > maxUseful) { numThreads = (unsigned int)maxUseful; }
+    if (numThreads == 0) { numThreads = 1; }
+
+    CsvRange* ranges = new CsvRange[numThreads];
+    const char* rangeStart = begin;
+    for (unsigned int t = 0; t < numThreads; t++) {
+        const char* rangeEnd = (t + 1 == numThreads) ? end : begin + ((bytes / numThreads) * (t + 1));
+        if (rangeEnd < rangeStart) {
+            rangeEnd = rangeStart;
+        }
+        if (rangeEnd < end && rangeEnd > begin && rangeEnd[-1] != '\n') {
+            const char* newline = (const char*)memchr(rangeEnd, '\n', end - rangeEnd);
+            rangeEnd = (newline == nullptr) ? end : newline + 1;
+        }
+        ranges[t].begin = rangeStart;
+        ranges[t].end = rangeEnd;
+        ranges[t].height = out.height;
+        ranges[t].width = out.width;
+        ranges[t].bytesPerRecord = out.bytesPerRecord;
+        rangeStart = rangeEnd;
+    }
+
+    pthread_t* threads = new pthread_t[numThreads];
+
+    /* count lines, then give every range its segment (prefix sum) */
+    for (unsigned int t = 0; t < numThreads; t++) {
+        pthread_create(threads + t, NULL, countCsvRange, (void*)(ranges + t));
+    }
+    for (unsigned int t = 0; t < numThreads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    size_t lines = 0;
+    for (unsigned int t = 0; t < numThreads; t++) {
+        ranges[t].firstLine = lines;
+        lines += ranges[t].lines;
+    }
+    out.packed = new unsigned char[lines * out.bytesPerRecord];
+    out.labels = new unsigned int[(lines > 0) ? lines : 1];
+    for (unsigned int t = 0; t < numThreads; t++) {
+        ranges[t].packed = out.packed + (ranges[t].firstLine * out.bytesPerRecord);
+        ranges[t].labels = out.labels + ranges[t].firstLine;
+    }
+
+    /* parse */
+    for (unsigned int t = 0; t < numThreads; t++) {
+        pthread_create(threads + t, NULL, parseCsvRange, (void*)(ranges + t));
+    }
+    for (unsigned int t = 0; t < numThreads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    /* merge the class lists in file order, close up the segments and report skipped lines */
+    unsigned int* localToGlobal = nullptr;
+    for (unsigned int t = 0; t < numThreads; t++) {
+        CsvRange& range = ranges[t];
+        delete[] localToGlobal;
+        localToGlobal = new unsigned int[range.classes.getSize() + 1];
+        for (unsigned int i = 0; i < range.classes.getSize(); i++) {
+            localToGlobal[i] = classes.intern(range.classes.getName(i));
+        }
+        if (out.count != range.firstLine) {
+            memmove(out.packed + ((size_t)out.count * out.bytesPerRecord), range.packed, (size_t)range.count * out.bytesPerRecord);
+        }
+        for (unsigned int i = 0; i < range.count; i++) {
+            out.labels[out.count + i] = localToGlobal[range.labels[i]];
+        }
+        out.count += range.count;
+        for (unsigned int i = 0; i < range.skipped.getSize(); i++) {
+            cout << "Skipping line " << (range.firstLine + range.skipped[i]) << " of " << path << " (bad or mismatched record)" << endl;
+        }
+    }
+
+    delete[] localToGlobal;
+    delete[] threads;
+    delete[] ranges;
+    return true;
+}
+
+
+/************************************************************
+#############################################################
+#   Data Set Cache Header Struct
+#############################################################
+#
+#   Start of the binary cache written next to a csv file
+#   (path + ".cache") once it has been parsed:
+#
+#     header | class names (LabelDictionary::write) |
+#     uint32 label of every image (8 byte aligned) |
+#     packed images (64 byte aligned)
+#
+#   The source size, modification time and a hash of a few
+#   samples of the source have to match for the cache to be
+#   used. Everything is in the byte order of the machine
+#   that wrote it.
+************************************************************/
+struct DataSetCacheHeader {
+    char magic[8];                  /* "PRCACHE" */
+    uint32_t version;               /* DATA_SET_CACHE_VERSION */
+    uint32_t maxRecords;            /* maxRecords the source was read with */
+    uint64_t sourceSize;            /* size of the source in bytes */
+    int64_t sourceModified;         /* source modification time (seconds) */
+    uint64_t sourceHash;            /* hashSourceSamples of the source */
+    uint32_t count;                 /* number of images */
+    uint32_t height;                /* height of every image */
+    uint32_t width;                 /* width of every image */
+    uint32_t reserved;
+    uint64_t bytesPerRecord;        /* size of one packed image */
+    uint64_t labelsOffset;          /* where the labels start */
+    uint64_t packedOffset;          /* where the images start */
+};
+
+#define DATA_SET_CACHE_VERSION 1
+
+/* where the cache of a csv file goes */
+inline string dataSetCachePath(const string& path) { return path + ".cache"; }
+
+/******************************************************************************
+ * getFileStamp
+-------------------------------------------------------------------------------
+ * Size and modification time (seconds) of a file - false if it does not
+ * exist.
+*******************************************************************************/
+inline bool getFileStamp(const string& path, uint64_t& size, int64_t& modified) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &info)) {
+        return false;
+    }
+    size = ((uint64_t)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+    modified = (int64_t)((((uint64_t)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime) / 10000000ull);
+#else
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+    size = (uint64_t)info.st_size;
+    modified = (int64_t)info.st_mtime;
+#endif
+    return true;
+}
+
+/******************************************************************************
+ * hashSourceSamples
+-------------------------------------------------------------------------------
+ * FNV-1a of the size and of 64 KB from the start, middle and end of a file.
+ * Catches a source that was rewritten without its size or time changing,
+ * without reading the whole thing.
+*******************************************************************************/
+inline bool hashSourceSamples(const string& path, const uint64_t& size, uint64_t& hash) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    const size_t sampleSize = 65536;
+    char* buffer = new char[sampleSize];
+    hash = 14695981039346656037ull;
+    for (int i = 0; i < 8; i++) {
+        hash ^= (size >> (i * 8)) & 0xFF;
+        hash *= 1099511628211ull;
+    }
+    uint64_t starts[3] = { 0, (size > sampleSize) ? (size - sampleSize) / 2 : 0, (size > sampleSize) ? size - sampleSize : 0 };
+    bool ok = true;
+    for (int s = 0; s < 3 && ok; s++) {
+        size_t length = (size_t)((size - starts[s] < sampleSize) ? size - starts[s] : sampleSize);
+#ifdef _WIN32
+        ok = _fseeki64(file, (long long)starts[s], SEEK_SET) == 0;
+#else
+        ok = fseeko(file, (off_t)starts[s], SEEK_SET) == 0;
+#endif
+        ok = ok && fread(buffer, 1, length, file) == length;
+        for (size_t i = 0; ok && i < length; i++) {
+            hash ^= (unsigned char)buffer[i];
+            hash *= 1099511628211ull;
+        }
+    }
+    delete[] buffer;
+    fclose(file);
+    return ok;
+}
+
+/******************************************************************************
+ * writeDataSetCache
+-------------------------------------------------------------------------------
+ * Writes the cache of a csv file that was just read into dataSet. It is
+ * written to a temporary file and renamed into place, so a run that reads
+ * the cache never sees half of one. Returns false (and leaves no cache) if
+ * anything fails.
+*******************************************************************************/
+inline bool writeDataSetCache(const string& path, const LabelDictionary& classes, const PackedDataSet& dataSet, const unsigned int& maxRecords) {
+    DataSetCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "PRCACHE", 8);
+    header.version = DATA_SET_CACHE_VERSION;
+    header.maxRecords = maxRecords;
+    if (!getFileStamp(path, header.sourceSize, header.sourceModified) || !hashSourceSamples(path, header.sourceSize, header.sourceHash)) {
+        return false;
+    }
+    header.count = dataSet.count;
+    header.height = dataSet.height;
+    header.width = dataSet.width;
+    header.bytesPerRecord = dataSet.bytesPerRecord;
+
+    string cachePath = dataSetCachePath(path);
+    string tempPath = cachePath + ".tmp";
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    const char zeros[64] = { 0 };
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && classes.write(file);
+    uint64_t position = (uint64_t)ftell(file);
+    header.labelsOffset = (position + 7) & ~(uint64_t)7;
+    ok = ok && fwrite(zeros, 1, (size_t)(header.labelsOffset - position), file) == header.labelsOffset - position;
+    ok = ok && fwrite(dataSet.labels, sizeof(uint32_t), dataSet.count, file) == dataSet.count;
+    position = header.labelsOffset + (uint64_t)dataSet.count * sizeof(uint32_t);
+    header.packedOffset = (position + 63) & ~(uint64_t)63;
+    ok = ok && fwrite(zeros, 1, (size_t)(header.packedOffset - position), file) == header.packedOffset - position;
+    size_t packedBytes = (size_t)dataSet.count * dataSet.bytesPerRecord;
+    ok = ok && fwrite(dataSet.packed, 1, packedBytes, file) == packedBytes;
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+
+    if (ok) {
+        remove(cachePath.c_str());
+        ok = rename(tempPath.c_str(), cachePath.c_str()) == 0;
+    }
+    if (!ok) {
+        remove(tempPath.c_str());
+    }
+    return ok;
+}
+
+/******************************************************************************
+ * checkDataSetCacheLayout
+-------------------------------------------------------------------------------
+ * True if the header describes images that fit their own dimensions and
+ * labels and images that lie, in that order, after the class table and
+ * inside a file of fileSize bytes. A cache that fails this is not read.
+*******************************************************************************/
+inline bool checkDataSetCacheLayout(const DataSetCacheHeader& header, const uint64_t& tablesEnd, const uint64_t& fileSize) {
+    uint64_t pixels = (uint64_t)header.height * header.width;
+    if (header.count == 0 || pixels == 0 || header.bytesPerRecord != (pixels + 7) / 8) {
+        return false;
+    }
+    if (header.labelsOffset < tablesEnd || header.labelsOffset % sizeof(uint32_t) != 0 || header.labelsOffset > fileSize) {
+        return false;
+    }
+    uint64_t labelsEnd = header.labelsOffset + (uint64_t)header.count * sizeof(uint32_t);
+    if (labelsEnd > fileSize || header.packedOffset < labelsEnd || header.packedOffset > fileSize) {
+        return false;
+    }
+    /* divided rather than multiplied so a huge record size cannot wrap around */
+    return header.bytesPerRecord <= fileSize && header.count <= (fileSize - header.packedOffset) / header.bytesPerRecord;
+}
+
+/******************************************************************************
+ * readDataSetCache
+-------------------------------------------------------------------------------
+ * Maps the cache of a csv file into out if it exists and still matches the
+ * source. Nothing is copied - the images (and the labels, if the class ids
+ * do not need remapping) stay in the mapping. Returns false if there is no
+ * usable cache, or its layout does not add up (see checkDataSetCacheLayout).
+*******************************************************************************/
+inline bool readDataSetCache(const string& path, LabelDictionary& classes, PackedDataSet& out, const unsigned int& maxRecords) {
+    string cachePath = dataSetCachePath(path);
+    FILE* file = fopen(cachePath.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    DataSetCacheHeader header;
+    LabelDictionary cacheClasses;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1
+        && memcmp(header.magic, "PRCACHE", 8) == 0
+        && header.version == DATA_SET_CACHE_VERSION
+        && header.maxRecords == maxRecords
+        && cacheClasses.read(file);
+    uint64_t tablesEnd = (uint64_t)ftell(file);
+    fclose(file);
+
+    uint64_t sourceSize = 0;
+    int64_t sourceModified = 0;
+    uint64_t sourceHash = 0;
+    ok = ok && getFileStamp(path, sourceSize, sourceModified)
+        && sourceSize == header.sourceSize && sourceModified == header.sourceModified
+        && hashSourceSamples(path, sourceSize, sourceHash) && sourceHash == header.sourceHash;
+    if (!ok) {
+        return false;
+    }
+
+    /* the stamp only says the source is unchanged - the layout is checked before anything in the mapping is trusted */
+    MappedFile* mapping = new MappedFile();
+    if (!mapping->open(cachePath, false) || !checkDataSetCacheLayout(header, tablesEnd, (uint64_t)mapping->size())) {
+        delete mapping;
+        return false;
+    }
+
+    /* ids in the cache are its own - they only need remapping if classes already had other names */
+    unsigned int* localToGlobal = new unsigned int[cacheClasses.getSize() + 1];
+    bool sameIds = true;
+    for (unsigned int i = 0; i < cacheClasses.getSize(); i++) {
+        localToGlobal[i] = classes.intern(cacheClasses.getName(i));
+        sameIds = sameIds && (localToGlobal[i] == i);
+    }
+
+    out.release();
+    out.mapping = mapping;
+    out.count = header.count;
+    out.height = header.height;
+    out.width = header.width;
+    out.bytesPerRecord = (size_t)header.bytesPerRecord;
+    out.packed = (unsigned char*)(mapping->data() + header.packedOffset);
+    const unsigned int* cacheLabels = (const unsigned int*)(mapping->data() + header.labelsOffset);
+    if (sameIds) {
+        out.labels = (unsigned int*)cacheLabels;
+        out.labelsMapped = true;
+    }
+    else {
+        out.labels = new unsigned int[(out.count > 0) ? out.count : 1];
+        for (unsigned int i = 0; i < out.count; i++) {
+            out.labels[i] = (cacheLabels[i] < cacheClasses.getSize()) ? localToGlobal[cacheLabels[i]] : LabelDictionary::NOT_FOUND;
+        }
+    }
+    delete[] localToGlobal;
+    return true;
+}
+
+/******************************************************************************
+ * loadCachedCsvDataSet
+-------------------------------------------------------------------------------
+ * loadCsvDataSet that goes through the csv file's cache: a cache that still
+ * matches the file is mapped instead of parsing it, otherwise the file is
+ * parsed and a new cache is written for the next run.
+*******************************************************************************/
+inline bool loadCachedCsvDataSet(const string& path, LabelDictionary& classes, PackedDataSet& out, const unsigned int& maxRecords = 0, const unsigned int& numThreads = 0) {
+    if (readDataSetCache(path, classes, out, maxRecords)) {
+        cout << "Read " << dataSetCachePath(path) << endl;
+        return true;
+    }
+    if (!loadCsvDataSet(path, classes, out, maxRecords, numThreads)) {
+        return false;
+    }
+    if (out.count > 0) {
+        if (writeDataSetCache(path, classes, out, maxRecords)) {
+            cout << "Wrote " << dataSetCachePath(path) << endl;
+        }
+        else {
+            cout << "Could not write " << dataSetCachePath(path) << " - the next run parses " << path << " again" << endl;
+        }
+    }
+    return true;
+}
+
+
+/************************************************************
+#############################################################
+#   Packed Data Source Class
+#############################################################
+#
+#   Feeds an fcnn from a PackedDataSet. Only the block being
+#   trained on is expanded to doubles and labels are handed
+#   over as class ids, so the data set itself stays at one bit per
+#   pixel. indices picks the images (e.g. the training half
+#   of a split) - null means all of them.
+************************************************************/
+class PackedDataSource : public fcnnDataSource {
+private:
+    const PackedDataSet* dataSet = nullptr; /* images - not owned */
+    const unsigned int* indices = nullptr;  /* images to use - not owned */
+    unsigned int numData = 0;               /* number of images to use */
+    unsigned int outputSize = 0;            /* class ids from here on are staged as no class */
+    unsigned int capacity = 0;              /* samples the staging arena holds */
+    double* inputArena = nullptr;           /* staged inputs */
+
+public:
+    PackedDataSource(const PackedDataSet& dataSet, const unsigned int* indices, const unsigned int& numData, const unsigned int& outputSize)
+        : dataSet(&dataSet), indices(indices), numData(numData), outputSize(outputSize) {}
+    PackedDataSource(const PackedDataSource& copy) = delete;
+    void operator=(const PackedDataSource& copy) = delete;
+
+    ~PackedDataSource() { delete[] inputArena; }
+
+    unsigned int getNumData() const { return numData; }
+
+    void stageSamples(const unsigned int samples[], const unsigned int& count, double** inputs, uint32_t labels[]) {
+        size_t inputSize = (size_t)dataSet->height * dataSet->width;
+        if (count > capacity) {
+            delete[] inputArena;
+            inputArena = new double[count * inputSize];
+            capacity = count;
+        }
+        for (unsigned int i = 0; i < count; i++) {
+            unsigned int record = (indices != nullptr) ? indices[samples[i]] : samples[i];
+            inputs[i] = inputArena + (i * inputSize);
+            unpackPixels(dataSet->getRecord(record), inputSize, inputs[i]);
+            labels[i] = (dataSet->labels[record] < outputSize) ? dataSet->labels[record] : 0xFFFFFFFF;
+        }
+    }
+};
+/************************************************************
+* ///////////////////////////|\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\
+* \\\\\\\\\\\\\\\\\\\\\\\\\\\|///////////////////////////////
+************************************************************/
@@ -1,30 +1,73 @@
+#pragma once
+
+/* Headers */
 #include <random>
+#include <unordered_map>
 #include <iostream>
 #include "Array.h"
 
+/******************************************************************************
+ * shuffleIndices
+-------------------------------------------------------------------------------
+ * Seeded Fisher-Yates shuffle of an index list. Shuffle indices into the
+ * data rather than the data itself - the same seed gives the same order.
+*******************************************************************************/
+inline void shuffleIndices(unsigned int* indices, const unsigned int& size, const unsigned int& seed) {
+    default_random_engine engine(seed);
+    for (unsigned int i = size; i > 1; i--) {
+        unsigned int j = uniform_int_distribution<unsigned int>(0, i - 1)(engine);
+        unsigned int temp = indices[i - 1];
+        indices[i - 1] = indices[j];
+        indices[j] = temp;
+    }
+}
+
 /************************************************************
 #############################################################
-#   className
+#   Data Splitter Class
 #############################################################
 #
+#   Splits a labelled data set into training and testing
+#   sets of sample indices - stratified hold out (once or
+#   repeated) or stratified K-fold. Every class keeps its
+#   share in every set. The splits are views into one
+#   arena of indices, nothing is copied per split.
 ************************************************************/
 class DataSplitter{
 private:
     long seed = 0;
+    bool shuffle = false;                   /* shuffle (with seed) before splitting, otherwise keep sample order */
 
+    /* One split - both sets are runs of indices in splitArena */
+    struct SplitView {
+        size_t trainingOffset = 0;
+        unsigned int trainingCount = 0;
+        size_t testingOffset = 0;
+        unsigned int testingCount = 0;
+    };
 
-    Array<unsigned int> classLabels;
+    Array<unsigned int> classLabels;        /* label of every dense class id, in the order first seen */
     unsigned int *labels = nullptr;
+    unsigned int *denseLabels = nullptr;    /* dense class id of every sample */
     unsigned int size = 0;
 
     unsigned int numClasses = 0;
     Array<unsigned int> classCount;
 
-    Array<unsigned int> trainingSet;
-    Array<unsigned int> testingSet;
+    unsigned int *splitArena = nullptr;     /* sample indices every split points into */
+    Array<SplitView> splits;
     
     void analyzeData();
 
+    /* sample order for one split - sample order, or shuffled with seed + pass */
+    unsigned int* makeOrder(const unsigned int& pass) const;
+
+    /* stable sort of order by class - classStart[c] is where class c starts */
+    void groupByClass(const unsigned int order[], unsigned int grouped[], unsigned int classStart[]) const;
+
+    /* exits if the training and testing sets of some split are not a partition of every sample */
+    void checkSplits() const;
+
 public:
 
     /* These should not be needed or used */
@@ -40,6 +83,16 @@ public:
     /* Required Functions */
     void splitData(const double& splitPercentage);
     void getSplitData(unsigned int*& trainingSetPtr, unsigned int& trainingCount, unsigned int*& testingSetPtr, unsigned int& testingCount);
+
+    /* splitPercentage of every class is held out for testing, repeated with a new shuffle each time */
+    void splitRepeated(const double& splitPercentage, const unsigned int& repeats);
+
+    /* every class is dealt across folds - split i tests on fold i and trains on the rest */
+    void splitFolds(const unsigned int& folds);
+
+    /* Views of a split - they point into the splitter and stay valid until the next split */
+    unsigned int getNumSplits() const { return (unsigned int)splits.getSize(); }
+    void getSplit(const unsigned int& split, const unsigned int*& trainingSetPtr, unsigned int& trainingCount, const unsigned int*& testingSetPtr, unsigned int& testingCount) const;
 };
 /************************************************************
 * ///////////////////////////|\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\
@@ -48,11 +101,11 @@ public:
 
 
 /******************************************************************************
- * functionName 
+ * DataSplitter (seeded)
 -------------------------------------------------------------------------------
- * 
+ * Splitter that shuffles the samples with seed before dealing them out
 *******************************************************************************/
-DataSplitter::DataSplitter(const unsigned int labels[], const unsigned int& size, long seed) : seed(seed), size(size) {
+inline DataSplitter::DataSplitter(const unsigned int labels[], const unsigned int& size, long seed) : seed(seed), shuffle(true), size(size) {
     this->labels = new unsigned int[size];
     for(unsigned int i = 0; i < size; i++){
         this->labels[i] = labels[i];
@@ -61,11 +114,12 @@ DataSplitter::DataSplitter(const unsigned int labels[], const unsigned int& size
 }
 
 /******************************************************************************
- * functionName 
+ * DataSplitter
 -------------------------------------------------------------------------------
- * 
+ * Splitter that deals the samples out in sample order, so the same data
+ * always splits the same way
 *******************************************************************************/
-DataSplitter::DataSplitter(const unsigned int labels[], const unsigned int& size) : seed(0), size(size) {
+inline DataSplitter::DataSplitter(const unsigned int labels[], const unsigned int& size) : seed(0), size(size) {
     this->labels = new unsigned int[size];
     for(unsigned int i = 0; i < size; i++){
         this->labels[i] = labels[i];
@@ -73,124 +127,320 @@ DataSplitter::DataSplitter(const unsigned int labels[], const unsigned int& size
     analyzeData();
 }
 
-DataSplitter::~DataSplitter(){
+/******************************************************************************
+ * ~DataSplitter
+-------------------------------------------------------------------------------
+ * Deallocate the labels and the split arena
+*******************************************************************************/
+inline DataSplitter::~DataSplitter(){
     if(labels != nullptr){
         delete[] labels;
     }
+    delete[] denseLabels;
+    delete[] splitArena;
 }
 
 /******************************************************************************
- * functionName 
+ * analyzeData
 -------------------------------------------------------------------------------
- * 
+ * Remaps the labels to dense class ids (in the order they are first seen)
+ * and counts every class. Labels are class ids already, so the remap is a
+ * direct table over [0, maxLabel]; labels too spread out for that go
+ * through a hash map instead.
 *******************************************************************************/
-void DataSplitter::analyzeData(){
+inline void DataSplitter::analyzeData(){
 
     classCount.reset();
     classLabels.reset();
-    
-    /* Figure out the number of classes */
+    numClasses = 0;
+
+    delete[] denseLabels;
+    denseLabels = new unsigned int[size];
+
+    unsigned int maxLabel = 0;
     for(unsigned int i = 0; i < size; i++){
-        if(!classLabels.exists(labels[i])){
-            numClasses += 1;
-            classLabels.add(labels[i]);
+        if(labels[i] > maxLabel){
+            maxLabel = labels[i];
         }
     }
 
-    /* Set up a class counter for each class */
-    for(unsigned int i = 0; i < numClasses; i++){
-        classCount.add(0);
+    /* Give every label a dense id */
+    if((size_t)maxLabel <= (size_t)size * 4 + 1024){
+        unsigned int* toDense = new unsigned int[(size_t)maxLabel + 1];
+        for(size_t i = 0; i <= maxLabel; i++){
+            toDense[i] = 0xFFFFFFFF;
+        }
+        for(unsigned int i = 0; i < size; i++){
+            if(toDense[labels[i]] == 0xFFFFFFFF){
+                toDense[labels[i]] = numClasses;
+                numClasses += 1;
+                classLabels.add(labels[i]);
+                classCount.add(0);
+            }
+            denseLabels[i] = toDense[labels[i]];
+        }
+        delete[] toDense;
+    }
+    else{
+        unordered_map<unsigned int, unsigned int> toDense;
+        toDense.reserve(1024);
+        for(unsigned int i = 0; i < size; i++){
+            auto found = toDense.emplace(labels[i], numClasses);
+            if(found.second){
+                numClasses += 1;
+                classLabels.add(labels[i]);
+                classCount.add(0);
+            }
+            denseLabels[i] = found.first->second;
+        }
     }
 
     /* Count the number of classes */
     for(unsigned int i = 0; i < size; i++){
-        unsigned int index = classLabels.getIndexOfFirstInstance(labels[i]);
-        if (index < classLabels.getSize()) {
-            classCount[index] += 1;
-        }
+        classCount[denseLabels[i]] += 1;
     }
+}
+
 
-    for (unsigned int i = 0; i < classCount.getSize(); i++) {
-        cout << classCount[i] << endl;
+/******************************************************************************
+ * makeOrder
+-------------------------------------------------------------------------------
+ * The order samples are dealt out in. Without a seed this is sample order so
+ * the same data always splits the same way.
+*******************************************************************************/
+inline unsigned int* DataSplitter::makeOrder(const unsigned int& pass) const {
+    unsigned int* order = new unsigned int[size + 1];
+    for (unsigned int i = 0; i < size; i++) {
+        order[i] = i;
     }
+    if (shuffle) {
+        shuffleIndices(order, size, (unsigned int)(seed + pass));
+    }
+    return order;
+}
 
+/******************************************************************************
+ * groupByClass
+-------------------------------------------------------------------------------
+ * Counting sort of order by dense class id. Each class keeps the order its
+ * samples had in order.
+*******************************************************************************/
+inline void DataSplitter::groupByClass(const unsigned int order[], unsigned int grouped[], unsigned int classStart[]) const {
+    unsigned int* next = new unsigned int[numClasses + 1];
+    unsigned int start = 0;
+    for (unsigned int c = 0; c < numClasses; c++) {
+        classStart[c] = start;
+        next[c] = start;
+        start += classCount.at(c);
+    }
+    classStart[numClasses] = start;
+    for (unsigned int i = 0; i < size; i++) {
+        grouped[next[denseLabels[order[i]]]++] = order[i];
+    }
+    delete[] next;
 }
 
+/******************************************************************************
+ * splitData
+-------------------------------------------------------------------------------
+ * Puts splitPercentage of every class in the testing set and the rest in the
+ * training set - the first ones in sample order, or random ones if the
+ * splitter was given a seed.
+*******************************************************************************/
+inline void DataSplitter::splitData(const double& splitPercentage){
+    splitRepeated(splitPercentage, 1);
+}
 
 /******************************************************************************
- * functionName
+ * splitRepeated
 -------------------------------------------------------------------------------
- *
+ * Stratified hold out, repeats times. Repeat r shuffles with seed + r, so
+ * repeats only differ if the splitter was given a seed. Every split is
+ * [testing | training] in the arena, both in dealing order.
 *******************************************************************************/
-void DataSplitter::splitData(const double& splitPercentage){
+inline void DataSplitter::splitRepeated(const double& splitPercentage, const unsigned int& repeats){
 
-    Array<unsigned int> testingCount = classCount;
-    Array<unsigned int> trainingCount = classCount;
-    Array<unsigned int> currentTestingCount = classCount;
-    Array<unsigned int> currentTrainingCount = classCount;
-    for (size_t i = 0; i < classCount.getSize(); i++) {
-        testingCount[i] = classCount[i] * splitPercentage;
-        trainingCount[i] = classCount[i] - testingCount[i];
-        currentTestingCount[i] = 0;
-        currentTrainingCount[i] = 0;
+    splits.reset();
+    delete[] splitArena;
+    splitArena = new unsigned int[(size_t)size * repeats + 1];
+
+    unsigned int* testingCount = new unsigned int[numClasses + 1];
+    for (unsigned int c = 0; c < numClasses; c++) {
+        testingCount[c] = classCount[c] * splitPercentage;
     }
+    unsigned int* grouped = new unsigned int[size + 1];
+    unsigned int* classStart = new unsigned int[numClasses + 1];
+    bool* testing = new bool[size + 1];
 
-    trainingSet.reset();
-    testingSet.reset();
+    for (unsigned int r = 0; r < repeats; r++) {
+        unsigned int* order = makeOrder(r);
+        groupByClass(order, grouped, classStart);
 
-    for (unsigned int i = 0; i < size; i++) {
-        size_t index = classLabels.getIndexOfFirstInstance(labels[i]);
-        if (currentTestingCount[index] < testingCount[index]) {
-            testingSet.add(i);
-            currentTestingCount[index] += 1;
-        }
-        else {
-            trainingSet.add(i);
-            currentTrainingCount[index] += 1;
+        /* The first testingCount of every class are held out */
+        for (unsigned int c = 0; c < numClasses; c++) {
+            for (unsigned int i = classStart[c]; i < classStart[c + 1]; i++) {
+                testing[grouped[i]] = (i - classStart[c]) < testingCount[c];
+            }
         }
 
+        SplitView view;
+        view.testingOffset = (size_t)size * r;
+        for (unsigned int i = 0; i < size; i++) {
+            if (testing[order[i]]) {
+                splitArena[view.testingOffset + view.testingCount] = order[i];
+                view.testingCount += 1;
+            }
+        }
+        view.trainingOffset = view.testingOffset + view.testingCount;
+        for (unsigned int i = 0; i < size; i++) {
+            if (!testing[order[i]]) {
+                splitArena[view.trainingOffset + view.trainingCount] = order[i];
+                view.trainingCount += 1;
+            }
+        }
+        splits.add(view);
+        delete[] order;
     }
+    checkSplits();
+
+    delete[] testingCount;
+    delete[] grouped;
+    delete[] classStart;
+    delete[] testing;
 }
 
 /******************************************************************************
- * functionName
+ * splitFolds
 -------------------------------------------------------------------------------
- *
+ * Stratified K-fold. Classes are dealt across the folds one after another so
+ * every fold gets its share of every class and fold sizes differ by at most
+ * one. The folds are stored twice in a row, which makes "every fold but i"
+ * a single run that starts right after fold i.
 *******************************************************************************/
-void DataSplitter::getSplitData(unsigned int*& trainingSetPtr, unsigned int& trainingCount, unsigned int*& testingSetPtr, unsigned int& testingCount) {
-    trainingSetPtr = new unsigned int[trainingSet.getSize()];
-    testingSetPtr = new unsigned int[testingSet.getSize()];
+inline void DataSplitter::splitFolds(const unsigned int& folds){
 
-    trainingCount = trainingSet.getSize();
-    testingCount = testingSet.getSize();
+    splits.reset();
+    delete[] splitArena;
+    splitArena = nullptr;
+    if (folds < 2) {
+        cout << "K-fold needs at least 2 folds" << endl;
+        return;
+    }
+    splitArena = new unsigned int[(size_t)size * 2 + 1];
 
-    for (unsigned int i = 0; i < testingCount; i++) {
-        testingSetPtr[i] = testingSet[i];
+    unsigned int* order = makeOrder(0);
+    unsigned int* grouped = new unsigned int[size + 1];
+    unsigned int* classStart = new unsigned int[numClasses + 1];
+    unsigned int* fold = new unsigned int[size + 1];
+    groupByClass(order, grouped, classStart);
+    for (unsigned int i = 0; i < size; i++) {
+        fold[grouped[i]] = i % folds;
     }
 
-    for (unsigned int i = 0; i < trainingCount; i++) {
-        trainingSetPtr[i] = trainingSet[i];
+    /* Lay the folds out one after another, each in dealing order - fold f starts after the samples dealt to the folds before it */
+    size_t* foldStart = new size_t[folds + 1];
+    size_t* next = new size_t[folds + 1];
+    for (unsigned int f = 0; f <= folds; f++) {
+        foldStart[f] = 0;
     }
+    for (unsigned int i = 0; i < size; i++) {
+        foldStart[fold[i] + 1] += 1;
+    }
+    for (unsigned int f = 0; f < folds; f++) {
+        foldStart[f + 1] += foldStart[f];
+    }
+    for (unsigned int f = 0; f < folds; f++) {
+        next[f] = foldStart[f];
+    }
+    for (unsigned int i = 0; i < size; i++) {
+        splitArena[next[fold[order[i]]]++] = order[i];
+    }
+    for (unsigned int i = 0; i < size; i++) {
+        splitArena[size + i] = splitArena[i];
+    }
+
+    for (unsigned int f = 0; f < folds; f++) {
+        SplitView view;
+        view.testingOffset = foldStart[f];
+        view.testingCount = (unsigned int)(foldStart[f + 1] - foldStart[f]);
+        view.trainingOffset = foldStart[f + 1];
+        view.trainingCount = size - view.testingCount;
+        splits.add(view);
+    }
+    checkSplits();
+
+    delete[] order;
+    delete[] grouped;
+    delete[] classStart;
+    delete[] fold;
+    delete[] foldStart;
+    delete[] next;
 }
 
 /******************************************************************************
- * functionName
+ * checkSplits
 -------------------------------------------------------------------------------
- *
+ * Every sample has to be in exactly one of a split's two sets, or a network
+ * would test on what it trained on (or read an index that is no sample).
 *******************************************************************************/
-template<typename t>
-void shuffleData(t *arr, const unsigned int& arrSize, const unsigned int& passThroughs = 3) {
-    unsigned int iterations = arrSize * passThroughs;
-    unsigned int i1, i2;
-    t temp;
-    for (unsigned int i = 0; i < iterations; i++) {
-        i1 = rand() % arrSize;
-        i2 = rand() % arrSize;
-        while (i1 == i2) {
-            i2 = rand() % arrSize;
+inline void DataSplitter::checkSplits() const {
+    unsigned int* seen = new unsigned int[size + 1];
+    for (unsigned int s = 0; s < splits.getSize(); s++) {
+        const SplitView& view = splits.at(s);
+        bool valid = ((size_t)view.trainingCount + view.testingCount == size);
+        for (unsigned int i = 0; i < size; i++) {
+            seen[i] = 0;
         }
-        temp = arr[i1];
-        arr[i1] = arr[i2];
-        arr[i2] = temp;
+        for (unsigned int i = 0; valid && i < view.testingCount + view.trainingCount; i++) {
+            unsigned int sample = (i < view.testingCount) ? splitArena[view.testingOffset + i] : splitArena[view.trainingOffset + i - view.testingCount];
+            valid = (sample < size) && (seen[sample]++ == 0);
+        }
+        if (!valid) {
+            cout << "Split " << s << " does not partition the " << size << " samples" << endl;
+            exit(1);
+        }
+    }
+    delete[] seen;
+}
+
+/******************************************************************************
+ * getSplit
+-------------------------------------------------------------------------------
+ * Points at the indices of one split. Nothing is copied.
+*******************************************************************************/
+inline void DataSplitter::getSplit(const unsigned int& split, const unsigned int*& trainingSetPtr, unsigned int& trainingCount, const unsigned int*& testingSetPtr, unsigned int& testingCount) const {
+    trainingSetPtr = nullptr;
+    testingSetPtr = nullptr;
+    trainingCount = 0;
+    testingCount = 0;
+    if (split >= splits.getSize()) {
+        return;
+    }
+    const SplitView& view = splits.at(split);
+    trainingSetPtr = splitArena + view.trainingOffset;
+    trainingCount = view.trainingCount;
+    testingSetPtr = splitArena + view.testingOffset;
+    testingCount = view.testingCount;
+}
+
+/******************************************************************************
+ * getSplitData
+-------------------------------------------------------------------------------
+ * Copies of the first split's indices - the caller deletes them.
+*******************************************************************************/
+inline void DataSplitter::getSplitData(unsigned int*& trainingSetPtr, unsigned int& trainingCount, unsigned int*& testingSetPtr, unsigned int& testingCount) {
+    const unsigned int* trainingView = nullptr;
+    const unsigned int* testingView = nullptr;
+    getSplit(0, trainingView, trainingCount, testingView, testingCount);
+
+    trainingSetPtr = new unsigned int[trainingCount + 1];
+    testingSetPtr = new unsigned int[testingCount + 1];
+
+    for (unsigned int i = 0; i < testingCount; i++) {
+        testingSetPtr[i] = testingView[i];
+    }
+
+    for (unsigned int i = 0; i < trainingCount; i++) {
+        trainingSetPtr[i] = trainingView[i];
     }
 }
@@ -9,12 +9,20 @@
 
 /* Headers */
 #include <random>
+#include <cstdint>
+#include <new>
+#include <cstring>
 #include <iostream>
 #include <pthread.h>
 #include <chrono>
 #include <ctime>   
 #include <string>
 #include <fstream>
+#include <type_traits>
+#include <cctype>
+#include "SimdKernels.h"
+#include "GemmKernels.h"
+#include "ActivationKernels.h"
 
 using namespace std;
 
@@ -25,13 +33,14 @@ using namespace std;
 #
 #   Small class for prediction objects
 #   Used to hold the output of Neural
-#   Network.
+#   Network, in the network's precision.
 ************************************************************/
 
+template<typename T = double>
 class prediction {
 private:
     unsigned int size;      /* To hold the size of the prediction */
-    double* arr = nullptr;  /* pointer to memory holding the prediction data */
+    T* arr = nullptr;       /* pointer to memory holding the prediction data */
 
 public:
     /* No default constructor needed */
@@ -40,7 +49,7 @@ public:
     /* Param constructor for easy set up */
     prediction(const unsigned int& s) {
         size = s;
-        arr = new double[size];
+        arr = new T[size];
     }
 
     /* Destructor to clean up dynamic memory */
@@ -67,14 +76,14 @@ public:
         if (size == 0) {
             return;
         }
-        arr = new double[size];
+        arr = new T[size];
         for (unsigned int i = 0; i < size; i++) {
             arr[i] = copy.arr[i];
         }
     }
 
     /* Bracket Operator for Easy Access */
-    double& operator[](const unsigned int& ind) {
+    T& operator[](const unsigned int& ind) {
         if (ind >= size) {
             exit(1);
         }
@@ -84,6 +93,9 @@ public:
     /* Accessor for size */
     unsigned int getSize() const { return size; }
 
+    /* The getSize() values themselves - for predictInto */
+    T* getData() { return arr; }
+
 };
 /************************************************************
 * ///////////////////////////|\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\
@@ -91,13 +103,102 @@ public:
 ************************************************************/
 
 
+/************************************************************
+#############################################################
+#   Data Source Classes
+#############################################################
+#
+#   Where train() and validate() get their samples from.
+#   Samples are asked for a block at a time (in training
+#   order, which may be shuffled) and only have to stay
+#   valid until the next block is staged, so a source can
+#   keep its data in any compact form and expand just the
+#   block in use to doubles. Targets are class ids - the
+#   network compares its output against the one-hot vector
+#   of the id without it ever being built.
+************************************************************/
+class fcnnDataSource {
+public:
+    virtual ~fcnnDataSource() {}
+
+    /* Number of samples in the data set */
+    virtual unsigned int getNumData() const = 0;
+
+    /* Points inputs[i] at sample samples[i] and sets labels[i] to its class id for i < count */
+    /* an id past the last output node means the sample has no class (all zero target) */
+    virtual void stageSamples(const unsigned int samples[], const unsigned int& count, double** inputs, uint32_t labels[]) = 0;
+
+    /* False if samples can only be read in order - the source then does its own shuffling */
+    virtual bool allowsShuffle() const { return true; }
+
+    /* Called before every training epoch and before validating */
+    virtual void beginEpoch() {}
+};
+
+/* Data source over inputs that are already fully expanded - nothing is copied */
+class fcnnArrayDataSource : public fcnnDataSource {
+private:
+    double** dataInput = nullptr;
+    const uint32_t* dataLabels = nullptr;
+    uint32_t* ownedLabels = nullptr;    /* labels taken from one-hot outputs */
+    unsigned int numData = 0;
+
+public:
+    fcnnArrayDataSource(double** dataInput, const uint32_t dataLabels[], const unsigned int& numData) : dataInput(dataInput), dataLabels(dataLabels), numData(numData) {}
+
+    /* one-hot (or any) target rows - the largest value of each row is its class */
+    fcnnArrayDataSource(double** dataInput, double** dataOutput, const unsigned int& numData, const unsigned int& outputSize) : dataInput(dataInput), numData(numData) {
+        ownedLabels = new uint32_t[numData + 1];
+        for (unsigned int d = 0; d < numData; d++) {
+            ownedLabels[d] = 0;
+            for (unsigned int i = 1; i < outputSize; i++) {
+                if (dataOutput[d][ownedLabels[d]] < dataOutput[d][i]) {
+                    ownedLabels[d] = i;
+                }
+            }
+        }
+        dataLabels = ownedLabels;
+    }
+    fcnnArrayDataSource(const fcnnArrayDataSource& copy) = delete;
+    void operator=(const fcnnArrayDataSource& copy) = delete;
+    ~fcnnArrayDataSource() { delete[] ownedLabels; }
+
+    unsigned int getNumData() const { return numData; }
+
+    void stageSamples(const unsigned int samples[], const unsigned int& count, double** inputs, uint32_t labels[]) {
+        for (unsigned int i = 0; i < count; i++) {
+            inputs[i] = dataInput[samples[i]];
+            labels[i] = dataLabels[samples[i]];
+        }
+    }
+};
+/************************************************************
+* ///////////////////////////|\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\
+* \\\\\\\\\\\\\\\\\\\\\\\\\\\|///////////////////////////////
+************************************************************/
+
+
+/* How training turns the gradient into a weight update - see fcnn::setOptimizer */
+struct fcnnOptimizerSettings {
+    string name = "SGD";        /* SGD, MOMENTUM, NESTEROV, ADAM or ADAMW */
+    double momentum = 0.9;      /* MOMENTUM, NESTEROV: share of the last step carried into the next */
+    double beta1 = 0.9;         /* ADAM, ADAMW: decay of the gradient average */
+    double beta2 = 0.999;       /* ADAM, ADAMW: decay of the squared gradient average */
+    double epsilon = 1e-8;      /* ADAM, ADAMW: added to the root of the squared gradient average */
+    double weightDecay = 0.01;  /* ADAMW: share of every weight taken off per step, times the learning rate */
+};
+
 /************************************************************
 #############################################################
 #   Fully Connected Neural Network Class
 #############################################################
 #
 #   Class to create fully connected neural network objects.
+#   T is the precision of the weights and every node value
+#   (float or double). Data sources stay double, staged
+#   inputs are converted to T a block at a time.
 ************************************************************/
+template<typename T = double>
 class fcnn {
     
     /* Not needed - could be implemented but I dont think default FCNNs are needed
@@ -140,6 +241,37 @@ private:
         return SIGMOID;
     }
 
+    /*---------------------------------------------*/
+    /* Enum for the loss being trained on */
+    /*---------------------------------------------*/
+    enum lossFunction {
+        SQUARED_ERROR
+        , CROSS_ENTROPY
+    };
+
+    /*---------------------------------------------*/
+    /* Enum for the optimizer updating the weights */
+    /*---------------------------------------------*/
+    enum optimizerKind {
+        SGD
+        , MOMENTUM
+        , NESTEROV
+        , ADAM
+        , ADAMW
+    };
+
+    static string optimizerToString(const optimizerKind& kind) {
+        switch (kind) {
+            case(SGD): { return "SGD"; }
+            case(MOMENTUM): { return "MOMENTUM"; }
+            case(NESTEROV): { return "NESTEROV"; }
+            case(ADAM): { return "ADAM"; }
+            case(ADAMW): { return "ADAMW"; }
+            default: { return ""; }
+        }
+        return "";
+    }
+
     /*---------------------------------------------*/
     /* Enum for certain functions - used for threading */
     /*---------------------------------------------*/
@@ -154,23 +286,46 @@ private:
     unsigned int inputSize = 0;         /* Size of the input */
     unsigned int numLayers = 0;   /* Number of hidden layers including the output layer */
     unsigned int* layerSize = nullptr;  /* Array holds the size for each layer */
-    double*** w = nullptr;              /* Weights for each layer  */
-    double** b = nullptr;               /* Node Bias */
-    double** s = nullptr;               /* Node result prior to activation funtion (s = i[0]*w[0] + i[1]*w[i] ... i[n]*w[n] + b)  */
-    double** y = nullptr;               /* Node result after Activation Node */
+    T** w = nullptr;                    /* Weights for each layer - one aligned block, node k's inputs are row k: w[layer][k * wStride[layer] + input].
+                                        *  Layer 0 is the other way around, input j's weights are row j: w[0][j * wStride[0] + node], so an input
+                                        *  that is 0 (most pixels of an image) skips a whole row. See weightIndex */
+    unsigned int* wStride = nullptr;    /* Row length of each layer's weights - layer 0's size, otherwise the lower layer size, rounded up to whole cache lines */
+    T* nodeArena = nullptr;             /* One aligned block holding b, s, y and errStore of every layer */
+    T** b = nullptr;                    /* Node Bias */
+    T** s = nullptr;                    /* Node result prior to activation funtion (s = i[0]*w[0] + i[1]*w[i] ... i[n]*w[n] + b)  */
+    T** y = nullptr;                    /* Node result after Activation Node */
     double e = 0.1;                     /* Learning Rate */
-    double* error = nullptr;            /* Output Error Array */
-    double** errStore = nullptr;        /* Place to store error calculations during back prop */
-    double*** wN = nullptr;             /* Place to store updated weights */
-    double** bN = nullptr;              /* Place to store updated biases */
+    T** errStore = nullptr;             /* Place to store error calculations during back prop */
     unsigned int lastLayer = 0;         /* Index of the output layer */
     bool useSoftMax = false;            /* Bool to indicate if the FCNN will use softmax on the last layer */
     activationFunction af = SIGMOID;    /* Activation function used by the whole network */
+    lossFunction loss = SQUARED_ERROR;  /* Loss the output errors are the gradient of */
     static unsigned seed;               /* Seed for random number generation */
     static default_random_engine generator; /* Random number generator for initialization of weights */
     static normal_distribution<double> distribution; /* Normal distribution for initialization of weights */
     double averagePredictionTime = 0.0;     /* member used to track the average prediction time of the network */
     double averageEpochTime = 0.0;          /* member used to track the average epoch time of the network */
+    double validationAccuracy = 0.0;        /* accuracy (percent) of the last validation */
+    double validationError = 0.0;           /* average error of the last validation */
+    unsigned int batchSize = 1;             /* Samples per weight update - 1 updates after every sample */
+    unsigned int batchCapacity = 0;         /* Rows the batch buffers were allocated for */
+    static const unsigned int predictRows = 32;   /* Fewest rows predictBatch() puts through the batch products at once */
+    unsigned int** allNodes = nullptr;      /* Thread range of every node of every layer - for batch work on one thread */
+    T* batchArena = nullptr;                /* One aligned block holding the batch input and every layer's batch s, y and errors */
+    T** batchS = nullptr;                   /* Batch of s for each layer - one row per sample, paddedSize(layerSize) apart */
+    T** batchY = nullptr;                   /* Batch of y for each layer */
+    T** batchErr = nullptr;                 /* Batch of errors for each layer */
+    unsigned int stagedCapacity = 0;        /* Rows the staged conversion buffers were allocated for */
+    T* stagedArena = nullptr;               /* Staged inputs converted to T - unused when T is double */
+    T** stagedRows = nullptr;               /* Row pointers into stagedArena */
+    T* inputRow = nullptr;                  /* One input converted to T for predict() - unused when T is double */
+    optimizerKind optimizer = SGD;          /* Optimizer updating the weights - anything but SGD trains through trainBatch */
+    fcnnOptimizerSettings optimizerSettings;    /* Its constants */
+    unsigned long long optimizerSteps = 0;  /* Updates the optimizer state has seen - Adam's bias correction */
+    T* optimizerArena = nullptr;            /* One aligned block holding every layer's gradient and optimizer state */
+    T** gradient = nullptr;                 /* Average gradient of the last batch - per layer the weights (laid out like w) then the biases */
+    T** moment1 = nullptr;                  /* Velocity (MOMENTUM, NESTEROV) or gradient average (ADAM, ADAMW), laid out like gradient */
+    T** moment2 = nullptr;                  /* Squared gradient average (ADAM, ADAMW), laid out like gradient */
 
     /*---------------------------------------------*/
     /** Member required for parallel operation **/
@@ -178,6 +333,9 @@ private:
     static const unsigned int maxThreads = 32000;   /* Maximum possible number of threads */
     unsigned int numThreads = 1;        /* Total number of threads to use during training */
     bool useThreads = false;            /* bool to indicate if the FCNN should use threads */
+    unsigned int stagingSize = 256;     /* Number of samples staged from a data source at once */
+    bool shuffleEachEpoch = false;      /* Bool to indicate if the training order is reshuffled every epoch */
+    default_random_engine shuffleEngine;    /* Random number generator for the training order */
 
     /*---------------------------------------------*/
     /** Structs for argument passing in threads **/
@@ -215,11 +373,11 @@ private:
     struct threadArguments {
         unsigned int threadId = 0;              /* Threads identifier */
         pthread_barrier_t* barrier = nullptr;   /* Barrier array for threads to sync on */
-        double** dataInput = nullptr;           /* Pointer to pass the input array along */
-        double** dataOutput = nullptr;          /* Pointer to pass the label array along */
+        T** dataInput = nullptr;                /* Staged inputs of the current block - shared by all threads */
+        uint32_t* dataLabels = nullptr;         /* Staged class ids of the current block - shared by all threads */
         unsigned int numData = 0;               /* Number of data samples */
         unsigned int epochs = 0;                /* Number of epochs */
-        prediction* p = nullptr;                /* Pointer to store neural network output */
+        prediction<T>* p = nullptr;             /* Pointer to store neural network output */
     };
 
     /*---------------------------------------------*/
@@ -229,6 +387,20 @@ private:
     /* Function used to deallocate all dynamic memory */
     void deleteAll();
 
+    /* Weights and node arrays start on a cache line so rows and layers stream well */
+    static const size_t alignment = 64;
+    static T* allocateAligned(const size_t& count) { return new (std::align_val_t(alignment)) T[(count > 0) ? count : 1]; }
+    static void freeAligned(T* p) { if (p != nullptr) { ::operator delete[](p, std::align_val_t(alignment)); } }
+    static unsigned int paddedSize(const unsigned int& count) {
+        const unsigned int perLine = (unsigned int)(alignment / sizeof(T));
+        return ((count + perLine - 1) / perLine) * perLine;
+    }
+
+    /* Position of the weight from input (or lower node) j to node k of a layer in w[layer] */
+    size_t weightIndex(const unsigned int& layer, const unsigned int& k, const unsigned int& j) const {
+        return (layer == 0) ? (size_t)j * wStride[0] + k : (size_t)k * wStride[layer] + j;
+    }
+
     /* Basic initialization function for FCNN weights and biases */
     double init() const {
         return ((rand() % 2) == 0 ? (((double)(rand() % 1000)) / 100000.0) : (-1.0 * (((double)(rand() % 1000)) / 100000.0)));
@@ -239,6 +411,43 @@ private:
         return ((distribution(generator)) * sqrt(1.0 / (double)numInputs));
     }
 
+    /* Function used to (re)allocate the batch buffers when they have fewer than rows rows */
+    void allocateBatch(const unsigned int& rows);
+
+    /* Function used to deallocate the batch buffers */
+    void deleteBatch();
+
+    /* Number of weights of a layer with row padding - where its biases start in gradient, moment1 and moment2 */
+    size_t layerWeightCount(const unsigned int& layer) const { return (size_t)((layer > 0) ? layerSize[layer] : inputSize) * wStride[layer]; }
+
+    /* Function used to allocate the gradient and optimizer state (zeroed) unless it already is */
+    void allocateOptimizer();
+
+    /* Function used to deallocate the gradient and optimizer state - the next update starts fresh */
+    void deleteOptimizer();
+
+    /* Mini-batches or, for any optimizer but SGD, batches of one - a gradient is needed before the weights change */
+    bool trainsInBatches() const { return batchSize > 1 || optimizer != SGD; }
+
+    /* Function used to put layer's average gradient for the nodes [minNode, maxNode) into gradient from the batch errors */
+    void batchGradient(const unsigned int& layer, const unsigned int& minNode, const unsigned int& maxNode, T** dataInput, const unsigned int& count);
+
+    /* Function used to apply one optimizer step to layer's weights and biases of the nodes [minNode, maxNode) */
+    void optimizerStep(const unsigned int& layer, const unsigned int& minNode, const unsigned int& maxNode);
+
+    /* Function used to run the optimizer kernel over n parameters p, whose gradient and state start at offset */
+    void optimizerRun(T* p, const unsigned int& layer, const size_t& offset, const size_t& n, const adamConstants<T>& constants);
+
+    /* Function used to get the staged rows train() / validate() read - the source's rows when T is double, otherwise
+    *  conversion buffers (see convertStaged) with room for stagingSize inputs */
+    T** stagedInputs(double** dataInput);
+
+    /* Function used to convert the first count staged inputs to T - does nothing when T is double */
+    void convertStaged(double** dataInput, const unsigned int& count);
+
+    /* Function used to deallocate the conversion buffers */
+    void deleteStaged();
+
     /* Function used to get the size of the previous layer */
     unsigned int getPreviousSize(const unsigned int& i) const {
         if (i == 0) {
@@ -247,6 +456,33 @@ private:
         return layerSize[i - 1];
     }
 
+    /* Function used to get the number of samples in the block starting at first */
+    unsigned int getBlockSize(const unsigned int& first, const unsigned int& numData) const {
+        return (numData - first < stagingSize) ? numData - first : stagingSize;
+    }
+
+    /* Function used to get the order samples are visited in - starts as 0, 1, 2, ... */
+    static unsigned int* makeOrder(const unsigned int& numData) {
+        unsigned int* order = new unsigned int[(numData > 0) ? numData : 1];
+        for (unsigned int i = 0; i < numData; i++) {
+            order[i] = i;
+        }
+        return order;
+    }
+
+    /* Function used to shuffle the training order (Fisher-Yates) - does nothing unless shuffleEachEpoch is set and the source allows it */
+    void shuffleOrder(unsigned int* order, const unsigned int& numData, const fcnnDataSource& data) {
+        if (!shuffleEachEpoch || !data.allowsShuffle()) {
+            return;
+        }
+        for (unsigned int i = numData; i > 1; i--) {
+            unsigned int j = uniform_int_distribution<unsigned int>(0, i - 1)(shuffleEngine);
+            unsigned int temp = order[i - 1];
+            order[i - 1] = order[j];
+            order[j] = temp;
+        }
+    }
+
     /* Function used to get the size of the next layer */
     unsigned int getNextSize(const unsigned int& i) const {
         if (i == lastLayer) {
@@ -260,11 +496,11 @@ private:
     /*---------------------------------------------*/
 
     /* Function is used to copy parameters into a thread arguments object */
-    static void setThreadArguments(threadArguments &ta, const unsigned int& threadId, pthread_barrier_t* barrier, double** dataInput, double** dataOutput, const unsigned int& numData, const unsigned int& epochs, prediction *p) {
+    static void setThreadArguments(threadArguments &ta, const unsigned int& threadId, pthread_barrier_t* barrier, T** dataInput, uint32_t* dataLabels, const unsigned int& numData, const unsigned int& epochs, prediction<T> *p) {
         ta.threadId = threadId;
         ta.barrier = barrier;
         ta.dataInput = dataInput;
-        ta.dataOutput = dataOutput;
+        ta.dataLabels = dataLabels;
         ta.numData = numData;
         ta.epochs = epochs;
         ta.p = p;
@@ -289,93 +525,128 @@ private:
     /** FCNN operation functions  **/
     /*---------------------------------------------*/
 
-    /* softmax activation function - only for the last layer (currently) */
-    double softMax(const unsigned int& i) {
-        double sum = 0.0;
-        for (unsigned int j = 0; j < layerSize[lastLayer]; j++) {
-            sum += exp(s[lastLayer][j]);
+    /* Function used to apply the softmax to the output nodes [minNode, maxNode) of s, into y. The largest s is taken off before
+    *  exp so it cannot overflow. The whole layer takes one exp per node, a thread with only part of it recomputes the sum */
+    void softMaxNodes(const unsigned int& minNode, const unsigned int& maxNode, const T* sIn, T* yOut) const {
+        const unsigned int n = layerSize[lastLayer];
+        T maxS = sIn[0];
+        for (unsigned int j = 1; j < n; j++) {
+            if (maxS < sIn[j]) { maxS = sIn[j]; }
+        }
+        T sum = 0;
+        if (minNode == 0 && maxNode == n) {
+            for (unsigned int j = 0; j < n; j++) {
+                yOut[j] = exp(sIn[j] - maxS);
+                sum += yOut[j];
+            }
+            for (unsigned int j = 0; j < n; j++) {
+                yOut[j] /= sum;
+            }
+            return;
+        }
+        for (unsigned int j = 0; j < n; j++) {
+            sum += exp(sIn[j] - maxS);
+        }
+        for (unsigned int j = minNode; j < maxNode; j++) {
+            yOut[j] = exp(sIn[j] - maxS) / sum;
         }
-        return exp(s[lastLayer][i]) / sum;
     }
 
-    /* derivative of the softmax with respect to a certain node */
-    double softMaxDerivative(const unsigned int& i) {
-        /* Some optimization could happen here 
-        
-            right now each thread computes this sum then does
-            thier work. Sum could be computed for all threads just
-            once... Not sure if overhead is worth it. Speed seems
-            negligible 
-        */
-        double sum = 0.0;
-        for (unsigned int j = 0; j < layerSize[lastLayer]; j++) {
-            sum += exp(s[lastLayer][j]);
+    /* Function used to compute scale times the output errors (the gradient of the loss with respect to s) of the nodes
+    *  [minNode, maxNode) for a sample of class label. Cross entropy on a softmax or sigmoid output is just y - target, squared
+    *  error on a softmax goes through the whole jacobian - y[j] * (g[j] - sum over k of g[k] * y[k]) with g = y - target */
+    void outputErrors(const unsigned int& minNode, const unsigned int& maxNode, const T* sIn, const T* yIn, const uint32_t& label, const T& scale, T* errOut) const {
+        if (loss == CROSS_ENTROPY) {
+            for (unsigned int j = minNode; j < maxNode; j++) {
+                errOut[j] = scale * (yIn[j] - ((j == label) ? (T)1 : (T)0));
+            }
+            return;
         }
-        double eVal = exp(s[lastLayer][i]);
-        return ((sum * eVal) - (eVal * eVal)) / (sum * sum);
+        if (useSoftMax) {
+            T dot = 0;
+            for (unsigned int k = 0; k < layerSize[lastLayer]; k++) {
+                dot += (yIn[k] - ((k == label) ? (T)1 : (T)0)) * yIn[k];
+            }
+            for (unsigned int j = minNode; j < maxNode; j++) {
+                errOut[j] = scale * yIn[j] * ((yIn[j] - ((j == label) ? (T)1 : (T)0)) - dot);
+            }
+            return;
+        }
+        for (unsigned int j = minNode; j < maxNode; j++) {
+            errOut[j] = scale * (yIn[j] - ((j == label) ? (T)1 : (T)0));
+        }
+        derivativeNodes(minNode, maxNode, yIn, sIn, errOut);
     }
 
-    /* This function computes the activation function during predictions */
-    double computeActivationFunction(const double& d, const unsigned int& layer, const unsigned int& node) {
-        /* If we are in the last layer and using softmax, call this function */
-        if (layer == lastLayer && useSoftMax) { return softMax(node); }
-
-        /* Switch on the activation function */
+    /* Function used to apply the activation function to the nodes [minNode, maxNode) of s, into y - not for a softmax layer.
+    *  The function is picked once for the whole range, see ActivationKernels.h */
+    void activateNodes(const unsigned int& minNode, const unsigned int& maxNode, const T* sIn, T* yOut) const {
+        if (maxNode <= minNode) {
+            return;
+        }
         switch (af) {
-            case(SIGMOID): { return (1.0 / (1.0 + exp(-d))); }
-            case(RELU): { return (d > 0.0) ? d : 0.0; }
-            case(TANH): { return tanh(d); }
-            case(LEAKY_RELU): { return (d > 0.0) ? d : 0.1 * d; }
-            case(SOFTPLUS): { return log(1 + exp(d)); }
-            default: { return 0; }
+            case(SIGMOID): { SigmoidActivation::forward(sIn + minNode, yOut + minNode, maxNode - minNode); break; }
+            case(TANH): { TanhActivation::forward(sIn + minNode, yOut + minNode, maxNode - minNode); break; }
+            case(RELU): { RectifierActivation<0>::forward(sIn + minNode, yOut + minNode, maxNode - minNode); break; }
+            case(LEAKY_RELU): { RectifierActivation<1>::forward(sIn + minNode, yOut + minNode, maxNode - minNode); break; }
+            case(SOFTPLUS): { SoftplusActivation::forward(sIn + minNode, yOut + minNode, maxNode - minNode); break; }
+            default: { break; }
         }
-        return 0;
     }
 
-    /* This function computes the activation function derivative during backprop */
-    double computeActivationFunctionDerivative(const double& aaf, const double& baf, const unsigned int& layer, const unsigned int& node) {
-        /* aaf means After Activation Function - useful for tanh and sigmoid */
-        /* baf means Before Activiation Function - needed for act funcs that dont have themselves in the derivative */
-
-         /* If we are in the last layer and using softmax, call this function */
-        if (lastLayer == layer && useSoftMax) { return softMaxDerivative(node); }
-
-        /* Switch on the activation function */
+    /* Function used to multiply the errors of the nodes [minNode, maxNode) by the activation function derivative, from y
+    *  (after the activation function) and s (before it) - not for a softmax layer */
+    void derivativeNodes(const unsigned int& minNode, const unsigned int& maxNode, const T* yIn, const T* sIn, T* errInOut) const {
+        if (maxNode <= minNode) {
+            return;
+        }
         switch (af) {
-            case(SIGMOID): { return (aaf * (1.0 - aaf)); }
-            case(RELU): { return (baf > 0.0) ? 1.0 : 0.0; }
-            case(LEAKY_RELU): { return (baf > 0.0) ? 1.0 : 0.1; }
-            case(TANH): { return 1.0 - (aaf * aaf); }
-            case(SOFTPLUS): { return 1.0 / (1.0 + exp(-1.0 * baf)); }
-            default: { return 0; }
+            case(SIGMOID): { SigmoidActivation::backward(yIn + minNode, sIn + minNode, errInOut + minNode, maxNode - minNode); break; }
+            case(TANH): { TanhActivation::backward(yIn + minNode, sIn + minNode, errInOut + minNode, maxNode - minNode); break; }
+            case(RELU): { RectifierActivation<0>::backward(yIn + minNode, sIn + minNode, errInOut + minNode, maxNode - minNode); break; }
+            case(LEAKY_RELU): { RectifierActivation<1>::backward(yIn + minNode, sIn + minNode, errInOut + minNode, maxNode - minNode); break; }
+            case(SOFTPLUS): { SoftplusActivation::backward(yIn + minNode, sIn + minNode, errInOut + minNode, maxNode - minNode); break; }
+            default: { break; }
         }
-        return 0;
     }
 
     /* This predict function used only by threads during training and validation */
-    void predict(double* input, unsigned int** threadRange, prediction& p, pthread_barrier_t* barrier);
-    
-    /* Function used to compute a single node in the NN during forward computation - does the full computation including the activation function */
-    void computeForwardNode(const unsigned int& layer, const unsigned int& node, double* inp, const unsigned int& inpSize);
+    void predict(T* input, unsigned int** threadRange, prediction<T>& p, pthread_barrier_t* barrier);
+
+    /* Function used to get one input in T - the input itself when T is double, otherwise converted into inputRow */
+    T* stagedInput(double* input);
 
+    /* forward pass of one input already in T into s and y - used by predictInto() and the single thread training and validation */
+    void forwardStaged(T* input);
+
+    /* Function used to run count staged inputs forward as one batch into batchS and batchY - threads split every layer by
+    *  threadRange and sync on barrier (nullptr when single threaded) */
+    void forwardBatch(T** dataInput, const unsigned int& count, unsigned int** threadRange, pthread_barrier_t* barrier);
+    
     /* Function used to compute a single node in the NN during forward computation - does the full computation EXCEPT for activation function
     *  This is needed for Softmax because all nodes need to be computed prior to calling the softmax */
-    void computeForwardNode_NoActivationFunction(const unsigned int& layer, const unsigned int& node, double* input, const unsigned int& inputSize);
+    void computeForwardNode_NoActivationFunction(const unsigned int& layer, const unsigned int& node, T* input, const unsigned int& inputSize);
 
-    /* Function used to apply act func to last layer - used together with computeForwardNode_NoActivationFunction */
-    void computeForwardNode_ActivationFunction(const unsigned int& layer, const unsigned int& node, double* input, const unsigned int& inputSize);
+    /* Function used to compute the nodes [minNode, maxNode) of a layer EXCEPT for the activation function - layer 0 is done a row
+    *  of inputs at a time, skipping the inputs that are 0 */
+    void computeNodes(const unsigned int& layer, const unsigned int& minNode, const unsigned int& maxNode, T* input, const unsigned int& inputSize);
 
-    /* Function used to back prop on a single node */
-    void computeBackwardNode(const int& layer, const unsigned int& node, double* input, const unsigned int& inpSize);
+    /* Function used to back prop on the nodes [minNode, maxNode) of a layer - layer -1 updates the input weights of layer 0's nodes [minNode, maxNode) */
+    void computeBackwardNodes(const int& layer, const unsigned int& minNode, const unsigned int& maxNode, T* input);
+
+    /* Function used to train on count staged samples as one batch - forward and back prop are matrix products over the batch
+    *  and the weights are updated once with the average gradient. Threads split every layer by threadRange and sync on barrier
+    *  (nullptr when single threaded) */
+    void trainBatch(T** dataInput, const uint32_t dataLabels[], const unsigned int& count, unsigned int** threadRange, pthread_barrier_t* barrier);
 
     /* Function used to drive the entire training process using threads - called from public train() function */
-    void trainMaster(double** dataInput, double** dataOuput, const unsigned int& numData, const unsigned int& epochs, ostream* out);
+    void trainMaster(fcnnDataSource& data, const unsigned int& epochs, ostream* out = nullptr);
 
     /* Function to train the FCNN from an individual thread - this function is called many times from trainMaster */
     void trainIndividual(void* args);
 
     /* Function used to get stats on the prediction like the error, the answer, and if it was a correct guess */
-    void getPredictionStats(double* answer, unsigned int& answerClass, double& error, bool& correctGuess);
+    void getPredictionStats(const uint32_t& label, unsigned int& answerClass, double& error, bool& correctGuess);
 
     /* Function used to print the results of a validation */
     static void printValidationResults(const unsigned int& outputSize, const double& averagePredictionTime, const double& averageError, const unsigned int& totalCorrect, const unsigned int& numData, const double& accuracy, const unsigned int classCorrectCount[], const unsigned int classCount[], ostream& out);
@@ -384,7 +655,7 @@ private:
     void validateIndividual(void* args);
 
     /* Function to validate a dataset from an individual thread - this function is called many times from validateIndividual */
-    void validateMaster(double** dataInput, double** dataOuput, const unsigned int& numData, ostream* out);
+    void validateMaster(fcnnDataSource& data, ostream* out);
 
     /*  */
     void allocateFcnn(const unsigned int& inputSize, const unsigned int& numLayers, const unsigned int layerSizes[], const unsigned int& numThreads, const bool& useThreads, const string& actFunc, const bool& useSoftMax);
@@ -400,32 +671,119 @@ public:
     ~fcnn() { deleteAll(); }
 
     /* basic prediction function */
-    prediction predict(double* input);
+    prediction<T> predict(double* input);
+
+    /* prediction into out, the output layer's size of values - nothing is allocated */
+    void predictInto(double* input, T* out);
+
+    /* prediction of count inputs at once through the batch products - row d of out (the output layer's size of values)
+    *  is input d's. Nothing is allocated once the batch buffers have room */
+    void predictBatch(double** dataInput, const unsigned int& count, T* out);
 
     /* basic train function */
-    void train(double** dataInput, double** dataOuput, const unsigned int& numData, const unsigned int& epochs, const double& lr, ostream* out);
+    void train(double** dataInput, double** dataOuput, const unsigned int& numData, const unsigned int& epochs = 50, const double& lr = 0.1, ostream* out = nullptr);
+
+    /* train function with a class id for every sample instead of target rows */
+    void train(double** dataInput, const uint32_t dataLabels[], const unsigned int& numData, const unsigned int& epochs, const double& lr, ostream* out);
+
+    /* train function for any data source */
+    void train(fcnnDataSource& data, const unsigned int& epochs, const double& lr, ostream* out);
 
     /* basic validate function */
     void validate(double** dataInput, double** dataOuput, const unsigned int& numData, ostream* out);
 
+    /* validate function with a class id for every sample instead of target rows */
+    void validate(double** dataInput, const uint32_t dataLabels[], const unsigned int& numData, ostream* out);
+
+    /* validate function for any data source */
+    void validate(fcnnDataSource& data, ostream* out);
+
+    /* Number of samples a data source stages at once */
+    void setStagingSize(const unsigned int& size) {
+        stagingSize = (size > 0) ? size : 1;
+        stagingSize = ((stagingSize + batchSize - 1) / batchSize) * batchSize;  /* whole batches per staged block */
+    }
+    unsigned int getStagingSize() const { return stagingSize; }
+
+    /* Samples per weight update - above 1 trains in mini-batches on the average gradient, so a larger batch usually wants a larger learning rate */
+    void setBatchSize(const unsigned int& size) {
+        batchSize = (size > 0) ? size : 1;
+        setStagingSize(stagingSize);
+    }
+    unsigned int getBatchSize() const { return batchSize; }
+
+    /* Reshuffle the training order at the start of every epoch - the same seed gives the same orders */
+    void setShuffle(const bool& shuffleEachEpoch, const unsigned int& seed) {
+        this->shuffleEachEpoch = shuffleEachEpoch;
+        shuffleEngine.seed(seed);
+    }
+
+    /* Loss to train on - SQUARED_ERROR (the default) or CROSS_ENTROPY, which needs a softmax or sigmoid output layer */
+    void setLoss(const string& lossName) {
+        if (lossName == "CROSS_ENTROPY") { loss = CROSS_ENTROPY; }
+        else if (lossName == "SQUARED_ERROR") { loss = SQUARED_ERROR; }
+        else { cout << "Unknown loss \"" << lossName << "\", using SQUARED_ERROR" << endl; loss = SQUARED_ERROR; }
+    }
+
+    /* Optimizer to train with - SGD (the default) steps by the learning rate times the gradient, MOMENTUM and NESTEROV keep
+    *  a velocity, ADAM and ADAMW a gradient average and squared gradient average per weight. Changing the kind drops the state */
+    void setOptimizer(const fcnnOptimizerSettings& settings) {
+        optimizerKind kind = SGD;
+        if (settings.name == "SGD") { kind = SGD; }
+        else if (settings.name == "MOMENTUM") { kind = MOMENTUM; }
+        else if (settings.name == "NESTEROV") { kind = NESTEROV; }
+        else if (settings.name == "ADAM") { kind = ADAM; }
+        else if (settings.name == "ADAMW") { kind = ADAMW; }
+        else { cout << "Unknown optimizer \"" << settings.name << "\", using SGD" << endl; }
+        if (kind != optimizer) {
+            deleteOptimizer();
+        }
+        optimizer = kind;
+        optimizerSettings = settings;
+        optimizerSettings.name = optimizerToString(kind);
+    }
+
     /* Getters */
     double getAverageEpochTime() const { return averageEpochTime; }
     double getAveragePredictionTime() const { return averagePredictionTime; }
+    double getValidationAccuracy() const { return validationAccuracy; }
+    double getValidationError() const { return validationError; }
 
     /* Only constructor for fcnn - used to initialize the entire structure */
     static void determineMostEfficientModel(const unsigned int& inputSize, const unsigned int& numLayers, const unsigned int layerSizes[], const unsigned int& maxThreads, const string& actFunc, const bool& useSoftMax, const bool& printProgress);
 
-    /*  */
+    /* Writes the network (with its precision) to a text file */
     void exportFcnn(const string& outFile) const;
 
-    /*  */
+    /* Reads a network written by exportFcnn - a file of the other precision is converted */
     void importFcnn(const string& outFile);
+
+    /* Name exportFcnn records the precision T under */
+    static string precisionName() { return (sizeof(T) == sizeof(float)) ? "FLOAT32" : "FLOAT64"; }
 };
 
 
-unsigned fcnn::seed = 0;
-default_random_engine fcnn::generator(seed);
-normal_distribution<double> fcnn::distribution(0.0, 1.0);
+template<typename T> unsigned fcnn<T>::seed = 0;
+template<typename T> default_random_engine fcnn<T>::generator(seed);
+template<typename T> normal_distribution<double> fcnn<T>::distribution(0.0, 1.0);
+
+/* Precision an exported network was written in - FLOAT32, FLOAT64 (also for files from before it was recorded) or "" if the file can't be read */
+inline string readFcnnPrecision(const string& fileName) {
+    ifstream inFile(fileName);
+    unsigned int numLayers = 0;
+    if (!(inFile >> numLayers)) {
+        return "";
+    }
+    string token;
+    for (unsigned int i = 0; i < numLayers + 3; i++) {     /* layer sizes, input size, act function, softmax */
+        inFile >> token;
+    }
+    inFile >> ws;
+    if (isalpha(inFile.peek()) && (inFile >> token)) {
+        return token;
+    }
+    return "FLOAT64";
+}
 
 /************************************************************
 * ///////////////////////////|\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\
@@ -442,7 +800,8 @@ normal_distribution<double> fcnn::distribution(0.0, 1.0);
 *
 *  See helperNode struct & functionToCall enum for more information
 **************************************************************/
-void* fcnn::callMemberFunctionForThread(void* args) {
+template<typename T>
+void* fcnn<T>::callMemberFunctionForThread(void* args) {
     helperNode* hn = (helperNode*)args; /* Copy the argument reference */
     switch (hn->ftc) { /* Check which function to call */
     case(TRAIN_THREAD): { /* Standard training function for threads */
@@ -469,7 +828,8 @@ void* fcnn::callMemberFunctionForThread(void* args) {
 *  just the dynamic allocation of the structure and init
 *  of all members
 **************************************************************/
-void fcnn::allocateFcnn(const unsigned int& inputSize, const unsigned int& numLayers, const unsigned int layerSizes[], const unsigned int& numThreads, const bool& useThreads, const string& actFunc, const bool& useSoftMax){
+template<typename T>
+void fcnn<T>::allocateFcnn(const unsigned int& inputSize, const unsigned int& numLayers, const unsigned int layerSizes[], const unsigned int& numThreads, const bool& useThreads, const string& actFunc, const bool& useSoftMax){
     
     this->inputSize = inputSize;
     this->numLayers = numLayers;
@@ -486,45 +846,65 @@ void fcnn::allocateFcnn(const unsigned int& inputSize, const unsigned int& numLa
         layerSize[i] = layerSizes[i];                 /* deep copy */
     }
     /* allocate fcnn structure */
-    s = new double* [numLayers];
-    b = new double* [numLayers];
-    y = new double* [numLayers];
-    errStore = new double* [numLayers];
-    bN = new double* [numLayers];
-    w = new double** [numLayers];
-    wN = new double** [numLayers];
+    s = new T* [numLayers];
+    b = new T* [numLayers];
+    y = new T* [numLayers];
+    errStore = new T* [numLayers];
+    w = new T* [numLayers];
+    wStride = new unsigned int[numLayers];
+
+    /* node arrays - every layer's run of each starts on a cache line */
+    size_t nodesPadded = 0;
+    for (unsigned int i = 0; i < numLayers; i++) {
+        nodesPadded += paddedSize(layerSize[i]);
+    }
+    nodeArena = allocateAligned(nodesPadded * 4);
+    T* next = nodeArena;
+    for (unsigned int i = 0; i < numLayers; i++) {
+        size_t padded = paddedSize(layerSize[i]);
+        s[i] = next;
+        b[i] = next + nodesPadded;
+        y[i] = next + nodesPadded * 2;
+        errStore[i] = next + nodesPadded * 3;
+        next += padded;
+    }
+    for (size_t i = 0; i < nodesPadded * 4; i++) {
+        nodeArena[i] = 0.0;
+    }
+
     for (unsigned int i = 0; i < numLayers; i++) {
-        s[i] = new double[layerSize[i]];
-        b[i] = new double[layerSize[i]];
-        y[i] = new double[layerSize[i]];
-        for (unsigned int j = 0; j < layerSize[i]; j++) { y[i][j] = 0.0; s[i][j] = 0.0; }
-        errStore[i] = new double[layerSize[i]];
-        bN[i] = new double[layerSize[i]];
         unsigned int lowerSize = inputSize;
         if (i > 0) {
             lowerSize = layerSize[i - 1];
         }
-        w[i] = new double* [lowerSize];
-        wN[i] = new double* [lowerSize];
+        wStride[i] = paddedSize((i > 0) ? lowerSize : layerSize[0]);
+        size_t layerWeights = (size_t)((i > 0) ? layerSize[i] : inputSize) * wStride[i];
+        w[i] = allocateAligned(layerWeights);
+        for (size_t j = 0; j < layerWeights; j++) {
+            w[i][j] = 0.0;
+        }
+        /* drawn input by input as before, so a seed gives the same network */
         for (unsigned int j = 0; j < lowerSize; j++) {
-            w[i][j] = new double[layerSize[i]];
-            wN[i][j] = new double[layerSize[i]];
             for (unsigned int k = 0; k < layerSize[i]; k++) {
-                w[i][j][k] = init(lowerSize);   /* weight initialization here */
-                wN[i][j][k] = w[i][j][k];
+                w[i][weightIndex(i, k, j)] = init(lowerSize);   /* weight initialization here */
             }
         }
         for (unsigned int j = 0; j < layerSize[i]; j++) {
             b[i][j] = init(lowerSize); /* bias initialization here */
-            bN[i][j] = b[i][j];
         }
     }
 
     /* Last layer for ease of access */
     lastLayer = numLayers - 1;
 
-    /* Error for predictions */
-    error = new double[layerSize[lastLayer]];
+    /* every node of every layer, one range of two per layer */
+    allNodes = new unsigned int* [numLayers];
+    unsigned int* ranges = new unsigned int[2 * numLayers];
+    for (unsigned int i = 0; i < numLayers; i++) {
+        allNodes[i] = ranges + 2 * i;
+        allNodes[i][0] = 0;
+        allNodes[i][1] = layerSize[i];
+    }
 
     /* Activation functions */
     if (actFunc == "SIGMOID") { af = SIGMOID; }
@@ -539,33 +919,26 @@ void fcnn::allocateFcnn(const unsigned int& inputSize, const unsigned int& numLa
 ---------------------------------------------------------------
 *  Deallocate everything
 **************************************************************/
-void fcnn::deleteAll() {
+template<typename T>
+void fcnn<T>::deleteAll() {
+    deleteBatch();
+    deleteStaged();
+    deleteOptimizer();
     for (unsigned int i = 0; i < numLayers; i++) {
-        unsigned int lowerSize = inputSize;
-        if (i > 0) {
-            lowerSize = layerSize[i - 1];
-        }
-        for (unsigned int j = 0; j < lowerSize; j++) {
-            delete[] w[i][j];
-            delete[] wN[i][j];
-        }
-        delete[] s[i];
-        delete[] b[i];
-        delete[] y[i];
-        delete[] errStore[i];
-        delete[] bN[i];
-        delete[] w[i];
-        delete[] wN[i];
+        freeAligned(w[i]);
+    }
+    freeAligned(nodeArena);
+    if (allNodes != nullptr) {
+        delete[] allNodes[0];
+        delete[] allNodes;
     }
+    delete[] wStride;
     delete[] layerSize;
     delete[] s;
     delete[] b;
     delete[] y;
     delete[] errStore;
-    delete[] bN;
     delete[] w;
-    delete[] wN;
-    delete[] error;
 
     inputSize = 0;
     numLayers = 0;
@@ -575,9 +948,179 @@ void fcnn::deleteAll() {
     s = nullptr;
     y = nullptr;
     errStore = nullptr;
-    wN = nullptr;
-    bN = nullptr;
-    error = nullptr;
+    wStride = nullptr;
+    nodeArena = nullptr;
+    allNodes = nullptr;
+}
+
+/**************************************************************
+*  allocateBatch
+---------------------------------------------------------------
+*  Allocate the batch buffers for rows samples, unless they
+*  already have room. Rows are padded like the weights so a
+*  batch row lines up with a weight row, and the padding
+*  stays zero.
+**************************************************************/
+template<typename T>
+void fcnn<T>::allocateBatch(const unsigned int& rows) {
+    if (batchCapacity >= rows) {
+        return;
+    }
+    deleteBatch();
+
+    size_t total = 0;
+    for (unsigned int i = 0; i < numLayers; i++) {
+        total += (size_t)3 * rows * paddedSize(layerSize[i]);
+    }
+    batchArena = allocateAligned(total);
+    memset(batchArena, 0, total * sizeof(T));
+
+    batchS = new T* [numLayers];
+    batchY = new T* [numLayers];
+    batchErr = new T* [numLayers];
+    T* next = batchArena;
+    for (unsigned int i = 0; i < numLayers; i++) {
+        size_t layerRows = (size_t)rows * paddedSize(layerSize[i]);
+        batchS[i] = next; next += layerRows;
+        batchY[i] = next; next += layerRows;
+        batchErr[i] = next; next += layerRows;
+    }
+    batchCapacity = rows;
+}
+
+/**************************************************************
+*  deleteBatch
+---------------------------------------------------------------
+*  Deallocate the batch buffers
+**************************************************************/
+template<typename T>
+void fcnn<T>::deleteBatch() {
+    freeAligned(batchArena);
+    delete[] batchS;
+    delete[] batchY;
+    delete[] batchErr;
+    batchArena = nullptr;
+    batchS = nullptr;
+    batchY = nullptr;
+    batchErr = nullptr;
+    batchCapacity = 0;
+}
+
+/**************************************************************
+*  stagedInputs
+---------------------------------------------------------------
+*  Rows the training and validation loops read staged inputs
+*  from. A double network reads the data source's rows as
+*  they are, any other precision gets rows of its own that
+*  convertStaged fills after every block is staged.
+**************************************************************/
+template<typename T>
+T** fcnn<T>::stagedInputs(double** dataInput) {
+    if constexpr (is_same<T, double>::value) {
+        return dataInput;
+    }
+    else {
+        if (stagedCapacity != stagingSize) {
+            deleteStaged();
+            stagedArena = allocateAligned((size_t)stagingSize * paddedSize(inputSize));
+            stagedRows = new T* [stagingSize];
+            for (unsigned int i = 0; i < stagingSize; i++) {
+                stagedRows[i] = stagedArena + (size_t)i * paddedSize(inputSize);
+            }
+            stagedCapacity = stagingSize;
+        }
+        return stagedRows;
+    }
+}
+
+/**************************************************************
+*  convertStaged
+---------------------------------------------------------------
+*  Convert the first count staged inputs into the rows
+*  stagedInputs handed out
+**************************************************************/
+template<typename T>
+void fcnn<T>::convertStaged(double** dataInput, const unsigned int& count) {
+    if constexpr (!is_same<T, double>::value) {
+        for (unsigned int d = 0; d < count; d++) {
+            const double* from = dataInput[d];
+            T* to = stagedRows[d];
+            for (unsigned int j = 0; j < inputSize; j++) {
+                to[j] = (T)from[j];
+            }
+        }
+    }
+}
+
+/**************************************************************
+*  deleteStaged
+---------------------------------------------------------------
+*  Deallocate the conversion buffers
+**************************************************************/
+template<typename T>
+void fcnn<T>::deleteStaged() {
+    freeAligned(stagedArena);
+    freeAligned(inputRow);
+    delete[] stagedRows;
+    stagedArena = nullptr;
+    stagedRows = nullptr;
+    inputRow = nullptr;
+    stagedCapacity = 0;
+}
+
+/**************************************************************
+*  allocateOptimizer
+---------------------------------------------------------------
+*  Allocate the gradient and the optimizer state, all zero.
+*  Each layer's block is its weights (same rows and padding as
+*  w) followed by its biases, so one offset finds a weight's
+*  gradient, velocity and moments.
+**************************************************************/
+template<typename T>
+void fcnn<T>::allocateOptimizer() {
+    if (optimizerArena != nullptr) {
+        return;
+    }
+    const bool adam = (optimizer == ADAM || optimizer == ADAMW);
+    size_t perBuffer = 0;
+    for (unsigned int i = 0; i < numLayers; i++) {
+        perBuffer += layerWeightCount(i) + paddedSize(layerSize[i]);
+    }
+    size_t total = perBuffer * (adam ? 3 : 2);
+    optimizerArena = allocateAligned(total);
+    memset(optimizerArena, 0, total * sizeof(T));
+
+    gradient = new T* [numLayers];
+    moment1 = new T* [numLayers];
+    moment2 = adam ? new T* [numLayers] : nullptr;
+    T* next = optimizerArena;
+    for (unsigned int i = 0; i < numLayers; i++) {
+        size_t layerParameters = layerWeightCount(i) + paddedSize(layerSize[i]);
+        gradient[i] = next;
+        moment1[i] = next + perBuffer;
+        if (adam) {
+            moment2[i] = next + perBuffer * 2;
+        }
+        next += layerParameters;
+    }
+}
+
+/**************************************************************
+*  deleteOptimizer
+---------------------------------------------------------------
+*  Deallocate the gradient and optimizer state
+**************************************************************/
+template<typename T>
+void fcnn<T>::deleteOptimizer() {
+    freeAligned(optimizerArena);
+    delete[] gradient;
+    delete[] moment1;
+    delete[] moment2;
+    optimizerArena = nullptr;
+    gradient = nullptr;
+    moment1 = nullptr;
+    moment2 = nullptr;
+    optimizerSteps = 0;
 }
 
 /******************************************************************************
@@ -590,9 +1133,14 @@ void fcnn::deleteAll() {
  * input size
  * act function
  * softmax output
+ * precision (FLOAT32 or FLOAT64)
  * weights & biases by layer....
+ * OPTIMIZER, its name and step count, then its state (velocity or gradient
+ *     average, then the squared gradient average for Adam) in the order of
+ *     the weights & biases - only once an optimizer other than SGD trained
 *******************************************************************************/
-void fcnn::exportFcnn(const string& outFile) const {
+template<typename T>
+void fcnn<T>::exportFcnn(const string& outFile) const {
     ofstream outputFile;
     outputFile.open(outFile);
     if (!outputFile.is_open()) {
@@ -606,6 +1154,7 @@ void fcnn::exportFcnn(const string& outFile) const {
     outputFile << inputSize << endl;
     outputFile << activationFunctionToString(af) << endl;
     outputFile << (useSoftMax ? "TRUE" : "FALSE") << endl;
+    outputFile << precisionName() << endl;
 
     unsigned int pSize = inputSize;
     for (unsigned int i = 0; i < numLayers; i++) {
@@ -614,11 +1163,34 @@ void fcnn::exportFcnn(const string& outFile) const {
         }
         for (unsigned int j = 0; j < layerSize[i]; j++) {
             for (unsigned int k = 0; k < pSize; k++) {
-                outputFile << w[i][k][j] << endl;
+                outputFile << w[i][weightIndex(i, j, k)] << endl;
             }
             outputFile << b[i][j] << endl;
         }
     }
+
+    /* optimizer state, so training can go on where it stopped */
+    if (optimizerArena != nullptr) {
+        outputFile << "OPTIMIZER" << endl;
+        outputFile << optimizerToString(optimizer) << endl;
+        outputFile << optimizerSteps << endl;
+        T** states[2] = { moment1, moment2 };
+        for (unsigned int state = 0; state < 2 && states[state] != nullptr; state++) {
+            pSize = inputSize;
+            for (unsigned int i = 0; i < numLayers; i++) {
+                if (i > 0) {
+                    pSize = layerSize[i - 1];
+                }
+                size_t biases = layerWeightCount(i);
+                for (unsigned int j = 0; j < layerSize[i]; j++) {
+                    for (unsigned int k = 0; k < pSize; k++) {
+                        outputFile << states[state][i][weightIndex(i, j, k)] << endl;
+                    }
+                    outputFile << states[state][i][biases + j] << endl;
+                }
+            }
+        }
+    }
     outputFile.close();
 }
 
@@ -632,9 +1204,14 @@ void fcnn::exportFcnn(const string& outFile) const {
  * input size
  * act function
  * softmax output
+ * precision (FLOAT32 or FLOAT64) - missing in files from before it was
+ *     recorded, which are FLOAT64
  * weights & biases by layer....
+ * optimizer state (see exportFcnn) - only loaded when it is for the
+ *     optimizer this network trains with, which then goes on from it
 *******************************************************************************/
-void fcnn::importFcnn(const string& inFileName) {
+template<typename T>
+void fcnn<T>::importFcnn(const string& inFileName) {
     deleteAll();
     ifstream inFile;
     inFile.open(inFileName);
@@ -657,6 +1234,12 @@ void fcnn::importFcnn(const string& inFileName) {
     inFile >> s;
     useSoftMax = (s == "TRUE");
 
+    /* weights are read into T whatever precision they were written in */
+    inFile >> ws;
+    if (isalpha(inFile.peek())) {
+        inFile >> s;
+    }
+
     allocateFcnn(inputSize, numLayers, layers, numThreads, useThreads, afs, useSoftMax);
 
     unsigned int pSize = inputSize;
@@ -666,120 +1249,237 @@ void fcnn::importFcnn(const string& inFileName) {
         }
         for (unsigned int j = 0; j < layerSize[i]; j++) {
             for (unsigned int k = 0; k < pSize; k++) {
-                inFile >> w[i][k][j];
+                inFile >> w[i][weightIndex(i, j, k)];
             }
             inFile >> b[i][j];
         }
     }
+
+    inFile >> ws;
+    if (isalpha(inFile.peek())) {
+        string savedOptimizer;
+        unsigned long long savedSteps = 0;
+        inFile >> s >> savedOptimizer >> savedSteps;
+        bool keep = (savedOptimizer == optimizerToString(optimizer));
+        if (keep) {
+            allocateOptimizer();
+            optimizerSteps = savedSteps;
+        }
+        else {
+            cout << "Skipping the " << savedOptimizer << " state in " << inFileName << ", training with " << optimizerToString(optimizer) << endl;
+        }
+        unsigned int numStates = (savedOptimizer == "ADAM" || savedOptimizer == "ADAMW") ? 2 : 1;
+        for (unsigned int state = 0; state < numStates; state++) {
+            T** to = (state == 0) ? moment1 : moment2;
+            pSize = inputSize;
+            for (unsigned int i = 0; i < numLayers; i++) {
+                if (i > 0) {
+                    pSize = layerSize[i - 1];
+                }
+                size_t biases = layerWeightCount(i);
+                for (unsigned int j = 0; j < layerSize[i]; j++) {
+                    T value = 0;
+                    for (unsigned int k = 0; k < pSize; k++) {
+                        inFile >> value;
+                        if (keep) { to[i][weightIndex(i, j, k)] = value; }
+                    }
+                    inFile >> value;
+                    if (keep) { to[i][biases + j] = value; }
+                }
+            }
+        }
+    }
     inFile.close();
 }
 
 
 /******************************************************************************
- * computeForwardNode
+ * computeForwardNode_NoActivationFunction
 -------------------------------------------------------------------------------
  * computes a single node going forward
- * include activation function
+ * no activation function
 *******************************************************************************/
-void fcnn::computeForwardNode(const unsigned int& layer, const unsigned int& node, double* input, const unsigned int& inputSize) {
-    s[layer][node] = 0;
-    for (unsigned int j = 0; j < inputSize; j++) {
-        s[layer][node] += w[layer][j][node] * input[j];
+template<typename T>
+void fcnn<T>::computeForwardNode_NoActivationFunction(const unsigned int& layer, const unsigned int& node, T* input, const unsigned int& inputSize) {
+    if (layer == 0) {
+        computeNodes(0, node, node + 1, input, inputSize);
+        return;
     }
-    s[layer][node] += b[layer][node];
-    y[layer][node] = computeActivationFunction(s[layer][node], layer, node);
+    const T* row = w[layer] + (size_t)node * wStride[layer];
+    s[layer][node] = SimdKernels::dot(row, input, inputSize) + b[layer][node];
 }
 
 /******************************************************************************
- * computeForwardNode_NoActivationFunction
+ * computeNodes
 -------------------------------------------------------------------------------
- * computes a single node going forward
- * no activation function
+ * computes the nodes [minNode, maxNode) of a layer going forward
+ * no activation function. Layer 0 adds up the weight rows of the inputs
+ * that are not 0, so it costs in proportion to the set pixels of an image
 *******************************************************************************/
-void fcnn::computeForwardNode_NoActivationFunction(const unsigned int& layer, const unsigned int& node, double* input, const unsigned int& inputSize) {
-    s[layer][node] = 0;
-    for (unsigned int j = 0; j < inputSize; j++) {
-        s[layer][node] += w[layer][j][node] * input[j];
+template<typename T>
+void fcnn<T>::computeNodes(const unsigned int& layer, const unsigned int& minNode, const unsigned int& maxNode, T* input, const unsigned int& inputSize) {
+    if (layer == 0) {
+        gemmXB((size_t)1, minNode, maxNode, inputSize, &input, w[0], wStride[0], b[0], s[0], (size_t)0);
+        return;
+    }
+    for (unsigned int j = minNode; j < maxNode; j++) {
+        computeForwardNode_NoActivationFunction(layer, j, input, inputSize);
     }
-    s[layer][node] += b[layer][node];
 }
 
 /******************************************************************************
- * computeForwardNode_SoftmaxLastLayer
+ * computeBackwardNodes FUNCTION
 -------------------------------------------------------------------------------
- * apply activation function to node
+ * Back prop for the nodes [minNode, maxNode) of a layer. The layer above is
+ * walked row by row (one row per upper node), so both the weight updates
+ * and the error sums of the lower nodes are unit stride. Each row segment
+ * is added into the error sums before it is updated in place, and only the
+ * thread owning [minNode, maxNode) touches those columns, so no stale or
+ * half updated weight is ever read. Layer -1 updates layer 0's weights to
+ * the nodes [minNode, maxNode) from the inputs that are not 0 - the other
+ * inputs' rows would not change.
 *******************************************************************************/
-void fcnn::computeForwardNode_ActivationFunction(const unsigned int& layer, const unsigned int& node, double* input, const unsigned int& inputSize) {
-    y[layer][node] = computeActivationFunction(s[layer][node], layer, node);
+template<typename T>
+void fcnn<T>::computeBackwardNodes(const int& layer, const unsigned int& minNode, const unsigned int& maxNode, T* input) {
+    if (layer >= 0) {
+        const unsigned int upper = layer + 1;
+        const unsigned int stride = wStride[upper];
+        T* sumZ = errStore[layer];
+        const T* lower = y[layer];
+        for (unsigned int j = minNode; j < maxNode; j++) {
+            sumZ[j] = 0;
+        }
+        if (maxNode <= minNode) {
+            return;
+        }
+        for (unsigned int i = 0; i < layerSize[upper]; i++) {
+            const T err = errStore[upper][i];
+            T* row = w[upper] + (size_t)i * stride + minNode;
+            SimdKernels::axpy(err, row, sumZ + minNode, maxNode - minNode);
+            SimdKernels::axpy(-err, lower + minNode, row, maxNode - minNode);
+        }
+        derivativeNodes(minNode, maxNode, y[layer], s[layer], errStore[layer]);
+        for (unsigned int j = minNode; j < maxNode; j++) {
+            b[layer][j] -= errStore[layer][j];
+        }
+    }
+    else {
+        gemmXtAUpdate((size_t)1, minNode, maxNode, inputSize, (T)1, errStore[0], (size_t)0, &input, w[0], wStride[0]);
+    }
 }
 
 /******************************************************************************
- * computeBackwardNode FUNCTION
+ * PREDICTION FUNCTION
 -------------------------------------------------------------------------------
- *
+ * This member function takes input for the neural network
+ * and makes a prediction.
 *******************************************************************************/
-void fcnn::computeBackwardNode(const int& layer, const unsigned int& node, double* input, const unsigned int& inputSize) {
-    if (layer >= 0) {
-        double sumZ = 0;
-        for (unsigned int i = 0; i < inputSize; i++) {
-            wN[layer + 1][node][i] = w[layer + 1][node][i] - ((errStore[layer + 1][i]) * y[layer][node]);
-            sumZ += errStore[layer + 1][i] * w[layer + 1][node][i];
+template<typename T>
+prediction<T> fcnn<T>::predict(double* input) {
+    prediction<T> p(layerSize[lastLayer]); /* Init prediction array */
+    predictInto(input, p.getData());
+    return p;
+}
+
+/******************************************************************************
+ * predictInto
+-------------------------------------------------------------------------------
+ * Prediction into a buffer the caller owns, so a loop of predictions does
+ * not allocate
+*******************************************************************************/
+template<typename T>
+void fcnn<T>::predictInto(double* input, T* out) {
+    forwardStaged(stagedInput(input));
+    for (unsigned int j = 0; j < layerSize[lastLayer]; j++) {
+        out[j] = y[lastLayer][j];
+    }
+}
+
+/******************************************************************************
+ * predictBatch
+-------------------------------------------------------------------------------
+ * Predictions of count inputs, a batch at a time through forwardBatch. A
+ * batch is the training batch size but at least predictRows (and at most a
+ * staged block, which float inputs are converted into), so even a network
+ * trained one sample at a time predicts with the matrix products. Row d of
+ * out gets the output of input d.
+*******************************************************************************/
+template<typename T>
+void fcnn<T>::predictBatch(double** dataInput, const unsigned int& count, T* out) {
+    unsigned int rows = (stagingSize < predictRows) ? stagingSize : predictRows;
+    rows = (batchSize > rows) ? batchSize : rows;
+    allocateBatch(rows);
+
+    const unsigned int outputSize = layerSize[lastLayer];
+    const size_t ld = paddedSize(outputSize);
+    for (unsigned int first = 0; first < count; first += rows) {
+        unsigned int batchCount = (count - first < rows) ? count - first : rows;
+        T** inputs = stagedInputs(dataInput + first);    /* the rows themselves when T is double */
+        convertStaged(dataInput + first, batchCount);
+        forwardBatch(inputs, batchCount, allNodes, nullptr);
+        for (unsigned int m = 0; m < batchCount; m++) {
+            const T* yRow = batchY[lastLayer] + m * ld;
+            T* outRow = out + (size_t)(first + m) * outputSize;
+            for (unsigned int j = 0; j < outputSize; j++) {
+                outRow[j] = yRow[j];
+            }
         }
-        errStore[layer][node] = sumZ * computeActivationFunctionDerivative(y[layer][node], s[layer][node], layer, node);
-        bN[layer][node] = b[layer][node] - errStore[layer][node];
+    }
+}
+
+/******************************************************************************
+ * stagedInput
+-------------------------------------------------------------------------------
+ * One input in T. A double network reads it where it is, any other
+ * precision converts it into inputRow.
+*******************************************************************************/
+template<typename T>
+T* fcnn<T>::stagedInput(double* input) {
+    if constexpr (is_same<T, double>::value) {
+        return input;
     }
     else {
-        for (unsigned int i = 0; i < inputSize; i++) {
-            wN[0][node][i] = w[0][node][i] - ((errStore[0][i]) * input[node]);
+        if (inputRow == nullptr) {
+            inputRow = allocateAligned(inputSize);
         }
+        for (unsigned int j = 0; j < inputSize; j++) {
+            inputRow[j] = (T)input[j];
+        }
+        return inputRow;
     }
 }
 
 /******************************************************************************
- * PREDICTION FUNCTION
+ * forwardStaged
 -------------------------------------------------------------------------------
- * This member function takes input for the neural network
- * and makes a prediction.
+ * The prediction itself, on an input that is already in T. The output is
+ * left in y[lastLayer].
 *******************************************************************************/
-prediction fcnn::predict(double* input) {
+template<typename T>
+void fcnn<T>::forwardStaged(T* input) {
     
-    prediction p(layerSize[lastLayer]); /* Init prediction array */
-    double* inp = nullptr;      /* dynamic pointer to switch the input array */
+    T* inp = nullptr;           /* dynamic pointer to switch the input array */
     unsigned int inpSize = 0;   /* dynamic variable to swtich the input size */
 
     /* Hidden layer computation */
     for (unsigned int i = 0; i < lastLayer; i++) {
         inp = (i > 0) ? y[i - 1] : input;
         inpSize = (i > 0) ? layerSize[i - 1] : inputSize;
-        for (unsigned int j = 0; j < layerSize[i]; j++) {
-            computeForwardNode(i, j, inp, inpSize);
-        }
+        computeNodes(i, 0, layerSize[i], inp, inpSize);
+        activateNodes(0, layerSize[i], s[i], y[i]);
     }
 
     /* last layer */
     inp = (lastLayer > 0) ? y[lastLayer - 1] : input;
     inpSize = (lastLayer > 0) ? layerSize[lastLayer - 1] : inputSize;
     
-    /* if no soft max */
+    computeNodes(lastLayer, 0, layerSize[lastLayer], inp, inpSize);
     if (!useSoftMax) {
-        for (unsigned int j = 0; j < layerSize[lastLayer]; j++) {
-            computeForwardNode(lastLayer, j, inp, inpSize);
-            p[j] = y[lastLayer][j];
-        }
+        activateNodes(0, layerSize[lastLayer], s[lastLayer], y[lastLayer]);
     }
-    /* else, soft max */
     else {
-        for (unsigned int j = 0; j < layerSize[lastLayer]; j++) {
-            computeForwardNode_NoActivationFunction(lastLayer, j, inp, inpSize);
-        }
-        for (unsigned int j = 0; j < layerSize[lastLayer]; j++) {
-            computeForwardNode_ActivationFunction(lastLayer, j, inp, inpSize);
-            p[j] = y[lastLayer][j];
-        }
+        softMaxNodes(0, layerSize[lastLayer], s[lastLayer], y[lastLayer]);
     }
-    
-    /* all done! */
-    return p;
 }
 
 /******************************************************************************
@@ -787,59 +1487,99 @@ prediction fcnn::predict(double* input) {
 -------------------------------------------------------------------------------
 *  This function trains the entire network on a data set
 *******************************************************************************/
-void fcnn::train(double** dataInput, double** dataOutput, const unsigned int& numData, const unsigned int& epochs = 50, const double& lr = 0.1, ostream* out = nullptr) {
+template<typename T>
+void fcnn<T>::train(double** dataInput, double** dataOutput, const unsigned int& numData, const unsigned int& epochs, const double& lr, ostream* out) {
+    fcnnArrayDataSource data(dataInput, dataOutput, numData, layerSize[lastLayer]);
+    train(data, epochs, lr, out);
+}
+
+/******************************************************************************
+ * TRAIN FUNCTION (class ids)
+-------------------------------------------------------------------------------
+*  This function trains the entire network on a data set labelled with
+*  class ids
+*******************************************************************************/
+template<typename T>
+void fcnn<T>::train(double** dataInput, const uint32_t dataLabels[], const unsigned int& numData, const unsigned int& epochs, const double& lr, ostream* out) {
+    fcnnArrayDataSource data(dataInput, dataLabels, numData);
+    train(data, epochs, lr, out);
+}
+
+/******************************************************************************
+ * TRAIN FUNCTION (data source)
+-------------------------------------------------------------------------------
+*  This function trains the entire network on a data source, a block of
+*  stagingSize samples at a time
+*******************************************************************************/
+template<typename T>
+void fcnn<T>::train(fcnnDataSource& data, const unsigned int& epochs, const double& lr, ostream* out) {
     
     e = lr; /* set up the learning rate */
+    if (trainsInBatches()) {
+        allocateBatch(batchSize);
+    }
+    if (optimizer != SGD) {
+        allocateOptimizer();
+    }
+    if (loss == CROSS_ENTROPY && !useSoftMax && af != SIGMOID) {
+        cout << "Cross entropy needs a softmax or sigmoid output layer, training on SQUARED_ERROR" << endl;
+        loss = SQUARED_ERROR;
+    }
 
     /* If using threads, we gotta go to a different function */
     if (useThreads) {
-        trainMaster(dataInput, dataOutput, numData, epochs, out);
+        trainMaster(data, epochs, out);
     }
     /* Single thread operation */
     else {
+        unsigned int numData = data.getNumData();
+        unsigned int* order = makeOrder(numData);           /* training order */
+        double** dataInput = new double* [stagingSize];     /* staged block */
+        uint32_t* dataLabels = new uint32_t[stagingSize];
+        T** inputs = stagedInputs(dataInput);                /* staged block in T */
+
         /* Timing var for epoch timing */
         std::chrono::duration<double> elapsed_seconds;  
-        double totalTime = 0;
         averageEpochTime = 0;
         /* For all epochs */
         for (unsigned int epc = 0; epc < epochs; epc++) {
             auto start = std::chrono::system_clock::now();  /* Start the timer */
+            data.beginEpoch();
+            shuffleOrder(order, numData, data);
             /* for all data instances */
-            for (unsigned int d = 0; d < numData; d++) {
+            for (unsigned int first = 0; first < numData; first += stagingSize) {
+                unsigned int blockSize = getBlockSize(first, numData);
+                data.stageSamples(order + first, blockSize, dataInput, dataLabels);
+                convertStaged(dataInput, blockSize);
+
+                /* mini-batches */
+                if (trainsInBatches()) {
+                    for (unsigned int d = 0; d < blockSize; d += batchSize) {
+                        unsigned int count = (blockSize - d < batchSize) ? blockSize - d : batchSize;
+                        trainBatch(inputs + d, dataLabels + d, count, allNodes, nullptr);
+                        optimizerSteps++;
+                    }
+                    continue;
+                }
 
-                /* make a prediction */
-                prediction p = predict(dataInput[d]);
+                for (unsigned int d = 0; d < blockSize; d++) {
 
-                /* compute the error and begin back prop on last layer */
-                for (unsigned int i = 0; i < layerSize[lastLayer]; i++) {
-                    error[i] = p[i] - dataOutput[d][i];
-                    errStore[lastLayer][i] = (e * error[i] * computeActivationFunctionDerivative(y[lastLayer][i], s[lastLayer][i], lastLayer, i));
-                    bN[lastLayer][i] = b[lastLayer][i] - errStore[lastLayer][i];
-                }
+                    /* forward pass - the output errors read y */
+                    forwardStaged(inputs[d]);
 
-                /* back prop for all hidden layers */
-                if (numLayers > 1) {
-                    for (int h = numLayers - 2; h >= 0; h--) {
-                        for (unsigned int j = 0; j < layerSize[h]; j++) {
-                            computeBackwardNode(h, j, nullptr, layerSize[h + 1]);
-                        }
+                    /* compute the error and begin back prop on last layer */
+                    outputErrors(0, layerSize[lastLayer], s[lastLayer], y[lastLayer], dataLabels[d], (T)e, errStore[lastLayer]);
+                    for (unsigned int i = 0; i < layerSize[lastLayer]; i++) {
+                        b[lastLayer][i] -= errStore[lastLayer][i];
                     }
-                }
 
-                /* back prop for input layer */
-                for (unsigned int j = 0; j < inputSize; j++) {
-                    computeBackwardNode(-1, j, dataInput[d], layerSize[0]);
-                }
-               
-                /* Reassign new weights and biases */
-                for (unsigned int i = 0; i < numLayers; i++) {
-                    unsigned int lowerSize = (i > 0) ? layerSize[i - 1] : inputSize;
-                    for (unsigned int k = 0; k < layerSize[i]; k++) {
-                        for (unsigned int j = 0; j < lowerSize; j++) {
-                            w[i][j][k] = wN[i][j][k];
-                        }
-                        b[i][k] = bN[i][k];
+                    /* back prop for all hidden layers */
+                    for (int h = numLayers - 2; h >= 0; h--) {
+                        computeBackwardNodes(h, 0, layerSize[h], nullptr);
                     }
+
+                    /* back prop for input layer */
+                    computeBackwardNodes(-1, 0, layerSize[0], inputs[d]);
                 }
             }
 
@@ -853,6 +1593,10 @@ void fcnn::train(double** dataInput, double** dataOutput, const unsigned int& nu
             }
         }
         averageEpochTime /= (double)epochs;
+
+        delete[] order;
+        delete[] dataInput;
+        delete[] dataLabels;
     }
 }
 
@@ -861,7 +1605,8 @@ void fcnn::train(double** dataInput, double** dataOutput, const unsigned int& nu
 -------------------------------------------------------------------------------
  * function to print out some validation results
 *******************************************************************************/
-void fcnn::printValidationResults(const unsigned int& outputSize, const double& averagePredictionTime, const double& averageError, const unsigned int& totalCorrect, const unsigned int& numData, const double& accuracy, const unsigned int classCorrectCount[], const unsigned int classCount[], ostream& out){
+template<typename T>
+void fcnn<T>::printValidationResults(const unsigned int& outputSize, const double& averagePredictionTime, const double& averageError, const unsigned int& totalCorrect, const unsigned int& numData, const double& accuracy, const unsigned int classCorrectCount[], const unsigned int classCount[], ostream& out){
     
     string results = string("-----------------------------------\n")
         + "|  VALIDATION RESULTS             |\n" +
@@ -884,27 +1629,20 @@ void fcnn::printValidationResults(const unsigned int& outputSize, const double&
 -------------------------------------------------------------------------------
  * function checks the current prediction and returns some stats
 *******************************************************************************/
-void fcnn::getPredictionStats(double* answer, unsigned int& answerClass, double& error, bool& correctGuess) {
+template<typename T>
+void fcnn<T>::getPredictionStats(const uint32_t& label, unsigned int& answerClass, double& error, bool& correctGuess) {
     
-    double* guess = y[lastLayer];   /* Network output */
+    const T* guess = y[lastLayer];  /* Network output */
     double sumError = 0.0;          /* Overall error of prediction */
-    unsigned int answerIndex = 0;   /* The actual answer index */
-    double answerValue = answer[0]; /* The actual answer value */
     unsigned int guessIndex = 0;    /* The guessed answer index */
-    double guessValue = guess[0];   /* The guessed answer value */
+    T guessValue = guess[0];        /* The guessed answer value */
 
-    /* For all output nodes */
+    /* For all output nodes - the answer is 1 at label and 0 everywhere else */
     for (unsigned int i = 0; i < layerSize[lastLayer]; i++) {
         /* RMSE - sum part */
-        double indError = answer[i] - guess[i];
+        double indError = ((i == label) ? 1.0 : 0.0) - guess[i];
         sumError += (indError * indError);
 
-        /* Determine the answer */
-        if (answerValue < answer[i]) {
-            answerValue = answer[i];
-            answerIndex = i;
-        }
-
         /* Determine the guess */
         if (guessValue < guess[i]) {
             guessValue = guess[i];
@@ -913,8 +1651,8 @@ void fcnn::getPredictionStats(double* answer, unsigned int& answerClass, double&
     }
 
     error = sqrt(sumError);     /* RMSE - square root part */
-    answerClass = answerIndex;  /* Return the actual class */
-    correctGuess = (guessIndex == answerIndex); /* return whether or not there was a correct guess */
+    answerClass = label;        /* Return the actual class - past the last node if there is none */
+    correctGuess = (guessIndex == label); /* return whether or not there was a correct guess */
 }
 
 /******************************************************************************
@@ -922,14 +1660,40 @@ void fcnn::getPredictionStats(double* answer, unsigned int& answerClass, double&
 -------------------------------------------------------------------------------
  * function to validate a data set
 *******************************************************************************/
-void fcnn::validate(double** dataInput, double** dataOutput, const unsigned int& numData, ostream* out) {
+template<typename T>
+void fcnn<T>::validate(double** dataInput, double** dataOutput, const unsigned int& numData, ostream* out) {
+    fcnnArrayDataSource data(dataInput, dataOutput, numData, layerSize[lastLayer]);
+    validate(data, out);
+}
+
+/******************************************************************************
+ * validate FUNCTION (class ids)
+-------------------------------------------------------------------------------
+ * function to validate a data set labelled with class ids
+*******************************************************************************/
+template<typename T>
+void fcnn<T>::validate(double** dataInput, const uint32_t dataLabels[], const unsigned int& numData, ostream* out) {
+    fcnnArrayDataSource data(dataInput, dataLabels, numData);
+    validate(data, out);
+}
+
+/******************************************************************************
+ * validate FUNCTION (data source)
+-------------------------------------------------------------------------------
+ * function to validate a data source, a block of stagingSize samples at
+ * a time
+*******************************************************************************/
+template<typename T>
+void fcnn<T>::validate(fcnnDataSource& data, ostream* out) {
 
     /* if using threads, we need to go to a different function */
     if (useThreads) {
-        validateMaster(dataInput, dataOutput, numData, out);
+        validateMaster(data, out);
         return;
     }
 
+    unsigned int numData = data.getNumData();
+
     /* if data set is not empty */
     if (numData > 0) {
         std::chrono::duration<double> elapsed_seconds;                  /* timing variable for average prediction time */
@@ -946,33 +1710,48 @@ void fcnn::validate(double** dataInput, double** dataOutput, const unsigned int&
             classCorrectCount[i] = 0;
         }
 
+        unsigned int* order = makeOrder(numData);           /* validation order - never shuffled */
+        data.beginEpoch();
+        double** dataInput = new double* [stagingSize];     /* staged block */
+        uint32_t* dataLabels = new uint32_t[stagingSize];
+
         /* for all data instances */
-        for (unsigned int i = 0; i < numData; i++) {
+        for (unsigned int first = 0; first < numData; first += stagingSize) {
+            unsigned int blockSize = getBlockSize(first, numData);
+            data.stageSamples(order + first, blockSize, dataInput, dataLabels);
+            for (unsigned int i = 0; i < blockSize; i++) {
             
-            auto start = std::chrono::system_clock::now();  /* begin time */
-            prediction p = predict(dataInput[i]);           /* predict */
-            auto end = std::chrono::system_clock::now();    /* stop time */
-            elapsed_seconds = (end - start);                /* compute time */
-            totalPredictionTime += elapsed_seconds.count(); /* add to total time */
-
-            /* variables to get results of getPredictionStats */
-            double guessError = 0.0;        
-            unsigned int answerClass = 0;
-            bool correctGuess = true;
+                auto start = std::chrono::system_clock::now();  /* begin time */
+                forwardStaged(stagedInput(dataInput[i]));        /* predict - getPredictionStats reads y */
+                auto end = std::chrono::system_clock::now();    /* stop time */
+                elapsed_seconds = (end - start);                /* compute time */
+                totalPredictionTime += elapsed_seconds.count(); /* add to total time */
+
+                /* variables to get results of getPredictionStats */
+                double guessError = 0.0;        
+                unsigned int answerClass = 0;
+                bool correctGuess = true;
             
-            /* call function */
-            getPredictionStats(dataOutput[i], answerClass, guessError, correctGuess);
-
-            /* count 1 for encountered class  */
-            classCount[answerClass] += 1;
-            if (correctGuess) { /* if correct */
-                classCorrectCount[answerClass] += 1; /* count 1 for correct guess */
-                totalCorrect += 1;
-            }
-            totalError += guessError;
+                /* call function */
+                getPredictionStats(dataLabels[i], answerClass, guessError, correctGuess);
+
+                /* count 1 for encountered class - samples without a class are only counted as misses */
+                if (answerClass < outputSize) {
+                    classCount[answerClass] += 1;
+                }
+                if (correctGuess) { /* if correct */
+                    classCorrectCount[answerClass] += 1; /* count 1 for correct guess */
+                    totalCorrect += 1;
+                }
+                totalError += guessError;
 
+            }
         }
 
+        delete[] order;
+        delete[] dataInput;
+        delete[] dataLabels;
+
         /* Compute stats */
         double averagePredictionTime = totalPredictionTime / (double)numData;
         double averageError = totalError / (double)numData;
@@ -985,6 +1764,8 @@ void fcnn::validate(double** dataInput, double** dataOutput, const unsigned int&
 
         /* save average prediction time */
         this->averagePredictionTime = averagePredictionTime;
+        this->validationAccuracy = accuracy;
+        this->validationError = averageError;
 
         delete[] classCorrectCount;
         delete[] classCount;
@@ -1005,18 +1786,18 @@ void fcnn::validate(double** dataInput, double** dataOutput, const unsigned int&
  * prediction function for threads. Only a certain range of threads is
  * handled
 *******************************************************************************/
-void fcnn::predict(double* input, unsigned int** threadRange, prediction& p, pthread_barrier_t* barrier) {
+template<typename T>
+void fcnn<T>::predict(T* input, unsigned int** threadRange, prediction<T>& p, pthread_barrier_t* barrier) {
 
-    double* inp = nullptr;
+    T* inp = nullptr;
     unsigned int inpSize = 0;
 
     /* hidden layer computations */
     for (unsigned int i = 0; i < lastLayer; i++) {
         inp = (i > 0) ? y[i - 1] : input;
         inpSize = (i > 0) ? layerSize[i - 1] : inputSize;
-        for (unsigned int j = threadRange[i][0]; j < threadRange[i][1]; j++) {
-            computeForwardNode(i, j, inp, inpSize);
-        }
+        computeNodes(i, threadRange[i][0], threadRange[i][1], inp, inpSize);
+        activateNodes(threadRange[i][0], threadRange[i][1], s[i], y[i]);
         /* wait at the end of each layer */
         if (barrier != nullptr) { pthread_barrier_wait(barrier); }
     }
@@ -1026,22 +1807,21 @@ void fcnn::predict(double* input, unsigned int** threadRange, prediction& p, pth
 
     /* if no soft max, plough on ahead */
     if (!useSoftMax) {
+        computeNodes(lastLayer, threadRange[lastLayer][0], threadRange[lastLayer][1], inp, inpSize);
+        activateNodes(threadRange[lastLayer][0], threadRange[lastLayer][1], s[lastLayer], y[lastLayer]);
         for (unsigned int j = threadRange[lastLayer][0]; j < threadRange[lastLayer][1]; j++) {
-            computeForwardNode(lastLayer, j, inp, inpSize);
             p[j] = y[lastLayer][j];
         }
     }
     /* if soft max */
     else {
         /* compute everything except for the activation function */
-        for (unsigned int j = threadRange[lastLayer][0]; j < threadRange[lastLayer][1]; j++) {
-            computeForwardNode_NoActivationFunction(lastLayer, j, inp, inpSize);
-        }
+        computeNodes(lastLayer, threadRange[lastLayer][0], threadRange[lastLayer][1], inp, inpSize);
         /* sync up with everyone */
         if (barrier != nullptr) { pthread_barrier_wait(barrier); }
-        /* compute the activation function (which will be softmax) */
+        /* softmax of this thread's nodes */
+        softMaxNodes(threadRange[lastLayer][0], threadRange[lastLayer][1], s[lastLayer], y[lastLayer]);
         for (unsigned int j = threadRange[lastLayer][0]; j < threadRange[lastLayer][1]; j++) {
-            computeForwardNode_ActivationFunction(lastLayer, j, inp, inpSize);
             p[j] = y[lastLayer][j];
         }
     }
@@ -1052,12 +1832,243 @@ void fcnn::predict(double* input, unsigned int** threadRange, prediction& p, pth
     }
 }
 
+/******************************************************************************
+ * forwardBatch
+-------------------------------------------------------------------------------
+ * Forward pass of count staged inputs as one batch, S[l] = Y[l - 1] W[l]^T +
+ * b[l] then Y[l] = f(S[l]) a layer at a time, into batchS and batchY (see
+ * trainBatch). Each thread computes the nodes [threadRange[l][0],
+ * threadRange[l][1]) of every layer.
+*******************************************************************************/
+template<typename T>
+void fcnn<T>::forwardBatch(T** dataInput, const unsigned int& count, unsigned int** threadRange, pthread_barrier_t* barrier) {
+
+    /* a layer at a time - layer 0 reads the staged inputs where they are */
+    for (unsigned int i = 0; i < numLayers; i++) {
+        size_t ld = paddedSize(layerSize[i]);
+        unsigned int minNode = threadRange[i][0];
+        unsigned int maxNode = threadRange[i][1];
+        if (i == 0) {
+            gemmXB(count, minNode, maxNode, inputSize, dataInput, w[0], wStride[0], b[0], batchS[0], ld);
+        }
+        else {
+            gemmABt(count, minNode, maxNode, layerSize[i - 1], batchY[i - 1], paddedSize(layerSize[i - 1]), w[i], wStride[i], b[i], batchS[i], ld);
+        }
+
+        /* softmax needs every node of a row before any can be activated */
+        bool rowActivation = (i == lastLayer && useSoftMax);
+        if (rowActivation) {
+            if (barrier != nullptr) { pthread_barrier_wait(barrier); }
+        }
+        for (unsigned int m = 0; m < count; m++) {
+            const T* sRow = batchS[i] + m * ld;
+            T* yRow = batchY[i] + m * ld;
+            if (rowActivation) {
+                softMaxNodes(minNode, maxNode, sRow, yRow);
+            }
+            else {
+                activateNodes(minNode, maxNode, sRow, yRow);
+            }
+        }
+        if (barrier != nullptr) { pthread_barrier_wait(barrier); }
+    }
+}
+
+/******************************************************************************
+ * trainBatch
+-------------------------------------------------------------------------------
+ * Train on a batch of samples. With X the batch of inputs and Y[l], S[l], E[l]
+ * the batch of outputs, sums and errors of layer l (one row per sample):
+ *
+ *      S[l] = Y[l - 1] W[l]^T + b[l]       forward, Y[-1] = X
+ *      E[l - 1] = (E[l] W[l]) * f'(S[l - 1])   back prop with the old W[l]
+ *      W[l] -= E[l]^T Y[l - 1] / count     update, once for the batch
+ *
+ * W[0] is stored [input][node], so layer 0 is S[0] = X W[0] + b[0] and
+ * W[0] -= X^T E[0] / count, read straight from the staged inputs and
+ * skipping their zeros.
+ *
+ * Each thread computes the nodes [threadRange[l][0], threadRange[l][1]) of
+ * every layer - columns of S and E, rows of W (columns of W[0]).
+*******************************************************************************/
+template<typename T>
+void fcnn<T>::trainBatch(T** dataInput, const uint32_t dataLabels[], const unsigned int& count, unsigned int** threadRange, pthread_barrier_t* barrier) {
+
+    /* forward computation */
+    forwardBatch(dataInput, count, threadRange, barrier);
+
+    /* output errors - the learning rate is folded in like the single sample update, unless an optimizer applies it */
+    {
+        size_t ld = paddedSize(layerSize[lastLayer]);
+        T errorScale = (optimizer == SGD) ? (T)e : (T)1;
+        for (unsigned int m = 0; m < count; m++) {
+            const T* sRow = batchS[lastLayer] + m * ld;
+            const T* yRow = batchY[lastLayer] + m * ld;
+            T* errRow = batchErr[lastLayer] + m * ld;
+            outputErrors(threadRange[lastLayer][0], threadRange[lastLayer][1], sRow, yRow, dataLabels[m], errorScale, errRow);
+        }
+        if (barrier != nullptr) { pthread_barrier_wait(barrier); }
+    }
+
+    /* back prop - the errors of the layer below use the weights before this batch's update */
+    T scale = (T)(1.0 / (double)count);
+    for (unsigned int i = lastLayer; i > 0; i--) {
+        size_t ld = paddedSize(layerSize[i]);
+        size_t ldLower = paddedSize(layerSize[i - 1]);
+        unsigned int minNode = threadRange[i - 1][0];
+        unsigned int maxNode = threadRange[i - 1][1];
+        gemmAB(count, minNode, maxNode, layerSize[i], batchErr[i], ld, w[i], wStride[i], batchErr[i - 1], ldLower);
+        for (unsigned int m = 0; m < count; m++) {
+            derivativeNodes(minNode, maxNode, batchY[i - 1] + m * ldLower, batchS[i - 1] + m * ldLower, batchErr[i - 1] + m * ldLower);
+        }
+        if (barrier != nullptr) { pthread_barrier_wait(barrier); }
+
+        /* nobody reads layer i's weights again this batch */
+        if (optimizer != SGD) {
+            batchGradient(i, threadRange[i][0], threadRange[i][1], dataInput, count);
+            optimizerStep(i, threadRange[i][0], threadRange[i][1]);
+            continue;
+        }
+        gemmAtXUpdate(count, threadRange[i][0], threadRange[i][1], layerSize[i - 1], scale, batchErr[i], ld, batchY[i - 1], ldLower, w[i], wStride[i]);
+        for (unsigned int k = threadRange[i][0]; k < threadRange[i][1]; k++) {
+            T sum = 0.0;
+            for (unsigned int m = 0; m < count; m++) {
+                sum += batchErr[i][m * ld + k];
+            }
+            b[i][k] -= scale * sum;
+        }
+    }
+
+    /* input weights */
+    if (optimizer != SGD) {
+        batchGradient(0, threadRange[0][0], threadRange[0][1], dataInput, count);
+        optimizerStep(0, threadRange[0][0], threadRange[0][1]);
+    }
+    else {
+        size_t ld = paddedSize(layerSize[0]);
+        gemmXtAUpdate(count, threadRange[0][0], threadRange[0][1], inputSize, scale, batchErr[0], ld, dataInput, w[0], wStride[0]);
+        for (unsigned int k = threadRange[0][0]; k < threadRange[0][1]; k++) {
+            T sum = 0.0;
+            for (unsigned int m = 0; m < count; m++) {
+                sum += batchErr[0][m * ld + k];
+            }
+            b[0][k] -= scale * sum;
+        }
+    }
+    if (barrier != nullptr) { pthread_barrier_wait(barrier); }
+}
+
+/******************************************************************************
+ * batchGradient
+-------------------------------------------------------------------------------
+ * The average gradient of layer's weights and biases to the nodes
+ * [minNode, maxNode) over the count samples of the batch, from the errors
+ * trainBatch left in batchErr (without the learning rate). Layer 0 reads
+ * the staged inputs and, like its update, skips their zeros.
+*******************************************************************************/
+template<typename T>
+void fcnn<T>::batchGradient(const unsigned int& layer, const unsigned int& minNode, const unsigned int& maxNode, T** dataInput, const unsigned int& count) {
+    if (maxNode <= minNode) {
+        return;
+    }
+    T scale = (T)(1.0 / (double)count);
+    size_t ld = paddedSize(layerSize[layer]);
+    T* g = gradient[layer];
+    if (layer > 0) {
+        size_t ldLower = paddedSize(layerSize[layer - 1]);
+        memset(g + (size_t)minNode * wStride[layer], 0, (size_t)(maxNode - minNode) * wStride[layer] * sizeof(T));
+        gemmAtXUpdate(count, minNode, maxNode, layerSize[layer - 1], (T)-scale, batchErr[layer], ld, batchY[layer - 1], ldLower, g, wStride[layer]);
+    }
+    else {
+        for (unsigned int k = 0; k < inputSize; k++) {
+            memset(g + (size_t)k * wStride[0] + minNode, 0, (size_t)(maxNode - minNode) * sizeof(T));
+        }
+        gemmXtAUpdate(count, minNode, maxNode, inputSize, (T)-scale, batchErr[0], ld, dataInput, g, wStride[0]);
+    }
+    T* gBias = g + layerWeightCount(layer);
+    for (unsigned int k = minNode; k < maxNode; k++) {
+        T sum = 0.0;
+        for (unsigned int m = 0; m < count; m++) {
+            sum += batchErr[layer][m * ld + k];
+        }
+        gBias[k] = scale * sum;
+    }
+}
+
+/******************************************************************************
+ * optimizerStep
+-------------------------------------------------------------------------------
+ * One optimizer step on layer's weights and biases to the nodes
+ * [minNode, maxNode) from their gradient - rows of w, or for layer 0 a run
+ * of columns in every input's row. Adam's bias correction is for step
+ * optimizerSteps + 1, which trainBatch's callers count after the batch.
+*******************************************************************************/
+template<typename T>
+void fcnn<T>::optimizerStep(const unsigned int& layer, const unsigned int& minNode, const unsigned int& maxNode) {
+    if (maxNode <= minNode) {
+        return;
+    }
+    adamConstants<T> constants = {};
+    if (optimizer == ADAM || optimizer == ADAMW) {
+        double step = (double)(optimizerSteps + 1);
+        constants.beta1 = (T)optimizerSettings.beta1;
+        constants.beta2 = (T)optimizerSettings.beta2;
+        constants.stepSize = (T)(e / (1.0 - pow(optimizerSettings.beta1, step)));
+        constants.correction2 = (T)(1.0 / (1.0 - pow(optimizerSettings.beta2, step)));
+        constants.epsilon = (T)optimizerSettings.epsilon;
+        constants.keep = (T)((optimizer == ADAMW) ? 1.0 - e * optimizerSettings.weightDecay : 1.0);
+    }
+
+    const size_t n = maxNode - minNode;
+    if (layer > 0) {
+        size_t first = (size_t)minNode * wStride[layer];
+        optimizerRun(w[layer] + first, layer, first, n * wStride[layer], constants);
+    }
+    else {
+        for (unsigned int k = 0; k < inputSize; k++) {
+            size_t first = (size_t)k * wStride[0] + minNode;
+            optimizerRun(w[0] + first, 0, first, n, constants);
+        }
+    }
+
+    /* biases are not decayed */
+    constants.keep = (T)1;
+    optimizerRun(b[layer] + minNode, layer, layerWeightCount(layer) + minNode, n, constants);
+}
+
+/******************************************************************************
+ * optimizerRun
+-------------------------------------------------------------------------------
+ * The fused kernel of the optimizer over n parameters - reads their
+ * gradient and state and writes the parameters and state in one pass
+*******************************************************************************/
+template<typename T>
+void fcnn<T>::optimizerRun(T* p, const unsigned int& layer, const size_t& offset, const size_t& n, const adamConstants<T>& constants) {
+    const T* g = gradient[layer] + offset;
+    const T lr = (T)e;
+    const T momentum = (T)optimizerSettings.momentum;
+    switch (optimizer) {
+        case(MOMENTUM): { SimdKernels::momentumStep(p, g, moment1[layer] + offset, n, momentum, lr, (T)0); break; }
+        case(NESTEROV): { SimdKernels::momentumStep(p, g, moment1[layer] + offset, n, momentum, (T)(lr * momentum), lr); break; }
+        case(ADAM):
+        case(ADAMW): { SimdKernels::adamStep(p, g, moment1[layer] + offset, moment2[layer] + offset, n, constants); break; }
+        default: { break; }
+    }
+}
+
 /******************************************************************************
  * trainMaster FUNCTION
 -------------------------------------------------------------------------------
  * train function for threads. The master sets them up and sends them out
 *******************************************************************************/
-void fcnn::trainMaster(double** dataInput, double** dataOuput, const unsigned int& numData, const unsigned int& epochs, ostream* out = nullptr) {
+template<typename T>
+void fcnn<T>::trainMaster(fcnnDataSource& data, const unsigned int& epochs, ostream* out) {
+    
+    unsigned int numData = data.getNumData();
+    unsigned int* order = makeOrder(numData);           /* training order */
+    double** dataInput = new double* [stagingSize];     /* staged block - shared with the threads */
+    uint32_t* dataLabels = new uint32_t[stagingSize];
+    T** inputs = stagedInputs(dataInput);                /* staged block in T - what the threads read */
     
     /* If threads wider than output, we should update. */
     if (numThreads > layerSize[lastLayer]) {
@@ -1067,9 +2078,6 @@ void fcnn::trainMaster(double** dataInput, double** dataOuput, const unsigned in
     /* Allocate threads */
     pthread_t* threads = new pthread_t[numThreads];
 
-    /* Variable for output */
-    unsigned int threadResult = 0;
-
     /* Barrier used to keep threads from moving on without one another */
     pthread_barrier_t barrierSet[2];
     pthread_barrier_init(&barrierSet[0], NULL, numThreads);
@@ -1078,27 +2086,33 @@ void fcnn::trainMaster(double** dataInput, double** dataOuput, const unsigned in
     /* Thread Arguments */
     threadArguments* ta = new threadArguments[numThreads];
     helperNode* th = new helperNode[numThreads];
-    prediction *p = new prediction(layerSize[lastLayer]);
+    prediction<T> *p = new prediction<T>(layerSize[lastLayer]);
 
     /* Timing var for epoch timing */
     std::chrono::duration<double> elapsed_seconds;
-    double totalTime = 0;
     averageEpochTime = 0;
 
     auto start = std::chrono::system_clock::now();  /* Start the timer */
    
     /* Load up threads and send them off */
     for (unsigned int i = 0; i < numThreads; i++) {
-        setThreadArguments(ta[i], i, barrierSet, dataInput, dataOuput, numData, epochs, p);
+        setThreadArguments(ta[i], i, barrierSet, inputs, dataLabels, numData, epochs, p);
         th[i].ftc = TRAIN_THREAD;
         th[i].objectReference = this;
         th[i].arguments = (void*)(ta + i);
-        threadResult = pthread_create((threads + i), NULL, callMemberFunctionForThread, (void*)(th + i));
+        pthread_create((threads + i), NULL, callMemberFunctionForThread, (void*)(th + i));
     }
 
-    /* Meet up at each epoch */
+    /* Stage each block while the threads wait, then wait for them to train on it */
     for (unsigned int i = 0; i < epochs; i++) {
-        pthread_barrier_wait(&barrierSet[1]);
+        data.beginEpoch();
+        shuffleOrder(order, numData, data);
+        for (unsigned int first = 0; first < numData; first += stagingSize) {
+            data.stageSamples(order + first, getBlockSize(first, numData), dataInput, dataLabels);
+            convertStaged(dataInput, getBlockSize(first, numData));
+            pthread_barrier_wait(&barrierSet[1]);   /* block staged */
+            pthread_barrier_wait(&barrierSet[1]);   /* block trained */
+        }
         auto end = std::chrono::system_clock::now();    /* Stop timer */
         elapsed_seconds = end - start;                  /* Compute time */
         averageEpochTime += elapsed_seconds.count();    /* Add in time */
@@ -1111,7 +2125,7 @@ void fcnn::trainMaster(double** dataInput, double** dataOuput, const unsigned in
 
     /* Bring everyone back together */
     for (unsigned int i = 0; i < numThreads; i++) {
-        threadResult = pthread_join(*(threads + i), NULL);
+        pthread_join(*(threads + i), NULL);
     }
 
     averageEpochTime /= (double)epochs;
@@ -1119,6 +2133,9 @@ void fcnn::trainMaster(double** dataInput, double** dataOuput, const unsigned in
     delete[] ta;
     delete[] threads;
     delete[] th;
+    delete[] order;
+    delete[] dataInput;
+    delete[] dataLabels;
 }
 
 /******************************************************************************
@@ -1127,19 +2144,17 @@ void fcnn::trainMaster(double** dataInput, double** dataOuput, const unsigned in
  * train function for threads. Only a certain range of threads is
  * handled
 *******************************************************************************/
-void fcnn::trainIndividual(void* args) {
+template<typename T>
+void fcnn<T>::trainIndividual(void* args) {
     threadArguments* ta = (threadArguments*)args;
     unsigned int threadId = ta->threadId;
-    double** dataInput = ta->dataInput;
-    double** dataOutput = ta->dataOutput;
+    T** dataInput = ta->dataInput;
+    uint32_t* dataLabels = ta->dataLabels;
     unsigned int numData = ta->numData;
     unsigned int epochs = ta->epochs;
     pthread_barrier_t *barrier = ta->barrier;
-    prediction* p = ta->p;
-    unsigned int** threadRange = new unsigned int*[numLayers + 1];
-    threadRange[numLayers] = new unsigned int[2]; /* Start(1)& End(2)*/
-
-    computeThreadRange(threadRange[numLayers][0], threadRange[numLayers][1], threadId, numThreads, inputSize);
+    prediction<T>* p = ta->p;
+    unsigned int** threadRange = new unsigned int*[numLayers];
 
     for (unsigned int i = 0; i < numLayers; i++) {
         threadRange[i] = new unsigned int[2]; /* Start(1)& End(2)*/
@@ -1147,57 +2162,44 @@ void fcnn::trainIndividual(void* args) {
     }
 
     for (unsigned int epc = 0; epc < epochs; epc++) {
-        for (unsigned int d = 0; d < numData; d++) {
+        for (unsigned int first = 0; first < numData; first += stagingSize) {
+            unsigned int blockSize = getBlockSize(first, numData);
+            pthread_barrier_wait(&barrier[1]);   /* wait for the master to stage the block */
+
+            /* mini-batches */
+            for (unsigned int d = 0; trainsInBatches() && d < blockSize; d += batchSize) {
+                unsigned int count = (blockSize - d < batchSize) ? blockSize - d : batchSize;
+                trainBatch(dataInput + d, dataLabels + d, count, threadRange, &barrier[0]);
+                /* the others read the count only past the next batch's first barrier, which this thread reaches after it */
+                if (threadId == 0) { optimizerSteps++; }
+            }
 
-            /* Forward Computation (Prediction) */
-            predict(dataInput[d], threadRange, *p, &barrier[0]);
+            for (unsigned int d = 0; !trainsInBatches() && d < blockSize; d++) {
 
-            /* Set up back prop using the prediction */
-            for (unsigned int i = threadRange[lastLayer][0]; i < threadRange[lastLayer][1]; i++) {
-                error[i] = p->operator[](i) - dataOutput[d][i];
-                errStore[lastLayer][i] = (e * error[i] * computeActivationFunctionDerivative(y[lastLayer][i], s[lastLayer][i], lastLayer, i));
-                bN[lastLayer][i] = b[lastLayer][i] - errStore[lastLayer][i];
-            }
-            pthread_barrier_wait(&barrier[0]);
+                /* Forward Computation (Prediction) */
+                predict(dataInput[d], threadRange, *p, &barrier[0]);
+
+                /* Set up back prop using the prediction - squared error through a softmax needs every output first */
+                if (useSoftMax && loss == SQUARED_ERROR) { pthread_barrier_wait(&barrier[0]); }
+                outputErrors(threadRange[lastLayer][0], threadRange[lastLayer][1], s[lastLayer], y[lastLayer], dataLabels[d], (T)e, errStore[lastLayer]);
+                for (unsigned int i = threadRange[lastLayer][0]; i < threadRange[lastLayer][1]; i++) {
+                    b[lastLayer][i] -= errStore[lastLayer][i];
+                }
+                pthread_barrier_wait(&barrier[0]);
 
-            /* Back prop for all hidden layers */
-            if (numLayers > 1) {
+                /* Back prop for all hidden layers */
                 for (int h = numLayers - 2; h >= 0; h--) {
-                    for (unsigned int j = threadRange[h][0]; j < threadRange[h][1]; j++) {
-                        computeBackwardNode(h, j, nullptr, layerSize[h + 1]);
-                    }
+                    computeBackwardNodes(h, threadRange[h][0], threadRange[h][1], nullptr);
                     pthread_barrier_wait(&barrier[0]);
                 }
-            }
 
-            unsigned int size = layerSize[0];
-            /* For input layer */
-            for (unsigned int j = threadRange[numLayers][0]; j < threadRange[numLayers][1]; j++) {
-                for (unsigned int i = 0; i < size; i++) {
-                    wN[0][j][i] = w[0][j][i] - ((errStore[0][i]) * dataInput[d][j]);
-                }
+                /* For input layer - each thread updates the rows of its own layer 0 nodes */
+                computeBackwardNodes(-1, threadRange[0][0], threadRange[0][1], dataInput[d]);
+                pthread_barrier_wait(&barrier[0]);
             }
-            pthread_barrier_wait(&barrier[0]);
-
-            /* Reassignment */
-            for (unsigned int i = 0; i < numLayers; i++) {
-                /* Determine the size of the previous layer */
-                unsigned int lowerSize = inputSize;
-                if (i > 0) {
-                    lowerSize = layerSize[i - 1];
-                }
-                /* Reassign weights */
-                for (unsigned int k = threadRange[i][0]; k < threadRange[i][1]; k++) {
-                    for (unsigned int j = 0; j < lowerSize; j++) { 
-                        w[i][j][k] = wN[i][j][k];
-                    }
-                    b[i][k] = bN[i][k];
-                }
-            } 
-            pthread_barrier_wait(&barrier[0]);
+            /* sync up with the master */
+            pthread_barrier_wait(&barrier[1]);
         }
-        /* sync up with the master */
-        pthread_barrier_wait(&barrier[1]);
     }
 }
 
@@ -1206,14 +2208,15 @@ void fcnn::trainIndividual(void* args) {
 -------------------------------------------------------------------------------
  * validate function for threads. this is the master controller
 *******************************************************************************/
-void fcnn::validateMaster(double** dataInput, double** dataOutput, const unsigned int& numData, ostream* out) {
+template<typename T>
+void fcnn<T>::validateMaster(fcnnDataSource& data, ostream* out) {
     
     string results = "";
+    unsigned int numData = data.getNumData();
 
     if (numData > 0) {
 
         std::chrono::duration<double> elapsed_seconds;
-        unsigned int totalTime = 0;
         double totalPredictionTime = 0;
 
         unsigned int totalCorrect = 0;
@@ -1234,8 +2237,6 @@ void fcnn::validateMaster(double** dataInput, double** dataOutput, const unsigne
         }
         /* Allocate threads */
         pthread_t* threads = new pthread_t[numThreads];
-        /* Variable for output */
-        unsigned int threadResult = 0;
         /* Barrier used to keep threads from moving on without one another */
         pthread_barrier_t barrierSet[2];
         pthread_barrier_init(&barrierSet[0], NULL, numThreads);
@@ -1243,63 +2244,61 @@ void fcnn::validateMaster(double** dataInput, double** dataOutput, const unsigne
         /* Thread Arguments */
         threadArguments* ta = new threadArguments[numThreads];
         helperNode* th = new helperNode[numThreads];
-        prediction *p = new prediction(layerSize[lastLayer]);
+        prediction<T> *p = new prediction<T>(layerSize[lastLayer]);
+        unsigned int* order = makeOrder(numData);           /* validation order - never shuffled */
+        data.beginEpoch();
+        double** dataInput = new double* [stagingSize];     /* staged block - shared with the threads */
+        uint32_t* dataLabels = new uint32_t[stagingSize];
+        T** inputs = stagedInputs(dataInput);                /* staged block in T - what the threads read */
         /* Load up threads and send them off */
         for (unsigned int i = 0; i < numThreads; i++) {
-            setThreadArguments(ta[i], i, barrierSet, dataInput, dataOutput, numData, 0, p);
+            setThreadArguments(ta[i], i, barrierSet, inputs, dataLabels, numData, 0, p);
             th[i].ftc = VALIDATE_THREAD;
             th[i].objectReference = this;
             th[i].arguments = (void*)(ta + i);
-            threadResult = pthread_create((threads + i), NULL, callMemberFunctionForThread, (void*)(th + i));
+            pthread_create((threads + i), NULL, callMemberFunctionForThread, (void*)(th + i));
         }
 
         double guessError = 0.0;
         unsigned int answerClass = 0;
         bool correctGuess = true;
-        auto start = std::chrono::system_clock::now();
-
-        pthread_barrier_wait(&barrierSet[1]);   /* Prediction started barrier */
 
-        for (unsigned int i = 0; i < numData - 1; i++) {
-            pthread_barrier_wait(&barrierSet[1]);   /* Prediction finished barrier */
-            auto end = std::chrono::system_clock::now();
-            elapsed_seconds = (end - start);
-            totalPredictionTime += elapsed_seconds.count();
-
-            getPredictionStats(dataOutput[i], answerClass, guessError, correctGuess);
-
-            start = std::chrono::system_clock::now();
-            pthread_barrier_wait(&barrierSet[1]);   /* Prediction started barrier */
-
-            classCount[answerClass] += 1;
-            if (correctGuess) {
-                classCorrectCount[answerClass] += 1;
-                totalCorrect += 1;
+        /* Blocks are staged while the threads wait to start the next prediction */
+        for (unsigned int first = 0; first < numData; first += stagingSize) {
+            unsigned int blockSize = getBlockSize(first, numData);
+            data.stageSamples(order + first, blockSize, dataInput, dataLabels);
+            convertStaged(dataInput, blockSize);
+            for (unsigned int i = 0; i < blockSize; i++) {
+                auto start = std::chrono::system_clock::now();
+                pthread_barrier_wait(&barrierSet[1]);   /* Prediction started barrier */
+                pthread_barrier_wait(&barrierSet[1]);   /* Prediction finished barrier */
+                auto end = std::chrono::system_clock::now();
+                elapsed_seconds = (end - start);
+                totalPredictionTime += elapsed_seconds.count();
+
+                getPredictionStats(dataLabels[i], answerClass, guessError, correctGuess);
+
+                if (answerClass < outputSize) {
+                    classCount[answerClass] += 1;
+                }
+                if (correctGuess) {
+                    classCorrectCount[answerClass] += 1;
+                    totalCorrect += 1;
+                }
+                totalError += guessError;
             }
-            totalError += guessError;
         }
 
-        pthread_barrier_wait(&barrierSet[1]);   /* Prediction finished barrier */
-        auto end = std::chrono::system_clock::now();
-        elapsed_seconds = (end - start);
-        totalPredictionTime += elapsed_seconds.count();
-
-        getPredictionStats(dataOutput[numData - 1], answerClass, guessError, correctGuess);
-
-        classCount[answerClass] += 1;
-        if (correctGuess) {
-            classCorrectCount[answerClass] += 1;
-            totalCorrect += 1;
-        }
-        totalError += guessError;
-
         for (unsigned int i = 0; i < numThreads; i++) {
-            threadResult = pthread_join(*(threads + i), NULL);
+            pthread_join(*(threads + i), NULL);
         }
 
         delete[] ta;
         delete[] threads; 
         delete[] th;
+        delete[] order;
+        delete[] dataInput;
+        delete[] dataLabels;
 
         double averagePredictionTime = totalPredictionTime / (double)numData;
         double averageError = totalError / (double)numData;
@@ -1310,6 +2309,8 @@ void fcnn::validateMaster(double** dataInput, double** dataOutput, const unsigne
         }
 
         this->averagePredictionTime = averagePredictionTime;
+        this->validationAccuracy = accuracy;
+        this->validationError = averageError;
 
         delete[] classCorrectCount;
         delete[] classCount;
@@ -1323,15 +2324,14 @@ void fcnn::validateMaster(double** dataInput, double** dataOutput, const unsigne
  * validate function for threads. this is for indivdual threads where
  * only a certain range of nodes is handled 
 *******************************************************************************/
-void fcnn::validateIndividual(void* args) {
+template<typename T>
+void fcnn<T>::validateIndividual(void* args) {
     threadArguments* ta = (threadArguments*)args;
     unsigned int threadId = ta->threadId;
-    double** dataInput = ta->dataInput;
-    double** dataOutput = ta->dataOutput;
+    T** dataInput = ta->dataInput;
     unsigned int numData = ta->numData;
-    unsigned int epochs = ta->epochs;
     pthread_barrier_t* barrier = ta->barrier;
-    prediction* p = ta->p;
+    prediction<T>* p = ta->p;
     unsigned int** threadRange = new unsigned int* [numLayers + 1];
     threadRange[numLayers] = new unsigned int[2]; /* Start (1) & End (2) */
 
@@ -1342,12 +2342,15 @@ void fcnn::validateIndividual(void* args) {
         computeThreadRange(threadRange[i][0], threadRange[i][1], threadId, numThreads, layerSize[i]);
     }
 
-    for (unsigned int d = 0; d < numData; d++) {
-        pthread_barrier_wait(&barrier[1]);
-        /* Forward Computation (Prediction) */
-        predict(dataInput[d], threadRange, *p, &barrier[0]);
-        /* sync with master */
-        pthread_barrier_wait(&barrier[1]);
+    for (unsigned int first = 0; first < numData; first += stagingSize) {
+        unsigned int blockSize = getBlockSize(first, numData);
+        for (unsigned int d = 0; d < blockSize; d++) {
+            pthread_barrier_wait(&barrier[1]);
+            /* Forward Computation (Prediction) */
+            predict(dataInput[d], threadRange, *p, &barrier[0]);
+            /* sync with master */
+            pthread_barrier_wait(&barrier[1]);
+        }
     }
 }
 
@@ -1356,7 +2359,8 @@ void fcnn::validateIndividual(void* args) {
 -------------------------------------------------------------------------------
  * 
 *******************************************************************************/
-void fcnn::determineMostEfficientModel(const unsigned int& inputSize, const unsigned int& numLayers, const unsigned int layerSizes[], const unsigned int& maxThreads, const string& actFunc, const bool& useSoftMax, const bool& printProgress) {
+template<typename T>
+void fcnn<T>::determineMostEfficientModel(const unsigned int& inputSize, const unsigned int& numLayers, const unsigned int layerSizes[], const unsigned int& maxThreads, const string& actFunc, const bool& useSoftMax, const bool& printProgress) {
     
     /* Check threads to make sure feasible */
     unsigned int newMaxThreads = maxThreads;
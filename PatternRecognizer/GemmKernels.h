@@ -0,0 +1,243 @@
+#pragma once
+
+/* Headers */
+#include <cstddef>
+#include "SimdKernels.h"
+
+/************************************************************
+#############################################################
+#   GEMM Kernels
+#############################################################
+#
+#   The matrix products of training. All matrices are
+#   row-major with a leading dimension (row length in
+#   elements), and every product works on a range of columns
+#   [n0, n1) so threads can split a layer by nodes the same
+#   way they do for single samples.
+#
+#   Products are cache blocked (a panel of k at a time so
+#   the rows being reused stay in L1/L2). gemmABt is register
+#   tiled (GEMM_MR x GEMM_NR results per pass, each summed in
+#   GEMM_LANES independent partial sums so the compiler can
+#   vectorize the inner loop without reordering a sum), the
+#   others are row updates done by SimdKernels::axpy.
+#
+#   gemmXB and gemmXtAUpdate are the two products of layer 0.
+#   Their X is the staged inputs (a row pointer per sample,
+#   M can be 1) and zeros of X are skipped, so a binary image
+#   costs in proportion to its set pixels, not its area.
+************************************************************/
+
+#define GEMM_MR 4           /* rows of A per register tile */
+#define GEMM_NR 4           /* columns of C per register tile */
+#define GEMM_LANES 4        /* partial sums per result */
+#define GEMM_KC 256         /* k panel of gemmABt - 4 rows of A and B stay in L1 */
+#define GEMM_NC 256         /* column panel of gemmAB */
+#define GEMM_KU 512         /* k panel of gemmAtXUpdate */
+
+/******************************************************************************
+ * gemmABtTile
+-------------------------------------------------------------------------------
+ * C[i][j] += sum over k < K of A[i][k] * B[j][k] for an mr x nr tile
+*******************************************************************************/
+template<typename T, int MR, int NR>
+inline void gemmABtTile(const T* A, const size_t& lda, const T* B, const size_t& ldb, T* C, const size_t& ldc, const size_t& K) {
+    T acc[MR][NR][GEMM_LANES] = {};
+    size_t k = 0;
+    for (; k + GEMM_LANES <= K; k += GEMM_LANES) {
+        for (int i = 0; i < MR; i++) {
+            for (int j = 0; j < NR; j++) {
+                for (int l = 0; l < GEMM_LANES; l++) {
+                    acc[i][j][l] += A[i * lda + k + l] * B[j * ldb + k + l];
+                }
+            }
+        }
+    }
+    for (int i = 0; i < MR; i++) {
+        for (int j = 0; j < NR; j++) {
+            T sum = (acc[i][j][0] + acc[i][j][1]) + (acc[i][j][2] + acc[i][j][3]);
+            for (size_t t = k; t < K; t++) {
+                sum += A[i * lda + t] * B[j * ldb + t];
+            }
+            C[i * ldc + j] += sum;
+        }
+    }
+}
+
+/* Same for edge tiles smaller than GEMM_MR x GEMM_NR */
+template<typename T>
+inline void gemmABtEdge(const size_t& mr, const size_t& nr, const T* A, const size_t& lda, const T* B, const size_t& ldb, T* C, const size_t& ldc, const size_t& K) {
+    for (size_t i = 0; i < mr; i++) {
+        for (size_t j = 0; j < nr; j++) {
+            T acc[GEMM_LANES] = {};
+            size_t k = 0;
+            for (; k + GEMM_LANES <= K; k += GEMM_LANES) {
+                for (int l = 0; l < GEMM_LANES; l++) {
+                    acc[l] += A[i * lda + k + l] * B[j * ldb + k + l];
+                }
+            }
+            T sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+            for (; k < K; k++) {
+                sum += A[i * lda + k] * B[j * ldb + k];
+            }
+            C[i * ldc + j] += sum;
+        }
+    }
+}
+
+/******************************************************************************
+ * gemmABt
+-------------------------------------------------------------------------------
+ * C[m][n] = bias[n] + sum over k of A[m][k] * B[n][k], for m < M and
+ * n0 <= n < n1. A is M x K and B is N x K - the forward pass of a layer with
+ * A the batch of inputs and B the layer's [node][input] weights. bias can be
+ * null.
+*******************************************************************************/
+template<typename T>
+inline void gemmABt(const size_t& M, const size_t& n0, const size_t& n1, const size_t& K, const T* A, const size_t& lda, const T* B, const size_t& ldb, const T* bias, T* C, const size_t& ldc) {
+    for (size_t m = 0; m < M; m++) {
+        for (size_t n = n0; n < n1; n++) {
+            C[m * ldc + n] = (bias != nullptr) ? bias[n] : (T)0;
+        }
+    }
+    for (size_t k0 = 0; k0 < K; k0 += GEMM_KC) {
+        size_t kc = (K - k0 < GEMM_KC) ? K - k0 : GEMM_KC;
+        for (size_t n = n0; n < n1; n += GEMM_NR) {
+            size_t nr = (n1 - n < GEMM_NR) ? n1 - n : GEMM_NR;
+            const T* b = B + n * ldb + k0;
+            for (size_t m = 0; m < M; m += GEMM_MR) {
+                size_t mr = (M - m < GEMM_MR) ? M - m : GEMM_MR;
+                const T* a = A + m * lda + k0;
+                T* c = C + m * ldc + n;
+                if (mr == GEMM_MR && nr == GEMM_NR) {
+                    gemmABtTile<T, GEMM_MR, GEMM_NR>(a, lda, b, ldb, c, ldc, kc);
+                }
+                else {
+                    gemmABtEdge(mr, nr, a, lda, b, ldb, c, ldc, kc);
+                }
+            }
+        }
+    }
+}
+
+/******************************************************************************
+ * gemmAB
+-------------------------------------------------------------------------------
+ * C[m][n] = sum over k of A[m][k] * B[k][n], for m < M and n0 <= n < n1.
+ * A is M x K and B is K x N - the error of a lower layer, with A the errors
+ * of the layer above and B its weights. Rows of B are streamed once per
+ * GEMM_MR rows of A.
+*******************************************************************************/
+template<typename T>
+inline void gemmAB(const size_t& M, const size_t& n0, const size_t& n1, const size_t& K, const T* A, const size_t& lda, const T* B, const size_t& ldb, T* C, const size_t& ldc) {
+    for (size_t nb = n0; nb < n1; nb += GEMM_NC) {
+        size_t ne = (n1 - nb < GEMM_NC) ? n1 : nb + GEMM_NC;
+        for (size_t m = 0; m < M; m += GEMM_MR) {
+            size_t mr = (M - m < GEMM_MR) ? M - m : GEMM_MR;
+            for (size_t i = 0; i < mr; i++) {
+                T* c = C + (m + i) * ldc;
+                for (size_t n = nb; n < ne; n++) {
+                    c[n] = 0;
+                }
+            }
+            for (size_t k = 0; k < K; k++) {
+                const T* b = B + k * ldb + nb;
+                for (size_t i = 0; i < mr; i++) {
+                    SimdKernels::axpy(A[(m + i) * lda + k], b, C + (m + i) * ldc + nb, ne - nb);
+                }
+            }
+        }
+    }
+}
+
+/******************************************************************************
+ * gemmAtXUpdate
+-------------------------------------------------------------------------------
+ * W[n][k] -= scale * sum over m of A[m][n] * X[m][k], for n0 <= n < n1 and
+ * k < K. A is M x N and X is M x K - the weight update of a layer, with A
+ * the batch of errors and X the batch of inputs. The gradient of GEMM_NR
+ * rows is summed over a panel of k on the stack and applied once, so every
+ * weight is read and written once per batch.
+*******************************************************************************/
+template<typename T>
+inline void gemmAtXUpdate(const size_t& M, const size_t& n0, const size_t& n1, const size_t& K, const T& scale, const T* A, const size_t& lda, const T* X, const size_t& ldx, T* W, const size_t& ldw) {
+    T gradient[GEMM_NR][GEMM_KU];
+    for (size_t n = n0; n < n1; n += GEMM_NR) {
+        size_t nr = (n1 - n < GEMM_NR) ? n1 - n : GEMM_NR;
+        for (size_t k0 = 0; k0 < K; k0 += GEMM_KU) {
+            size_t kc = (K - k0 < GEMM_KU) ? K - k0 : GEMM_KU;
+            for (size_t r = 0; r < nr; r++) {
+                for (size_t k = 0; k < kc; k++) {
+                    gradient[r][k] = 0;
+                }
+            }
+            for (size_t m = 0; m < M; m++) {
+                const T* x = X + m * ldx + k0;
+                for (size_t r = 0; r < nr; r++) {
+                    const T a = A[m * lda + n + r];
+                    if (a == 0) {
+                        continue;
+                    }
+                    SimdKernels::axpy(a, x, gradient[r], kc);
+                }
+            }
+            for (size_t r = 0; r < nr; r++) {
+                SimdKernels::axpy((T)-scale, gradient[r], W + (n + r) * ldw + k0, kc);
+            }
+        }
+    }
+}
+
+/******************************************************************************
+ * gemmXB
+-------------------------------------------------------------------------------
+ * C[m][n] = bias[n] + sum over k of X[m][k] * B[k][n], for m < M and
+ * n0 <= n < n1. X is M rows of K (X[m] points at row m) and B is K x N - the
+ * forward pass of layer 0, with B its [input][node] weights. Rows of B are
+ * only read for a k where some X[m][k] is not 0, and each is read once for
+ * all M rows.
+*******************************************************************************/
+template<typename T>
+inline void gemmXB(const size_t& M, const size_t& n0, const size_t& n1, const size_t& K, const T* const* X, const T* B, const size_t& ldb, const T* bias, T* C, const size_t& ldc) {
+    for (size_t m = 0; m < M; m++) {
+        for (size_t n = n0; n < n1; n++) {
+            C[m * ldc + n] = (bias != nullptr) ? bias[n] : (T)0;
+        }
+    }
+    for (size_t nb = n0; nb < n1; nb += GEMM_NC) {
+        size_t ne = (n1 - nb < GEMM_NC) ? n1 : nb + GEMM_NC;
+        for (size_t k = 0; k < K; k++) {
+            const T* b = B + k * ldb + nb;
+            for (size_t m = 0; m < M; m++) {
+                const T x = X[m][k];
+                if (x != 0) {
+                    SimdKernels::axpy(x, b, C + m * ldc + nb, ne - nb);
+                }
+            }
+        }
+    }
+}
+
+/******************************************************************************
+ * gemmXtAUpdate
+-------------------------------------------------------------------------------
+ * W[k][n] -= scale * sum over m of X[m][k] * A[m][n], for k < K and
+ * n0 <= n < n1. X is M rows of K (X[m] points at row m) and A is M x N - the
+ * weight update of layer 0, with A the errors and W the [input][node]
+ * weights. The row of an input that is 0 in every sample is not touched.
+*******************************************************************************/
+template<typename T>
+inline void gemmXtAUpdate(const size_t& M, const size_t& n0, const size_t& n1, const size_t& K, const T& scale, const T* A, const size_t& lda, const T* const* X, T* W, const size_t& ldw) {
+    if (n1 <= n0) {
+        return;
+    }
+    for (size_t k = 0; k < K; k++) {
+        T* w = W + k * ldw + n0;
+        for (size_t m = 0; m < M; m++) {
+            const T x = X[m][k];
+            if (x != 0) {
+                SimdKernels::axpy((T)(-scale * x), A + m * lda + n0, w, n1 - n0);
+            }
+        }
+    }
+}
@@ -0,0 +1,362 @@
+#pragma once
+
+/* Headers */
+#include <pthread.h>
+#include <string>
+#include "../PatternGenerator/PatternStream.h"
+#include "../PatternGenerator/RecordStream.h"
+
+using namespace std;
+
+/************************************************************
+#############################################################
+#   Generator Feed Class
+#############################################################
+#
+#   Trains straight from the PatternGenerator instead of
+#   a data.csv file. Background threads each own a randomly
+#   sampling PatternStream and fill a ring of mini-batches
+#   that are ready to hand to fcnn::train (inputs as 0/1
+#   doubles, labels as class ids), so generating the next
+#   batches overlaps with training on the current one.
+#
+#   Can also be fed by a record stream (generator --stream
+#   piped in) - one producer reads the stream, and a batch
+#   with a count of 0 means the stream has ended.
+#
+#   Usage:
+#       acquireBatch(...)   - waits for the next full batch
+#       releaseBatch()      - hands the slot back to be refilled
+************************************************************/
+class GeneratorFeed {
+private:
+
+    /*---------------------------------------------*/
+    /* Enum for the state of a slot in the ring */
+    /*---------------------------------------------*/
+    enum slotState {
+        EMPTY       /* waiting for a producer */
+        , FILLING   /* a producer is working on it */
+        , FULL      /* ready for the consumer */
+    };
+
+    /*---------------------------------------------*/
+    /* One mini-batch in the ring */
+    /*---------------------------------------------*/
+    struct batchSlot {
+        slotState state = EMPTY;
+        unsigned int count = 0;                 /* number of samples in the batch */
+        unsigned int* classIds = nullptr;       /* class of each sample */
+        unsigned char* packed = nullptr;        /* packed pixels straight from the stream */
+        double* inputArena = nullptr;           /* batchSize * inputSize unpacked pixels */
+        double** inputs = nullptr;              /* row pointers into inputArena - what fcnn takes */
+    };
+
+    /*---------------------------------------------*/
+    /* Arguments for a producer thread */
+    /*---------------------------------------------*/
+    struct producerArguments {
+        GeneratorFeed* feed = nullptr;
+        PatternStream* stream = nullptr;
+        RecordStreamReader* reader = nullptr;
+    };
+
+    unsigned int numProducers = 0;          /* number of background threads */
+    unsigned int batchSize = 0;             /* samples per batch */
+    unsigned int ringSize = 0;              /* number of batches in the ring */
+    unsigned int inputSize = 0;             /* pixels per sample */
+    unsigned int outputSize = 0;            /* number of classes */
+
+    PatternStream** streams = nullptr;      /* one stream per producer - streams are not shared between threads */
+    RecordStreamReader* reader = nullptr;   /* record stream source instead of streams - not owned */
+    producerArguments* arguments = nullptr; /* one per producer */
+    pthread_t* threads = nullptr;           /* producer threads */
+    batchSlot* ring = nullptr;              /* the ring of batches */
+
+    unsigned int nextToFill = 0;            /* next slot a producer will claim */
+    unsigned int nextToRead = 0;            /* next slot the consumer will read */
+    bool stopping = false;                  /* tells producers to finish up */
+    bool exhausted = false;                 /* the record stream has ended */
+    bool empty = false;                     /* no class has unit patterns - nothing is started */
+
+    pthread_mutex_t lock;                   /* protects the ring bookkeeping */
+    pthread_cond_t slotEmptied;             /* signaled when the consumer frees a slot */
+    pthread_cond_t slotFilled;              /* signaled when a producer finishes a slot */
+
+    /* thread entry point */
+    static void* producerMain(void* args);
+
+    /* allocates the ring and starts the producers - sizes must be set */
+    void start();
+
+    /* loop run by every producer thread */
+    void produce(producerArguments* source);
+
+    /* fills a slot from a stream or the reader - called without holding the lock */
+    void fillSlot(batchSlot& slot, producerArguments* source);
+
+public:
+
+    /* a feed is tied to its threads - no copies */
+    GeneratorFeed() = delete;
+    GeneratorFeed(const GeneratorFeed& copy) = delete;
+    void operator=(const GeneratorFeed& copy) = delete;
+
+    /* builds one stream per producer (seeded seed, seed + 1, ...) and starts the producers */
+    GeneratorFeed(const PatternStreamSettings& settings, const unsigned int& numProducers, const unsigned int& batchSize, const unsigned int& ringSize, const unsigned int& seed);
+
+    /* reads records from a record stream whose header has already been read */
+    GeneratorFeed(RecordStreamReader* reader, const unsigned int& batchSize, const unsigned int& ringSize);
+
+    /* stops and joins the producers and releases the ring */
+    ~GeneratorFeed();
+
+    /* Getters */
+    unsigned int getInputSize() const { return inputSize; }
+    unsigned int getOutputSize() const { return outputSize; }
+    unsigned int getBatchSize() const { return batchSize; }
+    /* true if the settings give no unit patterns for any class, so there is nothing to generate */
+    bool isEmpty() const { return empty; }
+
+    string getClassName(const unsigned int& classId) const { return (reader != nullptr) ? reader->GetClassName(classId) : streams[0]->GetClassName(classId); }
+
+    /* waits for the next full batch - pointers stay valid until releaseBatch. count is 0 once a record stream has ended */
+    void acquireBatch(double**& inputs, unsigned int*& labels, unsigned int& count);
+
+    /* returns the batch from acquireBatch to the producers */
+    void releaseBatch();
+};
+/************************************************************
+* ///////////////////////////|\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\
+* \\\\\\\\\\\\\\\\\\\\\\\\\\\|///////////////////////////////
+************************************************************/
+
+
+/******************************************************************************
+ * GeneratorFeed constructor
+-------------------------------------------------------------------------------
+ * Streams are built here (in the calling thread) so the sizes are known
+ * before any producer starts. If no class has unit patterns the producers
+ * are never started (see isEmpty).
+*******************************************************************************/
+inline GeneratorFeed::GeneratorFeed(const PatternStreamSettings& settings, const unsigned int& numProducers, const unsigned int& batchSize, const unsigned int& ringSize, const unsigned int& seed)
+    : numProducers((numProducers > 0) ? numProducers : 1), batchSize((batchSize > 0) ? batchSize : 1), ringSize((ringSize > 1) ? ringSize : 2) {
+
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&slotEmptied, NULL);
+    pthread_cond_init(&slotFilled, NULL);
+
+    /* one randomly sampling stream per producer */
+    streams = new PatternStream*[this->numProducers];
+    for (unsigned int i = 0; i < this->numProducers; i++) {
+        PatternStreamSettings s = settings;
+        s.randomSampling = true;
+        s.seed = seed + i;
+        streams[i] = new PatternStream(s);
+    }
+    inputSize = streams[0]->GetHeight() * streams[0]->GetWidth();
+    outputSize = streams[0]->GetNumberOfClasses();
+
+    /* a random stream never runs out, unless there is nothing to draw from */
+    empty = true;
+    for (unsigned int i = 0; i < outputSize && empty; i++) {
+        empty = (streams[0]->GetNumberOfUnitPatterns(i) == 0);
+    }
+    if (empty) {
+        exhausted = true;
+        return;
+    }
+
+    start();
+}
+
+/******************************************************************************
+ * GeneratorFeed constructor
+-------------------------------------------------------------------------------
+ * A record stream can only be read in order, so there is one producer
+*******************************************************************************/
+inline GeneratorFeed::GeneratorFeed(RecordStreamReader* reader, const unsigned int& batchSize, const unsigned int& ringSize)
+    : numProducers(1), batchSize((batchSize > 0) ? batchSize : 1), ringSize((ringSize > 1) ? ringSize : 2), reader(reader) {
+
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&slotEmptied, NULL);
+    pthread_cond_init(&slotFilled, NULL);
+
+    inputSize = reader->GetHeight() * reader->GetWidth();
+    outputSize = reader->GetNumberOfClasses();
+
+    start();
+}
+
+/******************************************************************************
+ * start
+-------------------------------------------------------------------------------
+ * Allocates the ring and starts the producers
+*******************************************************************************/
+inline void GeneratorFeed::start() {
+    unsigned int bytesPerRecord = (inputSize + 7) / 8;
+
+    /* allocate the ring */
+    ring = new batchSlot[this->ringSize];
+    for (unsigned int i = 0; i < this->ringSize; i++) {
+        batchSlot& slot = ring[i];
+        slot.classIds = new unsigned int[this->batchSize];
+        slot.packed = new unsigned char[(size_t)this->batchSize * bytesPerRecord];
+        slot.inputArena = new double[(size_t)this->batchSize * inputSize];
+        slot.inputs = new double*[this->batchSize];
+        for (unsigned int j = 0; j < this->batchSize; j++) {
+            slot.inputs[j] = slot.inputArena + ((size_t)j * inputSize);
+        }
+    }
+
+    /* start the producers */
+    threads = new pthread_t[this->numProducers];
+    arguments = new producerArguments[this->numProducers];
+    for (unsigned int i = 0; i < this->numProducers; i++) {
+        arguments[i].feed = this;
+        arguments[i].stream = (streams != nullptr) ? streams[i] : nullptr;
+        arguments[i].reader = reader;
+        pthread_create(threads + i, NULL, producerMain, (void*)(arguments + i));
+    }
+}
+
+/******************************************************************************
+ * GeneratorFeed destructor
+-------------------------------------------------------------------------------
+ * Producers waiting on a slot are woken up and told to stop
+*******************************************************************************/
+inline GeneratorFeed::~GeneratorFeed() {
+    pthread_mutex_lock(&lock);
+    stopping = true;
+    pthread_cond_broadcast(&slotEmptied);
+    pthread_mutex_unlock(&lock);
+
+    for (unsigned int i = 0; threads != nullptr && i < numProducers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (unsigned int i = 0; ring != nullptr && i < ringSize; i++) {
+        delete[] ring[i].classIds;
+        delete[] ring[i].packed;
+        delete[] ring[i].inputArena;
+        delete[] ring[i].inputs;
+    }
+    for (unsigned int i = 0; streams != nullptr && i < numProducers; i++) {
+        delete streams[i];
+    }
+    delete[] ring;
+    delete[] streams;
+    delete[] threads;
+    delete[] arguments;
+
+    pthread_cond_destroy(&slotFilled);
+    pthread_cond_destroy(&slotEmptied);
+    pthread_mutex_destroy(&lock);
+}
+
+/******************************************************************************
+ * producerMain
+-------------------------------------------------------------------------------
+ * Entry point for the producer threads
+*******************************************************************************/
+inline void* GeneratorFeed::producerMain(void* args) {
+    producerArguments* pa = (producerArguments*)args;
+    pa->feed->produce(pa);
+    return nullptr;
+}
+
+/******************************************************************************
+ * produce
+-------------------------------------------------------------------------------
+ * Claims empty slots in ring order and fills them until the feed stops or
+ * the record stream ends
+*******************************************************************************/
+inline void GeneratorFeed::produce(producerArguments* source) {
+    while (true) {
+        /* claim the next slot once it is empty */
+        pthread_mutex_lock(&lock);
+        while (!stopping && !exhausted && ring[nextToFill].state != EMPTY) {
+            pthread_cond_wait(&slotEmptied, &lock);
+        }
+        if (stopping || exhausted) {
+            pthread_mutex_unlock(&lock);
+            return;
+        }
+        batchSlot& slot = ring[nextToFill];
+        slot.state = FILLING;
+        nextToFill = (nextToFill + 1) % ringSize;
+        pthread_mutex_unlock(&lock);
+
+        /* the slot is ours - fill it without holding the lock */
+        fillSlot(slot, source);
+
+        pthread_mutex_lock(&lock);
+        slot.state = FULL;
+        if (slot.count == 0) {
+            exhausted = true;
+        }
+        pthread_cond_broadcast(&slotFilled);
+        pthread_mutex_unlock(&lock);
+    }
+}
+
+/******************************************************************************
+ * fillSlot
+-------------------------------------------------------------------------------
+ * Generates (or reads) a batch and unpacks the pixels
+*******************************************************************************/
+inline void GeneratorFeed::fillSlot(batchSlot& slot, producerArguments* source) {
+    if (source->reader != nullptr) {
+        slot.count = source->reader->ReadRecords(batchSize, slot.classIds, slot.packed);
+    }
+    else {
+        slot.count = source->stream->NextBatch(batchSize, slot.classIds, slot.packed);
+    }
+    unsigned int bytesPerRecord = (inputSize + 7) / 8;
+    for (unsigned int i = 0; i < slot.count; i++) {
+        PatternStream::UnpackRecord(slot.packed + ((size_t)i * bytesPerRecord), inputSize, slot.inputs[i]);
+    }
+}
+
+/******************************************************************************
+ * acquireBatch
+-------------------------------------------------------------------------------
+ * Waits for the next slot in ring order to be full. Once the record stream
+ * has ended every call hands back an empty batch.
+*******************************************************************************/
+inline void GeneratorFeed::acquireBatch(double**& inputs, unsigned int*& labels, unsigned int& count) {
+    pthread_mutex_lock(&lock);
+    while (!exhausted && ring[nextToRead].state != FULL) {
+        pthread_cond_wait(&slotFilled, &lock);
+    }
+    bool full = (ring != nullptr && ring[nextToRead].state == FULL);
+    pthread_mutex_unlock(&lock);
+
+    if (!full) {
+        inputs = nullptr;
+        labels = nullptr;
+        count = 0;
+        return;
+    }
+
+    inputs = ring[nextToRead].inputs;
+    labels = ring[nextToRead].classIds;
+    count = ring[nextToRead].count;
+}
+
+/******************************************************************************
+ * releaseBatch
+-------------------------------------------------------------------------------
+ * Frees the slot handed out by acquireBatch
+*******************************************************************************/
+inline void GeneratorFeed::releaseBatch() {
+    pthread_mutex_lock(&lock);
+    if (ring == nullptr || ring[nextToRead].state != FULL) {
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+    ring[nextToRead].state = EMPTY;
+    nextToRead = (nextToRead + 1) % ringSize;
+    pthread_cond_broadcast(&slotEmptied);
+    pthread_mutex_unlock(&lock);
+}
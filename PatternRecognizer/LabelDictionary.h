@@ -0,0 +1,177 @@
+#pragma once
+
+/* Headers */
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include "Array.h"
+
+using namespace std;
+
+/************************************************************
+#############################################################
+#   Label Dictionary Class
+#############################################################
+#
+#   Class names <-> dense class ids. Ids are handed out in
+#   the order names are first interned and lookups go
+#   through an open addressing hash table, so labeling N
+#   samples is O(N) no matter how many classes there are.
+#
+#   The table can be written to / read from a file (uint32
+#   count, then every name as a uint32 length followed by
+#   its characters) so ids stay the same for data sets that
+#   are stored with class ids instead of names.
+************************************************************/
+class LabelDictionary {
+private:
+    Array<string> names;            /* name of every id */
+    unsigned int* table = nullptr;  /* id + 1 of the name hashed there, 0 is empty */
+    size_t tableSize = 0;           /* power of two, kept at least twice the number of names */
+
+    /* FNV-1a */
+    static uint64_t hashName(const char* name, const size_t& length) {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < length; i++) {
+            hash ^= (unsigned char)name[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    /* returns the table position holding name, or the empty position it would go in */
+    size_t probe(const char* name, const size_t& length) const {
+        size_t mask = tableSize - 1;
+        size_t position = (size_t)hashName(name, length) & mask;
+        while (table[position] != 0) {
+            const string& candidate = names.at(table[position] - 1);
+            if (candidate.size() == length && memcmp(candidate.data(), name, length) == 0) {
+                break;
+            }
+            position = (position + 1) & mask;
+        }
+        return position;
+    }
+
+    /* doubles the table and puts every name back in */
+    void grow() {
+        delete[] table;
+        tableSize = (tableSize == 0) ? 64 : tableSize * 2;
+        table = new unsigned int[tableSize];
+        for (size_t i = 0; i < tableSize; i++) {
+            table[i] = 0;
+        }
+        for (unsigned int id = 0; id < names.getSize(); id++) {
+            table[probe(names[id].data(), names[id].size())] = id + 1;
+        }
+    }
+
+public:
+    static const unsigned int NOT_FOUND = 0xFFFFFFFF;
+
+    LabelDictionary() { }
+    LabelDictionary(const LabelDictionary& copy) { (*this) = copy; }
+    ~LabelDictionary() { delete[] table; }
+
+    void operator=(const LabelDictionary& copy) {
+        reset();
+        for (unsigned int id = 0; id < copy.getSize(); id++) {
+            intern(copy.getName(id));
+        }
+    }
+
+    /* forgets every name */
+    void reset() {
+        names.reset();
+        delete[] table;
+        table = nullptr;
+        tableSize = 0;
+    }
+
+    /* returns the id of name, giving it the next id if it is new */
+    unsigned int intern(const char* name, const size_t& length) {
+        if ((names.getSize() + 1) * 2 > tableSize) {
+            grow();
+        }
+        size_t position = probe(name, length);
+        if (table[position] == 0) {
+            names.add(string(name, length));
+            table[position] = (unsigned int)names.getSize();
+        }
+        return table[position] - 1;
+    }
+    unsigned int intern(const string& name) { return intern(name.data(), name.size()); }
+
+    /* returns the id of name, or NOT_FOUND */
+    unsigned int find(const char* name, const size_t& length) const {
+        if (tableSize == 0) {
+            return NOT_FOUND;
+        }
+        size_t position = probe(name, length);
+        return (table[position] == 0) ? NOT_FOUND : table[position] - 1;
+    }
+    unsigned int find(const string& name) const { return find(name.data(), name.size()); }
+
+    /* accessors */
+    unsigned int getSize() const { return (unsigned int)names.getSize(); }
+    string getName(const unsigned int& id) const { return (id < names.getSize()) ? names.at(id) : ""; }
+
+    /* writes the table - returns false if the write fails */
+    bool write(FILE* file) const {
+        uint32_t count = getSize();
+        bool ok = fwrite(&count, sizeof(uint32_t), 1, file) == 1;
+        for (unsigned int id = 0; ok && id < count; id++) {
+            const string& name = names.at(id);
+            uint32_t length = (uint32_t)name.size();
+            ok = fwrite(&length, sizeof(uint32_t), 1, file) == 1
+                && fwrite(name.data(), 1, length, file) == length;
+        }
+        return ok;
+    }
+
+    /* replaces the table with one written by write() - returns false if it is cut short */
+    bool read(FILE* file) {
+        reset();
+        uint32_t count = 0;
+        if (fread(&count, sizeof(uint32_t), 1, file) != 1) {
+            return false;
+        }
+        string name;
+        for (uint32_t id = 0; id < count; id++) {
+            uint32_t length = 0;
+            if (fread(&length, sizeof(uint32_t), 1, file) != 1) {
+                return false;
+            }
+            name.resize(length);
+            if (length > 0 && fread(&name[0], 1, length, file) != length) {
+                return false;
+            }
+            intern(name);
+        }
+        return true;
+    }
+
+    /* write() / read() to a file of their own */
+    bool save(const string& path) const {
+        FILE* file = fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+            return false;
+        }
+        bool ok = write(file);
+        return (fclose(file) == 0) && ok;
+    }
+    bool load(const string& path) {
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            return false;
+        }
+        bool ok = read(file);
+        fclose(file);
+        return ok;
+    }
+};
+/************************************************************
+* ///////////////////////////|\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\
+* \\\\\\\\\\\\\\\\\\\\\\\\\\\|///////////////////////////////
+************************************************************/
@@ -2,6 +2,13 @@
 #include "Array.h"
 #include <fstream>
 #include "DataSplitter.h"
+#include "GeneratorFeed.h"
+#include "DataLoader.h"
+#include "ShardedDataSource.h"
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
 using namespace std;
 
 void PrintArray(ostream& out, const double arr[], const unsigned int& arrSize) {
@@ -16,131 +23,63 @@ void PrintArray(ostream& out, const double arr[], const unsigned int& arrSize) {
     out << s << endl;
 }
 
-struct Pattern {
-    static Array<string> Classes;
-    int LableId = 0;
-    string LableName = "";
-    int height = 0, width = 0, totalInput = 0;
-    double* data = nullptr;
-
-    double operator[](const int& i) const { return (double)data[i]; }
-
-    Pattern() { }
-    ~Pattern() { if (data != nullptr) { delete[] data; } }
-
-    Pattern(const string& s) {
-        int currentIndex = 0;
-        int commasFound = 0;
-        string currentString = "";
-
-        // Get data dimensions
-        while (currentIndex < s.size() && commasFound < 3) {
-            if (s[currentIndex] == ',') {
-                commasFound += 1;
-                switch (commasFound) {
-                case(1): { LableName = currentString; break; }
-                case(2): { height = stoi(currentString); break; }
-                case(3): { width = stoi(currentString); break; }
-                }
-                currentString = "";
-            }
-            else {
-                currentString += s[currentIndex];
-            }
-            currentIndex += 1;
-        }
-
-        totalInput = height * width;
-        data = new double[totalInput];
-
-        // Get the data string
-        for (int i = 0; i < totalInput; i += 1) {
-            data[i] = (s[currentIndex + i] == '1' ? 1 : 0);
-        }
-
-        if (!Classes.exists(LableName)) { Classes.add(LableName); }
-
-        for (int i = 0; i < Classes.getSize(); i++) {
-            if (Classes[i] == LableName) {
-                LableId = i;
-                break;
-            }
-        }
+/* Class names of every pattern read from a data file - ids are indices */
+LabelDictionary patternClasses;
+
+/* Optional settings - "key=value" lines after the hidden layer sizes in the params file */
+struct RecognizerOptions {
+    string dataSource = "csv";                  /* csv (read dataFile), sharded (stream dataFile from disk a few shards at a time), generator (train straight from the PatternGenerator) or stream (record stream from dataFile, "-" is stdin) */
+    string generatorClasses = "Square,Rectangle,Trapezoid,Triangle,Pentagon,Star,Circle,Diamond,Hexagon,Octogon,Heptagon,Heart,Cross,Crescent,Spike,Arrow,Tilde,Zigzag,Cane,Cat";
+    int generatorUnitSize = 50;                 /* height and width of the unit patterns */
+    int generatorHeight = 110;                  /* height of the generated images */
+    int generatorWidth = 110;                   /* width of the generated images */
+    double generatorMinScale = 0.2;             /* smallest unit scale */
+    double generatorScaleStep = 0.3;            /* step between unit scales */
+    double generatorMaxScale = 0.97;            /* largest unit scale */
+    int unitTransformVariants = 0;              /* transformed copies of every unit pattern */
+    double unitRotation = 0.0;                  /* largest rotation of a copy in degrees */
+    double unitStretch = 0.0;                   /* largest stretch of a copy along each axis */
+    double unitShear = 0.0;                     /* largest shear of a copy along each axis */
+    unsigned int generatorThreads = 2;          /* background threads generating batches */
+    unsigned int generatorBatchSize = 256;      /* samples per generated batch */
+    unsigned int samplesPerEpoch = 20000;       /* fresh samples drawn for each epoch */
+    unsigned int testSamples = 1000;            /* fresh samples drawn for validation after training */
+    unsigned int seed = 0;                      /* seed for anything random */
+    bool shuffleEachEpoch = true;               /* csv, sharded: new training order every epoch */
+    unsigned int loaderThreads = 0;             /* csv: threads parsing dataFile (0 is one per core) */
+    bool dataCache = true;                      /* csv: map dataFile.cache if it matches dataFile, otherwise parse and write it */
+    unsigned int shardMegabytes = 64;           /* sharded: size of a shard of dataFile */
+    unsigned int windowShards = 4;              /* sharded: shards resident and shuffled together */
+    string testFile = "";                       /* sharded: data file to validate on after training */
+    unsigned int folds = 0;                     /* csv: stratified K-fold with this many folds (2 or more) instead of one split */
+    unsigned int repeats = 1;                   /* csv: repeated hold out - new stratified split (seed + repeat) each time */
+    unsigned int concurrentSplits = 0;          /* csv: networks trained at once when there are several splits (0 is all) */
+    unsigned int maxRecords = 0;                /* csv: only read the first maxRecords lines of dataFile (0 is all of them) */
+    unsigned int outputSize = 0;                /* csv: output nodes - at least one per class found (e.g. to match an imported network) */
+    unsigned int batchSize = 1;                 /* samples per weight update - above 1 trains in mini-batches on the average gradient (raise learningRate with it) */
+    string precision = "";                      /* float or double weights and training math - empty follows the imported network, otherwise double */
+    string loss = "SQUARED_ERROR";              /* SQUARED_ERROR or CROSS_ENTROPY (softmax or sigmoid output) - what training minimizes */
+    fcnnOptimizerSettings optimizer;            /* optimizer (SGD, MOMENTUM, NESTEROV, ADAM or ADAMW), momentum, beta1, beta2, epsilon, weightDecay */
+    AugmentationSettings augmentation;          /* augment... options - random variants of every generated pattern */
+};
 
-    }
+void ReadOption(RecognizerOptions& options, string line);
 
-    void operator=(const Pattern& copy) {
-        if (data != nullptr) { delete[] data; }
-        LableId = copy.LableId;
-        LableName = copy.LableName;
-        height = copy.height; 
-        width = copy.width; 
-        totalInput = copy.totalInput;
-        data = new double[totalInput];
-        for (int i = 0; i < totalInput; i++) { data[i] = copy.data[i]; }
-    }
-
-    Pattern(const Pattern& copy) { (*this) = copy; }
-
-    void PrintPattern(ostream& out) {
-        string s = "#################################\n";
-        s = s
-            + "## Class Name   : " + LableName + "\n"
-            + "## Class ID     : " + to_string(LableId) + "\n"
-            + "## Dimensions   : " + to_string(height) + "(h)x" + to_string(width) + "(w)\n"
-            + "## Total Inputs : " + to_string(totalInput) + "\n"
-            + "#################################\n";
-
-        string horizontalBorder = "";
-        for (int i = 0; i < width + 2; i++) { horizontalBorder += "-"; }
-        s += horizontalBorder;
-        for (int h = 0; h < height; h += 1) {
-            string t = "|";
-            for (int w = 0; w < width; w += 1) {
-                t += (data[h * height + w] == 1 ? "*" : " ");
-            }
-            s += (t + "|\n");
-        }
-        s += horizontalBorder;
-        out << s;
-    }
-
-    double* GetOutputAsDoubleArray(unsigned int outputSize) {
-        double* outputArray = new double[outputSize];
-        for (unsigned int i = 0; i < LableId; i++) {
-            outputArray[i] = 0;
-        }
-        outputArray[LableId] = 1;
-        for (unsigned int i = LableId + 1; i < outputSize; i++) {
-            outputArray[i] = 0;
-        }
-        return outputArray;
-    }
+template<typename T>
+int TrainOnline(const RecognizerOptions& options, const string& dataFile, const string& fcnnInput, const string& fcnnOutput, const unsigned int& numThreads, const unsigned int& epochs, const unsigned int& numHiddenLayers, unsigned int hiddenLayers[], const double& learningRate, const bool& useThreads, const string& actFunc, const bool& softMax, ostream* out);
 
-    bool GuessedCorrectly(prediction answer) const {
-        unsigned int maxIndex = 0;
-        double maxValue = answer[0];
-        for (unsigned int i = 1; i < answer.getSize(); i++) {
-            if (maxValue < answer[i]) {
-                maxValue = answer[i];
-                maxIndex = i;
-            }
-        }
-        return maxIndex == LableId;
-    }
+template<typename T>
+int TrainSharded(const RecognizerOptions& options, const string& dataFile, const string& fcnnInput, const string& fcnnOutput, const unsigned int& numThreads, const unsigned int& epochs, const unsigned int& numHiddenLayers, unsigned int hiddenLayers[], const double& learningRate, const bool& useThreads, const string& actFunc, const bool& softMax, ostream* out);
 
-    static string classIdToClassName(unsigned int i) {
-        if (i < Classes.getSize()) {
-            return Classes[i];
-        }
-        return "";
-    }
+template<typename T>
+int TrainSplits(const RecognizerOptions& options, const PackedDataSet& dataSet, const DataSplitter& splitter, const string& fcnnInput, const unsigned int& inputSize, const unsigned int& outputSize, const unsigned int& numThreads, const unsigned int& epochs, const unsigned int& numHiddenLayers, unsigned int hiddenLayers[], const double& learningRate, const bool& useThreads, const string& actFunc, const bool& softMax, ostream* out);
 
-};
+template<typename T>
+int TrainHoldOut(const RecognizerOptions& options, const PackedDataSet& dataSet, const DataSplitter& splitter, const string& fcnnInput, const string& fcnnOutput, const unsigned int& inputSize, const unsigned int& outputSize, const unsigned int& numThreads, const unsigned int& epochs, const unsigned int& numHiddenLayers, unsigned int hiddenLayers[], const double& learningRate, const bool& useThreads, const string& actFunc, const bool& softMax, ostream* out);
 
-Array<string> Pattern::Classes;
+bool UseFloat(const RecognizerOptions& options, const string& fcnnInput);
 
-Pattern* GetDataArray(const string& dataFile, int& dataCount);
+bool GetDataSet(const string& dataFile, int& dataCount, PackedDataSet& dataSet, const unsigned int& loaderThreads, const bool& useCache);
 
 #define ENV "WINDOWS"
 
@@ -204,183 +143,618 @@ int main(int argc, char** argv) {
         hiddenLayers[i] = stoi(temp);
     }
 
+    /* Anything left is optional settings */
+    RecognizerOptions options;
+    while (getline(inputFile, temp)) {
+        ReadOption(options, temp);
+    }
+
     inputFile.close();
 
-    int inputSize = 110*110;
-    int outputSize = 20;
+    bool useFloat = UseFloat(options, fcnnInput);
 
-    unsigned int inputLayerSize = inputSize;
-    unsigned int outputLayerSize = outputSize;
-    hiddenLayers[numHiddenLayers - 1] = outputLayerSize;
+    if (options.dataSource == "generator" || options.dataSource == "stream") {
+        int result = useFloat ? TrainOnline<float>(options, dataFile, fcnnInput, fcnnOutput, numThreads, epochs, numHiddenLayers, hiddenLayers, learningRate, useThreads, actFunc, softMax, out) : TrainOnline<double>(options, dataFile, fcnnInput, fcnnOutput, numThreads, epochs, numHiddenLayers, hiddenLayers, learningRate, useThreads, actFunc, softMax, out);
+        delete[] hiddenLayers;
+        return result;
+    }
+    if (options.dataSource == "sharded") {
+        int result = useFloat ? TrainSharded<float>(options, dataFile, fcnnInput, fcnnOutput, numThreads, epochs, numHiddenLayers, hiddenLayers, learningRate, useThreads, actFunc, softMax, out) : TrainSharded<double>(options, dataFile, fcnnInput, fcnnOutput, numThreads, epochs, numHiddenLayers, hiddenLayers, learningRate, useThreads, actFunc, softMax, out);
+        delete[] hiddenLayers;
+        return result;
+    }
+
+    /* Image size, record count and classes all come from the data set */
+    PackedDataSet dataSet;
+    cout << "Start: Preparing Input Data" << endl;
+    int dataCount = options.maxRecords;
+
+    cout << dataFile << endl;
+    GetDataSet(dataFile, dataCount, dataSet, options.loaderThreads, options.dataCache);
+
+    if (dataCount == 0) {
+        cout << "No input data to train on." << endl;
+        delete[] hiddenLayers;
+        return 1;
+    }
+
+    unsigned int inputLayerSize = dataSet.height * dataSet.width;
+    unsigned int outputSize = patternClasses.getSize();
+    if (options.outputSize > outputSize) {
+        outputSize = options.outputSize;
+    }
+    hiddenLayers[numHiddenLayers - 1] = outputSize;
 
     bool testEfficiency = false;
 
     if (testEfficiency) {
-        fcnn::determineMostEfficientModel(inputLayerSize, numHiddenLayers, hiddenLayers, outputSize, actFunc, softMax, true);
+        fcnn<double>::determineMostEfficientModel(inputLayerSize, numHiddenLayers, hiddenLayers, outputSize, actFunc, softMax, true);
         //------------------------------------
     }
     else {
 
-        Pattern* dataArray = nullptr;
-        cout << "Start: Preparing Input Data" << endl;
-        int dataCount = 288200;
-
-        cout << dataFile << endl;
-        dataArray = GetDataArray(dataFile, dataCount);
-        shuffleData(dataArray, dataCount);
-
-        unsigned int* labels = new unsigned int[dataCount];
-        for (unsigned int i = 0; i < dataCount; i++) {
-            labels[i] = dataArray[i].LableId;
-        }
-
+        /* Splits are index views - the images stay packed where they are */
         double testingSplit = 0.20;
-        unsigned int testingCount = 0;
-        unsigned int trainingCount = 0;
-        unsigned int* trainingData = nullptr;
-        unsigned int* testingData = nullptr;
-        DataSplitter ds(labels, dataCount);
-        ds.splitData(testingSplit);
-        ds.getSplitData(trainingData, trainingCount, testingData, testingCount);
-        cout << trainingCount << " , " << testingCount << endl;
-
-        if (dataArray == nullptr) {
-            cout << "No input data to train on." << endl;
-            return 1;
+        DataSplitter ds(dataSet.labels, dataCount, options.seed);
+        if (options.folds >= 2) {
+            ds.splitFolds(options.folds);
         }
         else {
-            cout << "Read " << dataCount << " patterns." << endl;
+            ds.splitRepeated(testingSplit, (options.repeats > 0) ? options.repeats : 1);
         }
 
-        for (unsigned int i = 0; i < outputSize; i++) {
-            cout << "Class " << i << " : " << Pattern::classIdToClassName(i) << endl;
+        if (ds.getNumSplits() > 1) {
+            int result = useFloat ? TrainSplits<float>(options, dataSet, ds, fcnnInput, inputLayerSize, outputSize, numThreads, epochs, numHiddenLayers, hiddenLayers, learningRate, useThreads, actFunc, softMax, out) : TrainSplits<double>(options, dataSet, ds, fcnnInput, inputLayerSize, outputSize, numThreads, epochs, numHiddenLayers, hiddenLayers, learningRate, useThreads, actFunc, softMax, out);
+            delete[] hiddenLayers;
+            return result;
         }
 
+        if (useFloat) {
+            TrainHoldOut<float>(options, dataSet, ds, fcnnInput, fcnnOutput, inputLayerSize, outputSize, numThreads, epochs, numHiddenLayers, hiddenLayers, learningRate, useThreads, actFunc, softMax, out);
+        }
+        else {
+            TrainHoldOut<double>(options, dataSet, ds, fcnnInput, fcnnOutput, inputLayerSize, outputSize, numThreads, epochs, numHiddenLayers, hiddenLayers, learningRate, useThreads, actFunc, softMax, out);
+        }
 
+        // Here
+        cout << "Start: Deallocation" << endl;
+        delete[] hiddenLayers;
 
-        if (dataCount > 0 && dataArray != nullptr) {
+        cout << "Finish: Deallocation" << endl;
+    }
+    return 0;
+}
 
-            cout << "Start: Creating Neural Network of size: " << numHiddenLayers << ". Structure: { ";
-            for (unsigned int i = 0; i < numHiddenLayers; i++) {
-                cout << hiddenLayers[i] << " ";
-            }
-            cout << "} with input size: " << inputLayerSize << ". Will train with " << numThreads << " threads." << endl;
-            fcnn fcnn(inputLayerSize, numHiddenLayers, hiddenLayers, numThreads, useThreads, actFunc, softMax);
-            cout << "Finish: Creating Neural Network" << endl;
 
+/******************************************************************************
+ * ReadOption
+-------------------------------------------------------------------------------
+ * Reads one "key=value" line from the params file. Blank lines and lines
+ * starting with # are ignored.
+*******************************************************************************/
+void ReadOption(RecognizerOptions& options, string line) {
+    while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) {
+        line.pop_back();
+    }
+    if (line.empty() || line[0] == '#') {
+        return;
+    }
+    size_t split = line.find('=');
+    if (split == string::npos) {
+        cout << "Ignoring params line \"" << line << "\" (expected key=value)" << endl;
+        return;
+    }
+    string key = line.substr(0, split);
+    string value = line.substr(split + 1);
+
+    if (key == "dataSource") { options.dataSource = value; }
+    else if (key == "generatorClasses") { options.generatorClasses = value; }
+    else if (key == "generatorUnitSize") { options.generatorUnitSize = stoi(value); }
+    else if (key == "generatorHeight") { options.generatorHeight = stoi(value); }
+    else if (key == "generatorWidth") { options.generatorWidth = stoi(value); }
+    else if (key == "generatorMinScale") { options.generatorMinScale = stod(value); }
+    else if (key == "generatorScaleStep") { options.generatorScaleStep = stod(value); }
+    else if (key == "generatorMaxScale") { options.generatorMaxScale = stod(value); }
+    else if (key == "unitTransformVariants") { options.unitTransformVariants = stoi(value); }
+    else if (key == "unitRotation") { options.unitRotation = stod(value); }
+    else if (key == "unitStretch") { options.unitStretch = stod(value); }
+    else if (key == "unitShear") { options.unitShear = stod(value); }
+    else if (key == "generatorThreads") { options.generatorThreads = stoi(value); }
+    else if (key == "generatorBatchSize") { options.generatorBatchSize = stoi(value); }
+    else if (key == "samplesPerEpoch") { options.samplesPerEpoch = stoi(value); }
+    else if (key == "testSamples") { options.testSamples = stoi(value); }
+    else if (key == "seed") { options.seed = stoi(value); }
+    else if (key == "shuffleEachEpoch") { options.shuffleEachEpoch = (value == "true"); }
+    else if (key == "loaderThreads") { options.loaderThreads = stoi(value); }
+    else if (key == "dataCache") { options.dataCache = (value == "true"); }
+    else if (key == "shardMegabytes") { options.shardMegabytes = stoi(value); }
+    else if (key == "windowShards") { options.windowShards = stoi(value); }
+    else if (key == "testFile") { options.testFile = value; }
+    else if (key == "folds") { options.folds = stoi(value); }
+    else if (key == "repeats") { options.repeats = stoi(value); }
+    else if (key == "concurrentSplits") { options.concurrentSplits = stoi(value); }
+    else if (key == "maxRecords") { options.maxRecords = stoi(value); }
+    else if (key == "outputSize") { options.outputSize = stoi(value); }
+    else if (key == "batchSize") { options.batchSize = stoi(value); }
+    else if (key == "precision") { options.precision = value; }
+    else if (key == "loss") { options.loss = value; }
+    else if (key == "optimizer") { options.optimizer.name = value; }
+    else if (key == "momentum") { options.optimizer.momentum = stod(value); }
+    else if (key == "beta1") { options.optimizer.beta1 = stod(value); }
+    else if (key == "beta2") { options.optimizer.beta2 = stod(value); }
+    else if (key == "epsilon") { options.optimizer.epsilon = stod(value); }
+    else if (key == "weightDecay") { options.optimizer.weightDecay = stod(value); }
+    else if (key == "augmentVariants") { options.augmentation.variantsPerPattern = stoi(value); }
+    else if (key == "augmentKeepOriginal") { options.augmentation.keepOriginal = (value == "true"); }
+    else if (key == "augmentTranslation") { options.augmentation.maxTranslation = stoi(value); }
+    else if (key == "augmentRotate90") { options.augmentation.rotate90 = (value == "true"); }
+    else if (key == "augmentRotation") { options.augmentation.maxRotationDegrees = stod(value); }
+    else if (key == "augmentFlipHorizontal") { options.augmentation.flipHorizontal = (value == "true"); }
+    else if (key == "augmentFlipVertical") { options.augmentation.flipVertical = (value == "true"); }
+    else if (key == "augmentNoise") { options.augmentation.noiseProbability = stod(value); }
+    else if (key == "augmentMorphology") { options.augmentation.morphologyProbability = stod(value); }
+    else { cout << "Ignoring unknown option \"" << key << "\"" << endl; }
+}
 
-            cout << "Training instances: " << trainingCount << ", Testing instances: " << testingCount << endl;
+/******************************************************************************
+ * UseFloat
+-------------------------------------------------------------------------------
+ * True if the network should be an fcnn<float> - precision=float, or no
+ * precision given and the imported network was saved as FLOAT32.
+*******************************************************************************/
+bool UseFloat(const RecognizerOptions& options, const string& fcnnInput) {
+    if (options.precision == "float") {
+        return true;
+    }
+    if (options.precision == "double") {
+        return false;
+    }
+    if (!options.precision.empty()) {
+        cout << "Unknown precision \"" << options.precision << "\", using double" << endl;
+        return false;
+    }
+    return !fcnnInput.empty() && readFcnnPrecision(fcnnInput) == "FLOAT32";
+}
 
-            // Make the input data
-            unsigned int numData = trainingCount;
-            double** inputData = new double* [numData];
-            double** labels = new double* [numData];
+/******************************************************************************
+ * TrainOnline
+-------------------------------------------------------------------------------
+ * Online training - every epoch trains on samplesPerEpoch samples pulled from
+ * a GeneratorFeed, so nothing is staged on disk and the training set is not
+ * limited by memory. Validation uses testSamples more samples.
+ *
+ * dataSource=generator runs the generator in this process.
+ * dataSource=stream reads a record stream (PatternGenerator --stream) from
+ * dataFile, which can be a named pipe or "-" for stdin. Training stops early
+ * if the stream ends.
+*******************************************************************************/
+template<typename T>
+int TrainOnline(const RecognizerOptions& options, const string& dataFile, const string& fcnnInput, const string& fcnnOutput, const unsigned int& numThreads, const unsigned int& epochs, const unsigned int& numHiddenLayers, unsigned int hiddenLayers[], const double& learningRate, const bool& useThreads, const string& actFunc, const bool& softMax, ostream* out) {
+
+    GeneratorFeed* feed = nullptr;
+    FILE* streamFile = nullptr;
+    RecordStreamReader* reader = nullptr;
+
+    if (options.dataSource == "stream") {
+        cout << "Start: Opening record stream " << dataFile << endl;
+        if (dataFile.empty() || dataFile == "-") {
+#ifdef _WIN32
+            _setmode(_fileno(stdin), _O_BINARY);
+#endif
+            streamFile = stdin;
+        }
+        else {
+            streamFile = fopen(dataFile.c_str(), "rb");
+        }
+        if (streamFile == nullptr) {
+            cout << "Unable to open record stream " << dataFile << endl;
+            return 1;
+        }
+        reader = new RecordStreamReader(streamFile);
+        if (!reader->ReadHeader()) {
+            cout << "Not a record stream: " << dataFile << endl;
+            delete reader;
+            if (streamFile != stdin) { fclose(streamFile); }
+            return 1;
+        }
+        feed = new GeneratorFeed(reader, options.generatorBatchSize, 4);
+        cout << "Finish: Opening record stream" << endl;
+    }
+    else {
+        /* Split up the class list */
+        Array<string> classNames;
+        size_t start = 0;
+        while (start <= options.generatorClasses.size()) {
+            size_t end = options.generatorClasses.find(',', start);
+            if (end == string::npos) { end = options.generatorClasses.size(); }
+            if (end > start) { classNames.add(options.generatorClasses.substr(start, end - start)); }
+            start = end + 1;
+        }
+        string* names = new string[classNames.getSize()];
+        for (unsigned int i = 0; i < classNames.getSize(); i++) {
+            names[i] = classNames[i];
+        }
 
-            for (unsigned int i = 0; i < numData; i++) {
-                inputData[i] = dataArray[trainingData[i]].data;
-                labels[i] = dataArray[trainingData[i]].GetOutputAsDoubleArray(outputSize);
+        PatternStreamSettings settings;
+        settings.classNames = names;
+        settings.numberOfClasses = classNames.getSize();
+        settings.unitPatternHeight = options.generatorUnitSize;
+        settings.unitPatternWidth = options.generatorUnitSize;
+        settings.patternHeight = options.generatorHeight;
+        settings.patternWidth = options.generatorWidth;
+        settings.minScale = options.generatorMinScale;
+        settings.scaleStep = options.generatorScaleStep;
+        settings.maxScale = options.generatorMaxScale;
+        settings.unitTransformVariants = options.unitTransformVariants;
+        settings.maxUnitRotationDegrees = options.unitRotation;
+        settings.maxUnitStretch = options.unitStretch;
+        settings.maxUnitShear = options.unitShear;
+        settings.augmentation = options.augmentation;
+
+        cout << "Start: Starting " << options.generatorThreads << " generator threads" << endl;
+        feed = new GeneratorFeed(settings, options.generatorThreads, options.generatorBatchSize, 2 * options.generatorThreads + 2, options.seed);
+        delete[] names;
+        if (feed->isEmpty()) {
+            /* the generator never draws a unit smaller than 30 pixels, so nothing fits below generatorUnitSize * generatorMaxScale = 30 */
+            cout << "ERROR: No class has any unit patterns with generatorUnitSize=" << options.generatorUnitSize
+                << " and generatorMaxScale=" << options.generatorMaxScale << " - units are never drawn smaller than 30 pixels,"
+                << " so generatorUnitSize * generatorMaxScale must be at least 30 (generatorHeight and generatorWidth grow with it)" << endl;
+            delete feed;
+            return 1;
+        }
+        cout << "Finish: Starting generator threads" << endl;
+    }
 
-            }
-            cout << "Finish: Preparing Input Data" << endl;
+    unsigned int inputLayerSize = feed->getInputSize();
+    unsigned int outputSize = feed->getOutputSize();
+    int result = 0;
 
-            fcnn.importFcnn(fcnnInput);
+    if (outputSize == 0) {
+        cout << "No classes to train on." << endl;
+        result = 1;
+    }
+    else {
+        hiddenLayers[numHiddenLayers - 1] = outputSize;
+        for (unsigned int i = 0; i < outputSize; i++) {
+            cout << "Class " << i << " : " << feed->getClassName(i) << endl;
+        }
 
-            cout << "Start: Training" << endl;
-            fcnn.train(inputData, labels, trainingCount, epochs, learningRate, out);
-            cout << "Finish: Training" << endl;
+        cout << "Start: Creating Neural Network of size: " << numHiddenLayers << ". Structure: { ";
+        for (unsigned int i = 0; i < numHiddenLayers; i++) {
+            cout << hiddenLayers[i] << " ";
+        }
+        cout << "} with input size: " << inputLayerSize << ". Will train with " << numThreads << " threads." << endl;
+        fcnn<T> network(inputLayerSize, numHiddenLayers, hiddenLayers, numThreads, useThreads, actFunc, softMax);
+        network.setBatchSize(options.batchSize);
+        network.setLoss(options.loss);
+        network.setOptimizer(options.optimizer);
+        cout << "Finish: Creating Neural Network" << endl;
+
+        if (!fcnnInput.empty()) {
+            network.importFcnn(fcnnInput);
+        }
 
-            /*************************************************************************/
-            /*************************************************************************/
-            /*************************************************************************/
-            if (trainingCount > 0) {
-                cout << "Validating Training:" << endl;
-                fcnn.validate(inputData, labels, trainingCount, out);
+        double** inputs = nullptr;
+        unsigned int* labels = nullptr;
+        unsigned int count = 0;
+        bool ended = false;
+
+        cout << "Start: Training on " << options.samplesPerEpoch << " samples per epoch" << endl;
+        for (unsigned int epc = 0; epc < epochs && !ended; epc++) {
+            auto epochStart = std::chrono::system_clock::now();
+            unsigned int trained = 0;
+            while (trained < options.samplesPerEpoch) {
+                feed->acquireBatch(inputs, labels, count);
+                if (count == 0) {
+                    cout << "Data ran out during epoch " << epc << " after " << trained << " samples." << endl;
+                    ended = true;
+                    break;
+                }
+                if (count > options.samplesPerEpoch - trained) {
+                    count = options.samplesPerEpoch - trained;
+                }
+                network.train(inputs, labels, count, 1, learningRate, nullptr);
+                feed->releaseBatch();
+                trained += count;
             }
-            /*************************************************************************/
-            /*************************************************************************/
-            /*************************************************************************/
-            if (testingCount > 0) {
-                cout << "Validating Testing:" << endl;
-                double** inputDataTest = new double* [testingCount];
-                double** labelsTest = new double* [testingCount];
-                for (unsigned int i = 0; i < testingCount; i++) {
-                    inputDataTest[i] = dataArray[testingData[i]].data;
-                    labelsTest[i] = dataArray[testingData[i]].GetOutputAsDoubleArray(outputSize);
+            std::chrono::duration<double> elapsed_seconds = std::chrono::system_clock::now() - epochStart;
+            if (out != nullptr) {
+                *out << "Finished epoch " + to_string(epc) + " in " + to_string(elapsed_seconds.count()) + " seconds.\n";
+            }
+        }
+        cout << "Finish: Training" << endl;
+
+        /* Validation set - copied out of the ring since slots get reused */
+        if (options.testSamples > 0 && !ended) {
+            cout << "Validating Testing:" << endl;
+            double* testInputArena = new double[(size_t)options.testSamples * inputLayerSize];
+            double** testInputs = new double* [options.testSamples];
+            uint32_t* testLabels = new uint32_t[options.testSamples];
+            unsigned int collected = 0;
+            while (collected < options.testSamples) {
+                feed->acquireBatch(inputs, labels, count);
+                if (count == 0) {
+                    break;
                 }
-                fcnn.validate(inputDataTest, labelsTest, testingCount, out);
-
-                for (unsigned int i = 0; i < testingCount; i++) {
-                    delete[] labelsTest[i];
+                for (unsigned int i = 0; i < count && collected < options.testSamples; i++, collected++) {
+                    testInputs[collected] = testInputArena + ((size_t)collected * inputLayerSize);
+                    testLabels[collected] = labels[i];
+                    for (unsigned int j = 0; j < inputLayerSize; j++) { testInputs[collected][j] = inputs[i][j]; }
                 }
-                delete[] inputDataTest;
-                delete[] labelsTest;
+                feed->releaseBatch();
+            }
+            if (collected > 0) {
+                network.validate(testInputs, testLabels, collected, out);
             }
-            /*************************************************************************/
-            /*************************************************************************/
-            /*************************************************************************/
+            delete[] testInputs;
+            delete[] testLabels;
+            delete[] testInputArena;
+        }
+        else if (ended) {
+            cout << "No data left to validate with." << endl;
+        }
 
-            fcnn.exportFcnn(fcnnOutput);
+        network.exportFcnn(fcnnOutput);
+    }
 
-            for (unsigned int i = 0; i < numData; i++) {
-                //delete[] inputData[i];
-                delete[] labels[i];
-            }
-            delete[] inputData;
-            delete[] labels;
+    delete feed;
+    delete reader;
+    if (streamFile != nullptr && streamFile != stdin) {
+        fclose(streamFile);
+    }
+    return result;
+}
 
-        }
+/******************************************************************************
+ * TrainSharded
+-------------------------------------------------------------------------------
+ * Out-of-core training - dataFile is read a window of shards at a time
+ * (see ShardedDataSource) so it can be far larger than memory. The network
+ * is sized from the images and classes found in dataFile. After training the
+ * network is validated on testFile if one is given.
+*******************************************************************************/
+template<typename T>
+int TrainSharded(const RecognizerOptions& options, const string& dataFile, const string& fcnnInput, const string& fcnnOutput, const unsigned int& numThreads, const unsigned int& epochs, const unsigned int& numHiddenLayers, unsigned int hiddenLayers[], const double& learningRate, const bool& useThreads, const string& actFunc, const bool& softMax, ostream* out) {
+
+    cout << "Start: Indexing " << dataFile << endl;
+    uint64_t shardBytes = (uint64_t)options.shardMegabytes * 1024 * 1024;
+    ShardedDataSource trainingSource(dataFile, patternClasses, shardBytes, options.windowShards, options.seed, options.shuffleEachEpoch);
+    if (!trainingSource.isOpen()) {
+        cout << "No input data to train on." << endl;
+        return 1;
+    }
+    cout << "Finish: Indexing " << dataFile << endl;
 
-        // Here
-        cout << "Start: Deallocation" << endl;
-        delete[] hiddenLayers;
-        delete[] trainingData;
-        delete[] testingData;
-        delete[] dataArray;
+    unsigned int inputLayerSize = trainingSource.getHeight() * trainingSource.getWidth();
+    unsigned int outputSize = trainingSource.getOutputSize();
+    hiddenLayers[numHiddenLayers - 1] = outputSize;
+    for (unsigned int i = 0; i < outputSize; i++) {
+        cout << "Class " << i << " : " << patternClasses.getName(i) << endl;
+    }
 
-        cout << "Finish: Deallocation" << endl;
+    cout << "Start: Creating Neural Network of size: " << numHiddenLayers << ". Structure: { ";
+    for (unsigned int i = 0; i < numHiddenLayers; i++) {
+        cout << hiddenLayers[i] << " ";
+    }
+    cout << "} with input size: " << inputLayerSize << ". Will train with " << numThreads << " threads." << endl;
+    fcnn<T> network(inputLayerSize, numHiddenLayers, hiddenLayers, numThreads, useThreads, actFunc, softMax);
+    network.setBatchSize(options.batchSize);
+    network.setLoss(options.loss);
+    network.setOptimizer(options.optimizer);
+    cout << "Finish: Creating Neural Network" << endl;
+
+    if (!fcnnInput.empty()) {
+        network.importFcnn(fcnnInput);
     }
+
+    cout << "Start: Training on " << trainingSource.getNumData() << " patterns in " << trainingSource.getNumShards() << " shards" << endl;
+    network.train(trainingSource, epochs, learningRate, out);
+    cout << "Finish: Training" << endl;
+
+    if (!options.testFile.empty()) {
+        cout << "Validating Testing:" << endl;
+        ShardedDataSource testingSource(options.testFile, patternClasses, shardBytes, options.windowShards, options.seed, false);
+        testingSource.setOutputSize(outputSize);
+        if (!testingSource.isOpen()) {
+            cout << "No test data in " << options.testFile << endl;
+        }
+        else if (testingSource.getHeight() * testingSource.getWidth() != inputLayerSize) {
+            cout << options.testFile << " does not match the size of the training images" << endl;
+        }
+        else {
+            network.validate(testingSource, out);
+        }
+    }
+
+    network.exportFcnn(fcnnOutput);
     return 0;
 }
 
+/* One network trained and tested on one split - run on a thread of its own */
+template<typename T>
+struct SplitRun {
+    fcnn<T>* network = nullptr;
+    PackedDataSource* training = nullptr;
+    PackedDataSource* testing = nullptr;
+    unsigned int epochs = 0;
+    double learningRate = 0.0;
+    double trainingSeconds = 0.0;
+};
+
+template<typename T>
+void* RunSplit(void* args) {
+    SplitRun<T>* run = (SplitRun<T>*)args;
+    auto start = std::chrono::system_clock::now();
+    run->network->train(*run->training, run->epochs, run->learningRate, nullptr);
+    std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+    run->trainingSeconds = elapsed.count();
+    run->network->validate(*run->testing, nullptr);
+    return nullptr;
+}
 
-Pattern* GetDataArray(const string& dataFile, int &dataCount) {
-    Pattern* data = nullptr;
-    ifstream inFile;
-    inFile.open(dataFile);
-    int lineCounter = 0;
-
-    bool dataCountKnown = (dataCount > 0);
-    unsigned int lineSplitter = dataCount / 20;
-
-    if (inFile.is_open()) {
-        string s;
-        Array<string> dataStrings;
-        if (!dataCountKnown) {
-            cout << "Reading Data In..." << endl;
-            while (getline(inFile, s)) {
-                dataStrings.add(s);
-                lineCounter += 1;
-                if (lineCounter % 1000 == 0) {
-                    cout << lineCounter << endl;
-                }
-            }
-            dataCount = dataStrings.getSize();
+/******************************************************************************
+ * TrainSplits
+-------------------------------------------------------------------------------
+ * Benchmark over every split of the splitter (folds or repeated hold out).
+ * Each split gets a network of its own, concurrentSplits of them train at
+ * once, and all of them read the same packed data set through index views.
+ * Prints the accuracy and training time of every split and their mean and
+ * standard deviation. The networks are not exported.
+*******************************************************************************/
+template<typename T>
+int TrainSplits(const RecognizerOptions& options, const PackedDataSet& dataSet, const DataSplitter& splitter, const string& fcnnInput, const unsigned int& inputSize, const unsigned int& outputSize, const unsigned int& numThreads, const unsigned int& epochs, const unsigned int& numHiddenLayers, unsigned int hiddenLayers[], const double& learningRate, const bool& useThreads, const string& actFunc, const bool& softMax, ostream* out) {
+
+    unsigned int numSplits = splitter.getNumSplits();
+    unsigned int concurrent = (options.concurrentSplits > 0 && options.concurrentSplits < numSplits) ? options.concurrentSplits : numSplits;
+    cout << "Start: " << numSplits << ((options.folds >= 2) ? " folds" : " repeated splits") << ", " << concurrent << " trained at once" << endl;
+
+    /* Networks are made here - weight initialization shares one generator */
+    SplitRun<T>* runs = new SplitRun<T>[numSplits];
+    for (unsigned int i = 0; i < numSplits; i++) {
+        const unsigned int* trainingData = nullptr;
+        const unsigned int* testingData = nullptr;
+        unsigned int trainingCount = 0;
+        unsigned int testingCount = 0;
+        splitter.getSplit(i, trainingData, trainingCount, testingData, testingCount);
+
+        runs[i].network = new fcnn<T>(inputSize, numHiddenLayers, hiddenLayers, numThreads, useThreads, actFunc, softMax);
+        runs[i].network->setShuffle(options.shuffleEachEpoch, options.seed + i);
+        runs[i].network->setBatchSize(options.batchSize);
+        runs[i].network->setLoss(options.loss);
+        runs[i].network->setOptimizer(options.optimizer);
+        if (!fcnnInput.empty()) {
+            runs[i].network->importFcnn(fcnnInput);
         }
-        data = new Pattern[dataCount];
-        cout << "Creating Pattern Objects..." << endl;
-        lineCounter = 0;
-        for (int i = 0; i < dataCount; i++) {
-            if (dataCountKnown) { getline(inFile, s); }
-            else { s = dataStrings[i]; }
-            data[i] = Pattern(s);
-            lineCounter += 1;
-            if (lineCounter % lineSplitter == 0) {
-                cout << lineCounter << endl;
-            }
+        runs[i].training = new PackedDataSource(dataSet, trainingData, trainingCount, outputSize);
+        runs[i].testing = new PackedDataSource(dataSet, testingData, testingCount, outputSize);
+        runs[i].epochs = epochs;
+        runs[i].learningRate = learningRate;
+    }
+
+    pthread_t* threads = new pthread_t[concurrent];
+    for (unsigned int first = 0; first < numSplits; first += concurrent) {
+        unsigned int last = (first + concurrent < numSplits) ? first + concurrent : numSplits;
+        for (unsigned int i = first; i < last; i++) {
+            pthread_create(threads + (i - first), NULL, RunSplit<T>, (void*)(runs + i));
+        }
+        for (unsigned int i = first; i < last; i++) {
+            pthread_join(threads[i - first], NULL);
+            cout << "Finish: Split " << i << endl;
         }
     }
-    else {
-        cout << "ERROR: Could not open data file" << endl;
+    delete[] threads;
+
+    double accuracySum = 0.0;
+    double accuracySquares = 0.0;
+    double secondsSum = 0.0;
+    double secondsSquares = 0.0;
+    for (unsigned int i = 0; i < numSplits; i++) {
+        double accuracy = runs[i].network->getValidationAccuracy();
+        double seconds = runs[i].trainingSeconds;
+        *out << "| Split " << i << ": training " << runs[i].training->getNumData() << ", testing " << runs[i].testing->getNumData()
+            << ", accuracy " << accuracy << "%, average error " << runs[i].network->getValidationError()
+            << ", training time " << seconds << "s" << endl;
+        accuracySum += accuracy;
+        accuracySquares += accuracy * accuracy;
+        secondsSum += seconds;
+        secondsSquares += seconds * seconds;
+    }
+    double accuracyMean = accuracySum / numSplits;
+    double secondsMean = secondsSum / numSplits;
+    *out << "| Accuracy:      " << accuracyMean << "% +/- " << sqrt(fmax(0.0, accuracySquares / numSplits - accuracyMean * accuracyMean)) << endl;
+    *out << "| Training time: " << secondsMean << "s +/- " << sqrt(fmax(0.0, secondsSquares / numSplits - secondsMean * secondsMean)) << endl;
+
+    for (unsigned int i = 0; i < numSplits; i++) {
+        delete runs[i].network;
+        delete runs[i].training;
+        delete runs[i].testing;
+    }
+    delete[] runs;
+    return 0;
+}
+
+/******************************************************************************
+ * TrainHoldOut
+-------------------------------------------------------------------------------
+ * Trains on the one split of the splitter, validates on its training and
+ * testing halves and exports the network.
+*******************************************************************************/
+template<typename T>
+int TrainHoldOut(const RecognizerOptions& options, const PackedDataSet& dataSet, const DataSplitter& splitter, const string& fcnnInput, const string& fcnnOutput, const unsigned int& inputSize, const unsigned int& outputSize, const unsigned int& numThreads, const unsigned int& epochs, const unsigned int& numHiddenLayers, unsigned int hiddenLayers[], const double& learningRate, const bool& useThreads, const string& actFunc, const bool& softMax, ostream* out) {
+
+    unsigned int testingCount = 0;
+    unsigned int trainingCount = 0;
+    const unsigned int* trainingData = nullptr;
+    const unsigned int* testingData = nullptr;
+    splitter.getSplit(0, trainingData, trainingCount, testingData, testingCount);
+    cout << trainingCount << " , " << testingCount << endl;
+
+    cout << "Read " << dataSet.count << " patterns of " << patternClasses.getSize() << " classes." << endl;
+
+    for (unsigned int i = 0; i < outputSize; i++) {
+        cout << "Class " << i << " : " << patternClasses.getName(i) << endl;
+    }
+
+    cout << "Start: Creating Neural Network of size: " << numHiddenLayers << ". Structure: { ";
+    for (unsigned int i = 0; i < numHiddenLayers; i++) {
+        cout << hiddenLayers[i] << " ";
+    }
+    cout << "} with input size: " << inputSize << ". Will train with " << numThreads << " threads." << endl;
+    fcnn<T> network(inputSize, numHiddenLayers, hiddenLayers, numThreads, useThreads, actFunc, softMax);
+    network.setShuffle(options.shuffleEachEpoch, options.seed);
+    network.setBatchSize(options.batchSize);
+    network.setLoss(options.loss);
+    network.setOptimizer(options.optimizer);
+    cout << "Finish: Creating Neural Network" << endl;
+
+
+    cout << "Training instances: " << trainingCount << ", Testing instances: " << testingCount << endl;
+
+    // Pixels are only expanded to doubles a block at a time while training
+    PackedDataSource trainingSource(dataSet, trainingData, trainingCount, outputSize);
+    cout << "Finish: Preparing Input Data" << endl;
+
+    if (!fcnnInput.empty()) {
+        network.importFcnn(fcnnInput);
+    }
+
+    cout << "Start: Training" << endl;
+    network.train(trainingSource, epochs, learningRate, out);
+    cout << "Finish: Training" << endl;
+
+    /*************************************************************************/
+    /*************************************************************************/
+    /*************************************************************************/
+    if (trainingCount > 0) {
+        cout << "Validating Training:" << endl;
+        network.validate(trainingSource, out);
+    }
+    /*************************************************************************/
+    /*************************************************************************/
+    /*************************************************************************/
+    if (testingCount > 0) {
+        cout << "Validating Testing:" << endl;
+        PackedDataSource testingSource(dataSet, testingData, testingCount, outputSize);
+        network.validate(testingSource, out);
+    }
+    /*************************************************************************/
+    /*************************************************************************/
+    /*************************************************************************/
+
+    network.exportFcnn(fcnnOutput);
+    return 0;
+}
+
+bool GetDataSet(const string& dataFile, int &dataCount, PackedDataSet& dataSet, const unsigned int& loaderThreads, const bool& useCache) {
+    cout << "Reading Data In..." << endl;
+    unsigned int maxRecords = (dataCount > 0) ? dataCount : 0;
+    bool loaded = useCache ? loadCachedCsvDataSet(dataFile, patternClasses, dataSet, maxRecords, loaderThreads)
+        : loadCsvDataSet(dataFile, patternClasses, dataSet, maxRecords, loaderThreads);
+    if (!loaded) {
+        dataCount = 0;
+        return false;
     }
-    return data;
+    dataCount = dataSet.count;
+    cout << "Read " << dataCount << " patterns of " << dataSet.height << "x" << dataSet.width << " (" << ((size_t)dataSet.count * dataSet.bytesPerRecord) << " bytes packed)" << endl;
+    return true;
 }
@@ -0,0 +1,604 @@
+#pragma once
+
+/* Headers */
+#include <pthread.h>
+#include <random>
+#include <string>
+#include <cstdint>
+#include "DataLoader.h"
+
+#ifndef _WIN32
+#include <sys/types.h>
+#endif
+
+using namespace std;
+
+/************************************************************
+#############################################################
+#   Random Access File Class
+#############################################################
+#
+#   Plain read-at-offset access to a file (pread) with hints
+#   to the OS about which ranges are needed next and which
+#   are done with, so a file larger than memory can be read
+#   a piece at a time without filling the page cache.
+************************************************************/
+class RandomAccessFile {
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+#else
+    int file = -1;
+#endif
+    uint64_t length = 0;    /* size of the file */
+
+public:
+    RandomAccessFile() { }
+    RandomAccessFile(const RandomAccessFile& copy) = delete;
+    void operator=(const RandomAccessFile& copy) = delete;
+    ~RandomAccessFile() { close(); }
+
+    /* opens the file for reading - returns false if it can not be opened */
+    bool open(const string& path) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        GetFileSizeEx(file, &size);
+        length = (uint64_t)size.QuadPart;
+#else
+        file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(file, &info) != 0) {
+            close();
+            return false;
+        }
+        length = (uint64_t)info.st_size;
+#endif
+        return true;
+    }
+
+    /* closes the file */
+    void close() {
+#ifdef _WIN32
+        if (file != INVALID_HANDLE_VALUE) { CloseHandle(file); }
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (file >= 0) { ::close(file); }
+        file = -1;
+#endif
+        length = 0;
+    }
+
+    uint64_t size() const { return length; }
+
+    /* reads exactly bytes bytes at offset - returns false on a short read */
+    bool readAt(char* buffer, const size_t& bytes, const uint64_t& offset) const {
+        size_t done = 0;
+        while (done < bytes) {
+#ifdef _WIN32
+            OVERLAPPED position = {};
+            position.Offset = (DWORD)((offset + done) & 0xFFFFFFFF);
+            position.OffsetHigh = (DWORD)((offset + done) >> 32);
+            DWORD chunk = (bytes - done > 0x40000000) ? 0x40000000 : (DWORD)(bytes - done);
+            DWORD got = 0;
+            if (!ReadFile(file, buffer + done, chunk, &got, &position) || got == 0) {
+                return false;
+            }
+#else
+            ssize_t got = pread(file, buffer + done, bytes - done, (off_t)(offset + done));
+            if (got <= 0) {
+                return false;
+            }
+#endif
+            done += (size_t)got;
+        }
+        return true;
+    }
+
+    /* hints that [offset, offset + bytes) will be read soon */
+    void willNeed(const uint64_t& offset, const uint64_t& bytes) const {
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+        posix_fadvise(file, (off_t)offset, (off_t)bytes, POSIX_FADV_WILLNEED);
+#endif
+    }
+
+    /* hints that [offset, offset + bytes) will not be read again soon */
+    void dontNeed(const uint64_t& offset, const uint64_t& bytes) const {
+#if !defined(_WIN32) && defined(POSIX_FADV_DONTNEED)
+        posix_fadvise(file, (off_t)offset, (off_t)bytes, POSIX_FADV_DONTNEED);
+#endif
+    }
+};
+/************************************************************
+* ///////////////////////////|\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\
+* \\\\\\\\\\\\\\\\\\\\\\\\\\\|///////////////////////////////
+************************************************************/
+
+
+/************************************************************
+#############################################################
+#   Sharded Data Source Class
+#############################################################
+#
+#   Trains from a data.csv that does not fit in memory.
+#   The file is cut into shards of about shardBytes at line
+#   boundaries and only a window of windowShards shards is
+#   resident (packed one bit per pixel) at a time. While the
+#   window is trained on, a background thread reads (pread)
+#   and packs the next window, so the file is read once per
+#   epoch at a steady rate.
+#
+#   Shuffling is two level: the shard order is reshuffled
+#   every epoch (same seed, same orders) and samples are
+#   shuffled across all shards of a window. The fcnn's own
+#   shuffle is turned off (allowsShuffle) since samples are
+#   handed out in this order no matter which are asked for.
+#
+#   Opening the file makes one pass over it to find the
+#   shards, count the images and collect the class names.
+************************************************************/
+class ShardedDataSource : public fcnnDataSource {
+private:
+
+    /*---------------------------------------------*/
+    /* Enum for the state of a shard slot */
+    /*---------------------------------------------*/
+    enum slotState {
+        EMPTY       /* waiting for the loader */
+        , LOADING   /* the loader is reading into it */
+        , FULL      /* loaded, waiting to join a window */
+        , IN_USE    /* part of the window being trained on */
+    };
+
+    /*---------------------------------------------*/
+    /* A byte range of the file holding whole lines */
+    /*---------------------------------------------*/
+    struct shard {
+        uint64_t offset = 0;        /* first byte */
+        uint64_t length = 0;        /* number of bytes */
+        unsigned int count = 0;     /* number of good images in it */
+    };
+
+    /*---------------------------------------------*/
+    /* A resident shard */
+    /*---------------------------------------------*/
+    struct shardSlot {
+        slotState state = EMPTY;
+        uint64_t sequence = 0;              /* position in the endless epoch-by-epoch shard sequence */
+        unsigned int count = 0;             /* images loaded */
+        unsigned char* packed = nullptr;    /* packed images */
+        unsigned int* labels = nullptr;     /* class id of every image */
+    };
+
+    string path = "";                       /* data file */
+    RandomAccessFile file;                  /* data file for the loader */
+    LabelDictionary* classes = nullptr;     /* class names - not owned */
+    unsigned int outputSize = 0;            /* class ids from here on are staged as no class */
+
+    shard* shards = nullptr;                /* all shards in file order */
+    unsigned int numShards = 0;             /* number of shards */
+    unsigned int maxShardCount = 0;         /* most images in one shard */
+    uint64_t maxShardLength = 0;            /* most bytes in one shard */
+    unsigned int numData = 0;               /* images in the whole file */
+    unsigned int height = 0;                /* height of every image */
+    unsigned int width = 0;                 /* width of every image */
+    size_t bytesPerRecord = 0;              /* size of one packed image */
+
+    unsigned int windowShards = 4;          /* shards trained on together */
+    unsigned int seed = 0;                  /* seed for both levels of shuffling */
+    bool shuffle = true;                    /* shuffle at all */
+
+    /* loader thread (only it touches these) */
+    char* readBuffer = nullptr;             /* raw bytes of the shard being loaded */
+    unsigned int* loaderOrder = nullptr;    /* shard order of loaderEpoch */
+    uint64_t loaderEpoch = 0;               /* epoch loaderOrder belongs to */
+    bool loaderOrderValid = false;          /* has loaderOrder been made */
+
+    /* shared between the loader and the consumer */
+    shardSlot* slots = nullptr;             /* 2 * windowShards slots - one window in use, one loading */
+    unsigned int numSlots = 0;              /* number of slots */
+    uint64_t nextToLoad = 0;                /* next sequence number the loader takes */
+    bool stopping = false;                  /* tells the loader to quit */
+    bool running = false;                   /* is the loader thread alive */
+    bool readFailed = false;                /* the loader could not read a shard */
+    uint64_t failedOffset = 0;              /* first byte of that shard */
+    pthread_t thread;                       /* the loader */
+    pthread_mutex_t lock;                   /* protects the slots */
+    pthread_cond_t slotEmptied;             /* signaled when the consumer frees slots */
+    pthread_cond_t slotFilled;              /* signaled when the loader finishes a slot */
+
+    /* consumer */
+    uint64_t nextToConsume = 0;             /* next sequence number to add to a window */
+    unsigned int* window = nullptr;         /* slots of the current window */
+    unsigned int windowCount = 0;           /* number of slots in the current window */
+    uint64_t* windowOrder = nullptr;        /* (slot, image) pairs of the window in shuffled order */
+    unsigned int windowSize = 0;            /* number of images in the window */
+    unsigned int windowPosition = 0;        /* next entry of windowOrder */
+    unsigned int consumedInEpoch = 0;       /* images handed out since beginEpoch */
+    default_random_engine windowEngine;     /* shuffles windows */
+    unsigned int capacity = 0;              /* samples the staging arena holds */
+    double* inputArena = nullptr;           /* staged inputs */
+
+    void startLoader(const uint64_t& sequence);
+    void stopLoader();
+    static void* loaderMain(void* args);
+    void loaderLoop();
+    unsigned int shardForSequence(const uint64_t& sequence);
+    bool loadShard(const shard& s, shardSlot& slot);
+    void nextWindow();
+
+public:
+    ShardedDataSource(const string& path, LabelDictionary& classes, const uint64_t& shardBytes, const unsigned int& windowShards, const unsigned int& seed, const bool& shuffle);
+    ShardedDataSource(const ShardedDataSource& copy) = delete;
+    void operator=(const ShardedDataSource& copy) = delete;
+    ~ShardedDataSource();
+
+    /* false if the file could not be read or holds no images */
+    bool isOpen() const { return numData > 0; }
+
+    /* accessors */
+    unsigned int getHeight() const { return height; }
+    unsigned int getWidth() const { return width; }
+    unsigned int getNumShards() const { return numShards; }
+
+    /* label size - defaults to the number of classes seen when the file was opened */
+    void setOutputSize(const unsigned int& size) { outputSize = size; }
+    unsigned int getOutputSize() const { return outputSize; }
+
+    /* fcnnDataSource */
+    unsigned int getNumData() const { return numData; }
+    bool allowsShuffle() const { return false; }
+    void beginEpoch();
+    void stageSamples(const unsigned int samples[], const unsigned int& count, double** inputs, uint32_t labels[]);
+};
+
+/**************************************************************
+* ShardedDataSource constructor
+***************************************************************
+* Indexes the file and starts loading the first window
+**************************************************************/
+inline ShardedDataSource::ShardedDataSource(const string& path, LabelDictionary& classes, const uint64_t& shardBytes, const unsigned int& windowShards, const unsigned int& seed, const bool& shuffle)
+    : path(path), classes(&classes), windowShards((windowShards > 0) ? windowShards : 1), seed(seed), shuffle(shuffle) {
+
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&slotEmptied, NULL);
+    pthread_cond_init(&slotFilled, NULL);
+    windowEngine.seed(seed);
+
+    /* find the shards */
+    MappedFile map;
+    if (!map.open(path) || !file.open(path)) {
+        cout << "ERROR: Could not open data file " << path << endl;
+        return;
+    }
+    const char* begin = map.data();
+    const char* end = begin + map.size();
+    Array<shard> found;
+    shard current;
+    CsvRecord record;
+    const char* lineEnd = nullptr;
+    const char* next = nullptr;
+    for (const char* p = begin; p < end; p = next) {
+        findLine(p, end, lineEnd, next);
+        if (lineEnd > p && parseCsvLine(p, lineEnd, record)) {
+            if (bytesPerRecord == 0) {
+                height = record.height;
+                width = record.width;
+                bytesPerRecord = (((size_t)height * width) + 7) / 8;
+            }
+            if (record.height == height && record.width == width) {
+                classes.intern(record.name, record.nameLength);
+                current.count += 1;
+            }
+        }
+        current.length = (uint64_t)(next - begin) - current.offset;
+        if (current.length >= shardBytes || next == end) {
+            if (current.count > 0) {
+                found.add(current);
+            }
+            current = shard();
+            current.offset = (uint64_t)(next - begin);
+        }
+    }
+    map.close();
+
+    numShards = (unsigned int)found.getSize();
+    shards = new shard[(numShards > 0) ? numShards : 1];
+    for (unsigned int i = 0; i < numShards; i++) {
+        shards[i] = found[i];
+        numData += shards[i].count;
+        if (shards[i].count > maxShardCount) { maxShardCount = shards[i].count; }
+        if (shards[i].length > maxShardLength) { maxShardLength = shards[i].length; }
+    }
+    outputSize = classes.getSize();
+    if (numData == 0) {
+        return;
+    }
+
+    /* two windows of slots - one being trained on and one being loaded */
+    numSlots = 2 * this->windowShards;
+    slots = new shardSlot[numSlots];
+    for (unsigned int i = 0; i < numSlots; i++) {
+        slots[i].packed = new unsigned char[(size_t)maxShardCount * bytesPerRecord];
+        slots[i].labels = new unsigned int[maxShardCount];
+    }
+    window = new unsigned int[this->windowShards];
+    windowOrder = new uint64_t[(size_t)this->windowShards * maxShardCount];
+    readBuffer = new char[maxShardLength];
+    loaderOrder = new unsigned int[numShards];
+
+    cout << "Indexed " << path << ": " << numData << " patterns of " << height << "x" << width << " in " << numShards << " shards" << endl;
+    startLoader(0);
+}
+
+/* destructor */
+inline ShardedDataSource::~ShardedDataSource() {
+    stopLoader();
+    for (unsigned int i = 0; i < numSlots; i++) {
+        delete[] slots[i].packed;
+        delete[] slots[i].labels;
+    }
+    delete[] slots;
+    delete[] shards;
+    delete[] window;
+    delete[] windowOrder;
+    delete[] readBuffer;
+    delete[] loaderOrder;
+    delete[] inputArena;
+    pthread_mutex_destroy(&lock);
+    pthread_cond_destroy(&slotEmptied);
+    pthread_cond_destroy(&slotFilled);
+}
+
+/******************************************************************************
+ * startLoader
+-------------------------------------------------------------------------------
+ * Empties every slot and starts the loader at the given sequence number
+*******************************************************************************/
+inline void ShardedDataSource::startLoader(const uint64_t& sequence) {
+    for (unsigned int i = 0; i < numSlots; i++) {
+        slots[i].state = EMPTY;
+    }
+    windowCount = 0;
+    windowSize = 0;
+    windowPosition = 0;
+    nextToLoad = sequence;
+    nextToConsume = sequence;
+    stopping = false;
+    running = (pthread_create(&thread, NULL, loaderMain, (void*)this) == 0);
+}
+
+/* stops the loader thread (the shard it is reading is finished first) */
+inline void ShardedDataSource::stopLoader() {
+    if (!running) {
+        return;
+    }
+    pthread_mutex_lock(&lock);
+    stopping = true;
+    pthread_cond_broadcast(&slotEmptied);
+    pthread_mutex_unlock(&lock);
+    pthread_join(thread, NULL);
+    running = false;
+}
+
+/* thread entry point */
+inline void* ShardedDataSource::loaderMain(void* args) {
+    ((ShardedDataSource*)args)->loaderLoop();
+    return nullptr;
+}
+
+/******************************************************************************
+ * shardForSequence
+-------------------------------------------------------------------------------
+ * Sequence numbers run through every shard of epoch 0, then every shard of
+ * epoch 1, ... Each epoch has its own shard order made from the seed.
+*******************************************************************************/
+inline unsigned int ShardedDataSource::shardForSequence(const uint64_t& sequence) {
+    uint64_t epoch = sequence / numShards;
+    if (!loaderOrderValid || epoch != loaderEpoch) {
+        for (unsigned int i = 0; i < numShards; i++) {
+            loaderOrder[i] = i;
+        }
+        if (shuffle) {
+            seed_seq epochSeed{ seed, (unsigned int)epoch, (unsigned int)(epoch >> 32) };
+            default_random_engine engine(epochSeed);
+            for (unsigned int i = numShards; i > 1; i--) {
+                unsigned int j = uniform_int_distribution<unsigned int>(0, i - 1)(engine);
+                unsigned int temp = loaderOrder[i - 1];
+                loaderOrder[i - 1] = loaderOrder[j];
+                loaderOrder[j] = temp;
+            }
+        }
+        loaderEpoch = epoch;
+        loaderOrderValid = true;
+    }
+    return loaderOrder[sequence % numShards];
+}
+
+/******************************************************************************
+ * loaderLoop
+-------------------------------------------------------------------------------
+ * Loads shards into empty slots in sequence order until stopped
+*******************************************************************************/
+inline void ShardedDataSource::loaderLoop() {
+    while (true) {
+        pthread_mutex_lock(&lock);
+        int empty = -1;
+        while (!stopping) {
+            for (unsigned int i = 0; i < numSlots && empty < 0; i++) {
+                if (slots[i].state == EMPTY) { empty = i; }
+            }
+            if (empty >= 0) {
+                break;
+            }
+            pthread_cond_wait(&slotEmptied, &lock);
+        }
+        if (stopping) {
+            pthread_mutex_unlock(&lock);
+            return;
+        }
+        shardSlot& slot = slots[empty];
+        slot.state = LOADING;
+        slot.sequence = nextToLoad;
+        nextToLoad += 1;
+        pthread_mutex_unlock(&lock);
+
+        const shard& s = shards[shardForSequence(slot.sequence)];
+        const shard& after = shards[shardForSequence(slot.sequence + 1)];
+        file.willNeed(after.offset, after.length);
+        bool loaded = loadShard(s, slot);
+        file.dontNeed(s.offset, s.length);
+
+        pthread_mutex_lock(&lock);
+        if (!loaded) {
+            readFailed = true;
+            failedOffset = s.offset;
+        }
+        slot.state = FULL;
+        pthread_cond_broadcast(&slotFilled);
+        pthread_mutex_unlock(&lock);
+    }
+}
+
+/* reads one shard and packs its images into a slot - false if the read failed */
+inline bool ShardedDataSource::loadShard(const shard& s, shardSlot& slot) {
+    slot.count = 0;
+    if (!file.readAt(readBuffer, (size_t)s.length, s.offset)) {
+        return false;
+    }
+    CsvRecord record;
+    const char* end = readBuffer + s.length;
+    const char* lineEnd = nullptr;
+    const char* next = nullptr;
+    for (const char* p = readBuffer; p < end && slot.count < maxShardCount; p = next) {
+        findLine(p, end, lineEnd, next);
+        if (lineEnd == p || !parseCsvLine(p, lineEnd, record) || record.height != height || record.width != width) {
+            continue;
+        }
+        packPixels(record.pixels, (size_t)height * width, slot.packed + ((size_t)slot.count * bytesPerRecord));
+        slot.labels[slot.count] = classes->find(record.name, record.nameLength);
+        slot.count += 1;
+    }
+    return true;
+}
+
+/******************************************************************************
+ * nextWindow
+-------------------------------------------------------------------------------
+ * Frees the current window and makes the next one out of the next loaded
+ * shards. A window never reaches into the next epoch. Stops the program if
+ * the loader could not read a shard.
+*******************************************************************************/
+inline void ShardedDataSource::nextWindow() {
+    pthread_mutex_lock(&lock);
+    for (unsigned int i = 0; i < windowCount; i++) {
+        slots[window[i]].state = EMPTY;
+    }
+    pthread_cond_broadcast(&slotEmptied);
+
+    unsigned int leftInEpoch = numShards - (unsigned int)(nextToConsume % numShards);
+    windowCount = (leftInEpoch < windowShards) ? leftInEpoch : windowShards;
+    for (unsigned int i = 0; i < windowCount; i++) {
+        int found = -1;
+        while (found < 0) {
+            for (unsigned int j = 0; j < numSlots && found < 0; j++) {
+                if (slots[j].state == FULL && slots[j].sequence == nextToConsume) { found = j; }
+            }
+            if (found < 0) {
+                pthread_cond_wait(&slotFilled, &lock);
+            }
+        }
+        if (readFailed) {
+            pthread_mutex_unlock(&lock);
+            cout << "ERROR: Could not read " << path << " at byte " << failedOffset << endl;
+            exit(1);
+        }
+        slots[found].state = IN_USE;
+        window[i] = found;
+        nextToConsume += 1;
+    }
+    pthread_mutex_unlock(&lock);
+
+    /* shuffle across the whole window */
+    windowSize = 0;
+    for (unsigned int i = 0; i < windowCount; i++) {
+        for (unsigned int j = 0; j < slots[window[i]].count; j++) {
+            windowOrder[windowSize] = ((uint64_t)window[i] << 32) | j;
+            windowSize += 1;
+        }
+    }
+    if (shuffle) {
+        for (unsigned int i = windowSize; i > 1; i--) {
+            unsigned int j = uniform_int_distribution<unsigned int>(0, i - 1)(windowEngine);
+            uint64_t temp = windowOrder[i - 1];
+            windowOrder[i - 1] = windowOrder[j];
+            windowOrder[j] = temp;
+        }
+    }
+    windowPosition = 0;
+}
+
+/******************************************************************************
+ * beginEpoch
+-------------------------------------------------------------------------------
+ * Epochs normally run straight on from one another and the loader is already
+ * working on the next one. If the last epoch was cut short, everything left
+ * of it is thrown away and loading restarts at the next epoch.
+*******************************************************************************/
+inline void ShardedDataSource::beginEpoch() {
+    if (numData == 0 || consumedInEpoch == 0 || consumedInEpoch == numData) {
+        consumedInEpoch = 0;
+        return;
+    }
+    uint64_t epoch = (nextToConsume - 1) / numShards;
+    stopLoader();
+    startLoader((epoch + 1) * numShards);
+    consumedInEpoch = 0;
+}
+
+/******************************************************************************
+ * stageSamples
+-------------------------------------------------------------------------------
+ * Hands out the next count images of the window - samples is ignored, the
+ * order comes from the shard and window shuffles
+*******************************************************************************/
+inline void ShardedDataSource::stageSamples(const unsigned int /* samples */[], const unsigned int& count, double** inputs, uint32_t labels[]) {
+    size_t inputSize = (size_t)height * width;
+    if (count > capacity) {
+        delete[] inputArena;
+        inputArena = new double[count * inputSize];
+        capacity = count;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        unsigned int emptyWindows = 0;
+        while (windowPosition >= windowSize) {
+            /* a whole epoch without an image means the file changed since it was indexed */
+            if (emptyWindows > numShards) {
+                cout << "ERROR: No patterns left in " << path << endl;
+                exit(1);
+            }
+            nextWindow();
+            emptyWindows += 1;
+        }
+        uint64_t entry = windowOrder[windowPosition];
+        windowPosition += 1;
+        consumedInEpoch += 1;
+        const shardSlot& slot = slots[entry >> 32];
+        unsigned int image = (unsigned int)(entry & 0xFFFFFFFF);
+
+        inputs[i] = inputArena + (i * inputSize);
+        unpackPixels(slot.packed + ((size_t)image * bytesPerRecord), inputSize, inputs[i]);
+        labels[i] = (slot.labels[image] < outputSize) ? slot.labels[image] : 0xFFFFFFFF;
+    }
+}
+/************************************************************
+* ///////////////////////////|\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\
+* \\\\\\\\\\\\\\\\\\\\\\\\\\\|///////////////////////////////
+************************************************************/
@@ -0,0 +1,978 @@
+#pragma once
+
+/* Headers */
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#endif
+
+using namespace std;
+
+/* Instruction sets the kernels come in - higher is wider */
+enum simdLevel { SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2, SIMD_AVX512 };
+
+/* Constants of one Adam step, the same for every weight - see SimdKernels::adamStep */
+template<typename T>
+struct adamConstants {
+    T beta1;            /* decay of the gradient average m */
+    T beta2;            /* decay of the squared gradient average v */
+    T stepSize;         /* learning rate / (1 - beta1^t) - the bias correction of m folded in */
+    T correction2;      /* 1 / (1 - beta2^t) - the bias correction of v */
+    T epsilon;          /* added to the root of v */
+    T keep;             /* weights are scaled by it first - 1 - learning rate * weight decay for AdamW, 1 for Adam */
+};
+
+/************************************************************
+#############################################################
+#   SIMD Kernels Class
+#############################################################
+#
+#   The vector loops the network spends its time in, with a
+#   variant for each instruction set, in double and float.
+#   The best variant the CPU (and OS) supports is found with
+#   CPUID at startup and the kernels are called through
+#   function pointers, so one binary runs well everywhere
+#   without -march flags.
+#
+#   Wider variants sum in a different order than the scalar
+#   loop, so results can differ in the last bits between
+#   machines. use(SIMD_SCALAR) gives the plain loops back.
+************************************************************/
+class SimdKernels {
+public:
+    /* sum of a[i] * b[i] */
+    static double dot(const double* a, const double* b, const size_t& n) { return dot64(a, b, n); }
+    static float dot(const float* a, const float* b, const size_t& n) { return dot32(a, b, n); }
+
+    /* y[i] += alpha * x[i] */
+    static void axpy(const double& alpha, const double* x, double* y, const size_t& n) { axpy64(alpha, x, y, n); }
+    static void axpy(const float& alpha, const float* x, float* y, const size_t& n) { axpy32(alpha, x, y, n); }
+
+    /* out[i] = y[i] + alpha * x[i] - out can be y */
+    static void axpyInto(const double& alpha, const double* x, const double* y, double* out, const size_t& n) { axpyInto64(alpha, x, y, out, n); }
+    static void axpyInto(const float& alpha, const float* x, const float* y, float* out, const size_t& n) { axpyInto32(alpha, x, y, out, n); }
+
+    /* y[i] = max(s[i], 0) + slope * min(s[i], 0) - relu (slope 0) and leaky relu */
+    static void rectify(const double* s, double* y, const size_t& n, const double& slope) { rectify64(s, y, n, slope); }
+    static void rectify(const float* s, float* y, const size_t& n, const float& slope) { rectify32(s, y, n, slope); }
+
+    /* out[i] = exp(x[i]) - out can be x. The vector variants are within a few ulp of exp, x is clamped to where exp is finite */
+    static void exponential(const double* x, double* out, const size_t& n) { exponential64(x, out, n); }
+    static void exponential(const float* x, float* out, const size_t& n) { exponential32(x, out, n); }
+
+    /* out[i] = 1 / (1 + exp(-x[i])) - the sigmoid, and tanh(x) = 2 logistic(2x) - 1. out can be x */
+    static void logistic(const double* x, double* out, const size_t& n) { logistic64(x, out, n); }
+    static void logistic(const float* x, float* out, const size_t& n) { logistic32(x, out, n); }
+
+    /* v[i] = momentum * v[i] + g[i], then w[i] -= vScale * v[i] + gScale * g[i] - one pass of SGD with momentum (vScale the
+    *  learning rate, gScale 0) or Nesterov momentum (vScale the learning rate times momentum, gScale the learning rate) */
+    static void momentumStep(double* w, const double* g, double* v, const size_t& n, const double& momentum, const double& vScale, const double& gScale) { momentumStep64(w, g, v, n, momentum, vScale, gScale); }
+    static void momentumStep(float* w, const float* g, float* v, const size_t& n, const float& momentum, const float& vScale, const float& gScale) { momentumStep32(w, g, v, n, momentum, vScale, gScale); }
+
+    /* m[i] = beta1 * m[i] + (1 - beta1) * g[i], v[i] = beta2 * v[i] + (1 - beta2) * g[i]^2, then
+    *  w[i] = keep * w[i] - stepSize * m[i] / (sqrt(correction2 * v[i]) + epsilon) - one pass of Adam or AdamW */
+    static void adamStep(double* w, const double* g, double* m, double* v, const size_t& n, const adamConstants<double>& c) { adamStep64(w, g, m, v, n, c); }
+    static void adamStep(float* w, const float* g, float* m, float* v, const size_t& n, const adamConstants<float>& c) { adamStep32(w, g, m, v, n, c); }
+
+    /* bit i of dst (bit i % 8 of byte i / 8) is set if src[i] is '1' - the '0'/'1' pixels of a data.csv line. dst holds
+    *  (n + 7) / 8 bytes. Bytes are compared a register at a time and the compare mask is the packed bits */
+    static void packOnes(const char* src, unsigned char* dst, const size_t& n) { packOnes8(src, dst, n); }
+
+    /* best level this machine supports */
+    static simdLevel detect();
+
+    /* switch every kernel to level (or the best supported below it) - returns the level in use */
+    static simdLevel use(const simdLevel& level);
+
+    static simdLevel getLevel() { return level; }
+    static const char* getLevelName(const simdLevel& level) {
+        switch (level) {
+            case(SIMD_SSE2): { return "SSE2"; }
+            case(SIMD_AVX2): { return "AVX2"; }
+            case(SIMD_AVX512): { return "AVX-512"; }
+            default: { return "scalar"; }
+        }
+    }
+
+private:
+    static simdLevel level;     /* level in use */
+
+    /* kernels in use */
+    static double (*dot64)(const double* a, const double* b, const size_t& n);
+    static float (*dot32)(const float* a, const float* b, const size_t& n);
+    static void (*axpy64)(const double& alpha, const double* x, double* y, const size_t& n);
+    static void (*axpy32)(const float& alpha, const float* x, float* y, const size_t& n);
+    static void (*axpyInto64)(const double& alpha, const double* x, const double* y, double* out, const size_t& n);
+    static void (*axpyInto32)(const float& alpha, const float* x, const float* y, float* out, const size_t& n);
+    static void (*rectify64)(const double* s, double* y, const size_t& n, const double& slope);
+    static void (*rectify32)(const float* s, float* y, const size_t& n, const float& slope);
+    static void (*exponential64)(const double* x, double* out, const size_t& n);
+    static void (*exponential32)(const float* x, float* out, const size_t& n);
+    static void (*logistic64)(const double* x, double* out, const size_t& n);
+    static void (*logistic32)(const float* x, float* out, const size_t& n);
+    static void (*momentumStep64)(double* w, const double* g, double* v, const size_t& n, const double& momentum, const double& vScale, const double& gScale);
+    static void (*momentumStep32)(float* w, const float* g, float* v, const size_t& n, const float& momentum, const float& vScale, const float& gScale);
+    static void (*adamStep64)(double* w, const double* g, double* m, double* v, const size_t& n, const adamConstants<double>& c);
+    static void (*adamStep32)(float* w, const float* g, float* m, float* v, const size_t& n, const adamConstants<float>& c);
+    static void (*packOnes8)(const char* src, unsigned char* dst, const size_t& n);
+
+    /* exp of the vector variants - x = k ln2 + r with |r| <= ln2 / 2 (ln2 split in two so k ln2 is exact), exp(r) from its
+    *  Taylor series (the first term dropped is below an ulp) and 2^k put straight into the exponent bits */
+    static constexpr double EXP_MIN_64 = -708.0;        /* 2^k stays a normal double */
+    static constexpr double EXP_MAX_64 = 709.0;
+    static constexpr float EXP_MIN_32 = -87.0f;
+    static constexpr float EXP_MAX_32 = 88.0f;
+    static constexpr double EXP_LOG2E = 1.4426950408889634;
+    static constexpr double EXP_LN2_HI = 6.93145751953125e-1;
+    static constexpr double EXP_LN2_LO = 1.42860682030941723212e-6;
+    static constexpr double EXP_ROUND_64 = 6755399441055744.0;     /* 1.5 * 2^52 - adding and taking it off rounds to an integer */
+    static constexpr double EXP_BIAS_64 = 4503599627371519.0;      /* 2^52 + 1023 - leaves k + 1023 in the low bits */
+    static constexpr float EXP_ROUND_32 = 12582912.0f;             /* 1.5 * 2^23 */
+    static constexpr float EXP_BIAS_32 = 8388735.0f;               /* 2^23 + 127 */
+    static constexpr int EXP_TERMS_64 = 14;                         /* 1/13! ... 1/0! */
+    static constexpr int EXP_TERMS_32 = 9;                          /* 1/8! ... 1/0! */
+    static constexpr double EXP_TAYLOR_64[EXP_TERMS_64] = { 1.0 / 6227020800.0, 1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0, 1.0 / 362880.0, 1.0 / 40320.0, 1.0 / 5040.0, 1.0 / 720.0, 1.0 / 120.0, 1.0 / 24.0, 1.0 / 6.0, 0.5, 1.0, 1.0 };
+    static constexpr float EXP_TAYLOR_32[EXP_TERMS_32] = { 1.0f / 40320.0f, 1.0f / 5040.0f, 1.0f / 720.0f, 1.0f / 120.0f, 1.0f / 24.0f, 1.0f / 6.0f, 0.5f, 1.0f, 1.0f };
+
+    /*---------------------------------------------*/
+    /** Scalar **/
+    /*---------------------------------------------*/
+    template<typename T>
+    static T dotScalar(const T* a, const T* b, const size_t& n) {
+        T sum = 0;
+        for (size_t i = 0; i < n; i++) {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+    template<typename T>
+    static void axpyScalar(const T& alpha, const T* x, T* y, const size_t& n) {
+        for (size_t i = 0; i < n; i++) {
+            y[i] += alpha * x[i];
+        }
+    }
+    template<typename T>
+    static void axpyIntoScalar(const T& alpha, const T* x, const T* y, T* out, const size_t& n) {
+        for (size_t i = 0; i < n; i++) {
+            out[i] = y[i] + alpha * x[i];
+        }
+    }
+    template<typename T>
+    static void rectifyScalar(const T* s, T* y, const size_t& n, const T& slope) {
+        for (size_t i = 0; i < n; i++) {
+            y[i] = ((s[i] > (T)0) ? s[i] : (T)0) + slope * ((s[i] < (T)0) ? s[i] : (T)0);
+        }
+    }
+    template<typename T>
+    static void exponentialScalar(const T* x, T* out, const size_t& n) {
+        for (size_t i = 0; i < n; i++) {
+            out[i] = std::exp(x[i]);
+        }
+    }
+    template<typename T>
+    static void logisticScalar(const T* x, T* out, const size_t& n) {
+        for (size_t i = 0; i < n; i++) {
+            out[i] = (T)1 / ((T)1 + std::exp(-x[i]));
+        }
+    }
+    template<typename T>
+    static void momentumStepScalar(T* w, const T* g, T* v, const size_t& n, const T& momentum, const T& vScale, const T& gScale) {
+        for (size_t i = 0; i < n; i++) {
+            v[i] = momentum * v[i] + g[i];
+            w[i] -= vScale * v[i] + gScale * g[i];
+        }
+    }
+    template<typename T>
+    static void adamStepScalar(T* w, const T* g, T* m, T* v, const size_t& n, const adamConstants<T>& c) {
+        for (size_t i = 0; i < n; i++) {
+            m[i] = c.beta1 * m[i] + ((T)1 - c.beta1) * g[i];
+            v[i] = c.beta2 * v[i] + ((T)1 - c.beta2) * g[i] * g[i];
+            w[i] = c.keep * w[i] - c.stepSize * m[i] / (std::sqrt(c.correction2 * v[i]) + c.epsilon);
+        }
+    }
+    static void packOnesScalar(const char* src, unsigned char* dst, const size_t& n) {
+        for (size_t b = 0; b < ((n + 7) >> 3); b++) {
+            dst[b] = 0;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (src[i] == '1') {
+                dst[i >> 3] |= (unsigned char)(1 << (i & 7));
+            }
+        }
+    }
+
+#ifdef SIMD_X86
+    /* lane mask of the last n - i (less than a full register) elements */
+    static __mmask8 tailMask8(const size_t& left) { return (left >= 8) ? (__mmask8)0xFF : (__mmask8)((1u << left) - 1); }
+    static __mmask16 tailMask16(const size_t& left) { return (left >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << left) - 1); }
+
+    /*---------------------------------------------*/
+    /** SSE2 - two doubles / four floats per register **/
+    /*---------------------------------------------*/
+    __attribute__((target("sse2"))) static double dotSse2(const double* a, const double* b, const size_t& n) {
+        __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+            acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+        double sum = lanes[0] + lanes[1];
+        for (; i < n; i++) {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+    __attribute__((target("sse2"))) static float dotSse2(const float* a, const float* b, const size_t& n) {
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+        float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        for (; i < n; i++) {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+    __attribute__((target("sse2"))) static void axpySse2(const double& alpha, const double* x, double* y, const size_t& n) {
+        __m128d va = _mm_set1_pd(alpha);
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(va, _mm_loadu_pd(x + i))));
+        }
+        axpyScalar(alpha, x + i, y + i, n - i);
+    }
+    __attribute__((target("sse2"))) static void axpySse2(const float& alpha, const float* x, float* y, const size_t& n) {
+        __m128 va = _mm_set1_ps(alpha);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(va, _mm_loadu_ps(x + i))));
+        }
+        axpyScalar(alpha, x + i, y + i, n - i);
+    }
+    __attribute__((target("sse2"))) static void axpyIntoSse2(const double& alpha, const double* x, const double* y, double* out, const size_t& n) {
+        __m128d va = _mm_set1_pd(alpha);
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(va, _mm_loadu_pd(x + i))));
+        }
+        axpyIntoScalar(alpha, x + i, y + i, out + i, n - i);
+    }
+    __attribute__((target("sse2"))) static void axpyIntoSse2(const float& alpha, const float* x, const float* y, float* out, const size_t& n) {
+        __m128 va = _mm_set1_ps(alpha);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(va, _mm_loadu_ps(x + i))));
+        }
+        axpyIntoScalar(alpha, x + i, y + i, out + i, n - i);
+    }
+    __attribute__((target("sse2"))) static void rectifySse2(const double* s, double* y, const size_t& n, const double& slope) {
+        __m128d zero = _mm_setzero_pd(), vs = _mm_set1_pd(slope);
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            __m128d v = _mm_loadu_pd(s + i);
+            _mm_storeu_pd(y + i, _mm_add_pd(_mm_max_pd(v, zero), _mm_mul_pd(vs, _mm_min_pd(v, zero))));
+        }
+        rectifyScalar(s + i, y + i, n - i, slope);
+    }
+    __attribute__((target("sse2"))) static void rectifySse2(const float* s, float* y, const size_t& n, const float& slope) {
+        __m128 zero = _mm_setzero_ps(), vs = _mm_set1_ps(slope);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m128 v = _mm_loadu_ps(s + i);
+            _mm_storeu_ps(y + i, _mm_add_ps(_mm_max_ps(v, zero), _mm_mul_ps(vs, _mm_min_ps(v, zero))));
+        }
+        rectifyScalar(s + i, y + i, n - i, slope);
+    }
+    __attribute__((target("sse2"))) static __m128d exponentialLanes(__m128d x) {
+        const __m128d round = _mm_set1_pd(EXP_ROUND_64);
+        x = _mm_min_pd(_mm_max_pd(x, _mm_set1_pd(EXP_MIN_64)), _mm_set1_pd(EXP_MAX_64));
+        __m128d k = _mm_sub_pd(_mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(EXP_LOG2E)), round), round);
+        __m128d r = _mm_sub_pd(_mm_sub_pd(x, _mm_mul_pd(k, _mm_set1_pd(EXP_LN2_HI))), _mm_mul_pd(k, _mm_set1_pd(EXP_LN2_LO)));
+        __m128d p = _mm_set1_pd(EXP_TAYLOR_64[0]);
+#pragma GCC unroll 16
+        for (int t = 1; t < EXP_TERMS_64; t++) {
+            p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(EXP_TAYLOR_64[t]));
+        }
+        __m128i scale = _mm_slli_epi64(_mm_castpd_si128(_mm_add_pd(k, _mm_set1_pd(EXP_BIAS_64))), 52);
+        return _mm_mul_pd(p, _mm_castsi128_pd(scale));
+    }
+    __attribute__((target("sse2"))) static __m128 exponentialLanes(__m128 x) {
+        const __m128 round = _mm_set1_ps(EXP_ROUND_32);
+        x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(EXP_MIN_32)), _mm_set1_ps(EXP_MAX_32));
+        __m128 k = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps((float)EXP_LOG2E)), round), round);
+        __m128 r = _mm_sub_ps(_mm_sub_ps(x, _mm_mul_ps(k, _mm_set1_ps((float)EXP_LN2_HI))), _mm_mul_ps(k, _mm_set1_ps((float)EXP_LN2_LO)));
+        __m128 p = _mm_set1_ps(EXP_TAYLOR_32[0]);
+#pragma GCC unroll 16
+        for (int t = 1; t < EXP_TERMS_32; t++) {
+            p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(EXP_TAYLOR_32[t]));
+        }
+        __m128i scale = _mm_slli_epi32(_mm_castps_si128(_mm_add_ps(k, _mm_set1_ps(EXP_BIAS_32))), 23);
+        return _mm_mul_ps(p, _mm_castsi128_ps(scale));
+    }
+    __attribute__((target("sse2"))) static __m128d logisticLanes(__m128d x) {
+        const __m128d one = _mm_set1_pd(1.0);
+        return _mm_div_pd(one, _mm_add_pd(one, exponentialLanes(_mm_sub_pd(_mm_setzero_pd(), x))));
+    }
+    __attribute__((target("sse2"))) static __m128 logisticLanes(__m128 x) {
+        const __m128 one = _mm_set1_ps(1.0f);
+        return _mm_div_ps(one, _mm_add_ps(one, exponentialLanes(_mm_sub_ps(_mm_setzero_ps(), x))));
+    }
+    /* out[i] = LANES(x[i]) - the tail goes through the same lanes (padded on the stack) so a value does not depend on where it sits */
+    template<__m128d (*LANES)(__m128d)>
+    __attribute__((target("sse2"))) static void mapSse2(const double* x, double* out, const size_t& n) {
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            _mm_storeu_pd(out + i, LANES(_mm_loadu_pd(x + i)));
+        }
+        if (i < n) {
+            double tail[2] = { x[i], 0.0 };
+            _mm_storeu_pd(tail, LANES(_mm_loadu_pd(tail)));
+            out[i] = tail[0];
+        }
+    }
+    template<__m128 (*LANES)(__m128)>
+    __attribute__((target("sse2"))) static void mapSse2(const float* x, float* out, const size_t& n) {
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            _mm_storeu_ps(out + i, LANES(_mm_loadu_ps(x + i)));
+        }
+        if (i < n) {
+            float tail[4] = {};
+            for (size_t j = i; j < n; j++) { tail[j - i] = x[j]; }
+            _mm_storeu_ps(tail, LANES(_mm_loadu_ps(tail)));
+            for (size_t j = i; j < n; j++) { out[j] = tail[j - i]; }
+        }
+    }
+    __attribute__((target("sse2"))) static void exponentialSse2(const double* x, double* out, const size_t& n) { mapSse2<exponentialLanes>(x, out, n); }
+    __attribute__((target("sse2"))) static void exponentialSse2(const float* x, float* out, const size_t& n) { mapSse2<exponentialLanes>(x, out, n); }
+    __attribute__((target("sse2"))) static void logisticSse2(const double* x, double* out, const size_t& n) { mapSse2<logisticLanes>(x, out, n); }
+    __attribute__((target("sse2"))) static void logisticSse2(const float* x, float* out, const size_t& n) { mapSse2<logisticLanes>(x, out, n); }
+    __attribute__((target("sse2"))) static void momentumStepSse2(double* w, const double* g, double* v, const size_t& n, const double& momentum, const double& vScale, const double& gScale) {
+        __m128d vm = _mm_set1_pd(momentum), vv = _mm_set1_pd(vScale), vg = _mm_set1_pd(gScale);
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            __m128d gi = _mm_loadu_pd(g + i);
+            __m128d vi = _mm_add_pd(_mm_mul_pd(vm, _mm_loadu_pd(v + i)), gi);
+            _mm_storeu_pd(v + i, vi);
+            _mm_storeu_pd(w + i, _mm_sub_pd(_mm_loadu_pd(w + i), _mm_add_pd(_mm_mul_pd(vv, vi), _mm_mul_pd(vg, gi))));
+        }
+        momentumStepScalar(w + i, g + i, v + i, n - i, momentum, vScale, gScale);
+    }
+    __attribute__((target("sse2"))) static void momentumStepSse2(float* w, const float* g, float* v, const size_t& n, const float& momentum, const float& vScale, const float& gScale) {
+        __m128 vm = _mm_set1_ps(momentum), vv = _mm_set1_ps(vScale), vg = _mm_set1_ps(gScale);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m128 gi = _mm_loadu_ps(g + i);
+            __m128 vi = _mm_add_ps(_mm_mul_ps(vm, _mm_loadu_ps(v + i)), gi);
+            _mm_storeu_ps(v + i, vi);
+            _mm_storeu_ps(w + i, _mm_sub_ps(_mm_loadu_ps(w + i), _mm_add_ps(_mm_mul_ps(vv, vi), _mm_mul_ps(vg, gi))));
+        }
+        momentumStepScalar(w + i, g + i, v + i, n - i, momentum, vScale, gScale);
+    }
+    __attribute__((target("sse2"))) static void adamStepSse2(double* w, const double* g, double* m, double* v, const size_t& n, const adamConstants<double>& c) {
+        __m128d b1 = _mm_set1_pd(c.beta1), a1 = _mm_set1_pd(1.0 - c.beta1), b2 = _mm_set1_pd(c.beta2), a2 = _mm_set1_pd(1.0 - c.beta2);
+        __m128d step = _mm_set1_pd(c.stepSize), c2 = _mm_set1_pd(c.correction2), eps = _mm_set1_pd(c.epsilon), keep = _mm_set1_pd(c.keep);
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            __m128d gi = _mm_loadu_pd(g + i);
+            __m128d mi = _mm_add_pd(_mm_mul_pd(b1, _mm_loadu_pd(m + i)), _mm_mul_pd(a1, gi));
+            __m128d vi = _mm_add_pd(_mm_mul_pd(b2, _mm_loadu_pd(v + i)), _mm_mul_pd(a2, _mm_mul_pd(gi, gi)));
+            _mm_storeu_pd(m + i, mi);
+            _mm_storeu_pd(v + i, vi);
+            __m128d den = _mm_add_pd(_mm_sqrt_pd(_mm_mul_pd(c2, vi)), eps);
+            _mm_storeu_pd(w + i, _mm_sub_pd(_mm_mul_pd(keep, _mm_loadu_pd(w + i)), _mm_div_pd(_mm_mul_pd(step, mi), den)));
+        }
+        adamStepScalar(w + i, g + i, m + i, v + i, n - i, c);
+    }
+    __attribute__((target("sse2"))) static void adamStepSse2(float* w, const float* g, float* m, float* v, const size_t& n, const adamConstants<float>& c) {
+        __m128 b1 = _mm_set1_ps(c.beta1), a1 = _mm_set1_ps(1.0f - c.beta1), b2 = _mm_set1_ps(c.beta2), a2 = _mm_set1_ps(1.0f - c.beta2);
+        __m128 step = _mm_set1_ps(c.stepSize), c2 = _mm_set1_ps(c.correction2), eps = _mm_set1_ps(c.epsilon), keep = _mm_set1_ps(c.keep);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m128 gi = _mm_loadu_ps(g + i);
+            __m128 mi = _mm_add_ps(_mm_mul_ps(b1, _mm_loadu_ps(m + i)), _mm_mul_ps(a1, gi));
+            __m128 vi = _mm_add_ps(_mm_mul_ps(b2, _mm_loadu_ps(v + i)), _mm_mul_ps(a2, _mm_mul_ps(gi, gi)));
+            _mm_storeu_ps(m + i, mi);
+            _mm_storeu_ps(v + i, vi);
+            __m128 den = _mm_add_ps(_mm_sqrt_ps(_mm_mul_ps(c2, vi)), eps);
+            _mm_storeu_ps(w + i, _mm_sub_ps(_mm_mul_ps(keep, _mm_loadu_ps(w + i)), _mm_div_ps(_mm_mul_ps(step, mi), den)));
+        }
+        adamStepScalar(w + i, g + i, m + i, v + i, n - i, c);
+    }
+
+    __attribute__((target("sse2"))) static void packOnesSse2(const char* src, unsigned char* dst, const size_t& n) {
+        const __m128i one = _mm_set1_epi8('1');
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            uint16_t bits = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(src + i)), one));
+            memcpy(dst + (i >> 3), &bits, 2);
+        }
+        packOnesScalar(src + i, dst + (i >> 3), n - i);
+    }
+
+    /*---------------------------------------------*/
+    /** AVX2 + FMA - four doubles / eight floats per register **/
+    /*---------------------------------------------*/
+    __attribute__((target("avx2,fma"))) static double dotAvx2(const double* a, const double* b, const size_t& n) {
+        __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+        __m256d acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), acc0);
+            acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), acc1);
+            acc2 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 8), _mm256_loadu_pd(b + i + 8), acc2);
+            acc3 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 12), _mm256_loadu_pd(b + i + 12), acc3);
+        }
+        for (; i + 4 <= n; i += 4) {
+            acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), acc0);
+        }
+        __m256d acc = _mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3));
+        __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+        double sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+        for (; i < n; i++) {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+    __attribute__((target("avx2,fma"))) static float dotAvx2(const float* a, const float* b, const size_t& n) {
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+            acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+            acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+        }
+        for (; i + 8 <= n; i += 8) {
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        }
+        __m256 acc = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+        __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+        float sum = _mm_cvtss_f32(_mm_add_ss(half, _mm_shuffle_ps(half, half, 1)));
+        for (; i < n; i++) {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+    __attribute__((target("avx2,fma"))) static void axpyAvx2(const double& alpha, const double* x, double* y, const size_t& n) {
+        __m256d va = _mm256_set1_pd(alpha);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            _mm256_storeu_pd(y + i, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+        }
+        axpyScalar(alpha, x + i, y + i, n - i);
+    }
+    __attribute__((target("avx2,fma"))) static void axpyAvx2(const float& alpha, const float* x, float* y, const size_t& n) {
+        __m256 va = _mm256_set1_ps(alpha);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+        }
+        axpyScalar(alpha, x + i, y + i, n - i);
+    }
+    __attribute__((target("avx2,fma"))) static void axpyIntoAvx2(const double& alpha, const double* x, const double* y, double* out, const size_t& n) {
+        __m256d va = _mm256_set1_pd(alpha);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            _mm256_storeu_pd(out + i, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+        }
+        axpyIntoScalar(alpha, x + i, y + i, out + i, n - i);
+    }
+    __attribute__((target("avx2,fma"))) static void axpyIntoAvx2(const float& alpha, const float* x, const float* y, float* out, const size_t& n) {
+        __m256 va = _mm256_set1_ps(alpha);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            _mm256_storeu_ps(out + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+        }
+        axpyIntoScalar(alpha, x + i, y + i, out + i, n - i);
+    }
+    __attribute__((target("avx2,fma"))) static void rectifyAvx2(const double* s, double* y, const size_t& n, const double& slope) {
+        __m256d zero = _mm256_setzero_pd(), vs = _mm256_set1_pd(slope);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256d v = _mm256_loadu_pd(s + i);
+            _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_max_pd(v, zero), _mm256_mul_pd(vs, _mm256_min_pd(v, zero))));
+        }
+        rectifyScalar(s + i, y + i, n - i, slope);
+    }
+    __attribute__((target("avx2,fma"))) static void rectifyAvx2(const float* s, float* y, const size_t& n, const float& slope) {
+        __m256 zero = _mm256_setzero_ps(), vs = _mm256_set1_ps(slope);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256 v = _mm256_loadu_ps(s + i);
+            _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_max_ps(v, zero), _mm256_mul_ps(vs, _mm256_min_ps(v, zero))));
+        }
+        rectifyScalar(s + i, y + i, n - i, slope);
+    }
+    __attribute__((target("avx2,fma"))) static __m256d exponentialLanes(__m256d x) {
+        const __m256d round = _mm256_set1_pd(EXP_ROUND_64);
+        x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(EXP_MIN_64)), _mm256_set1_pd(EXP_MAX_64));
+        __m256d k = _mm256_sub_pd(_mm256_fmadd_pd(x, _mm256_set1_pd(EXP_LOG2E), round), round);
+        __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(EXP_LN2_LO), _mm256_fnmadd_pd(k, _mm256_set1_pd(EXP_LN2_HI), x));
+        __m256d p = _mm256_set1_pd(EXP_TAYLOR_64[0]);
+#pragma GCC unroll 16
+        for (int t = 1; t < EXP_TERMS_64; t++) {
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(EXP_TAYLOR_64[t]));
+        }
+        __m256i scale = _mm256_slli_epi64(_mm256_castpd_si256(_mm256_add_pd(k, _mm256_set1_pd(EXP_BIAS_64))), 52);
+        return _mm256_mul_pd(p, _mm256_castsi256_pd(scale));
+    }
+    __attribute__((target("avx2,fma"))) static __m256 exponentialLanes(__m256 x) {
+        const __m256 round = _mm256_set1_ps(EXP_ROUND_32);
+        x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXP_MIN_32)), _mm256_set1_ps(EXP_MAX_32));
+        __m256 k = _mm256_sub_ps(_mm256_fmadd_ps(x, _mm256_set1_ps((float)EXP_LOG2E), round), round);
+        __m256 r = _mm256_fnmadd_ps(k, _mm256_set1_ps((float)EXP_LN2_LO), _mm256_fnmadd_ps(k, _mm256_set1_ps((float)EXP_LN2_HI), x));
+        __m256 p = _mm256_set1_ps(EXP_TAYLOR_32[0]);
+#pragma GCC unroll 16
+        for (int t = 1; t < EXP_TERMS_32; t++) {
+            p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_TAYLOR_32[t]));
+        }
+        __m256i scale = _mm256_slli_epi32(_mm256_castps_si256(_mm256_add_ps(k, _mm256_set1_ps(EXP_BIAS_32))), 23);
+        return _mm256_mul_ps(p, _mm256_castsi256_ps(scale));
+    }
+    __attribute__((target("avx2,fma"))) static __m256d logisticLanes(__m256d x) {
+        const __m256d one = _mm256_set1_pd(1.0);
+        return _mm256_div_pd(one, _mm256_add_pd(one, exponentialLanes(_mm256_sub_pd(_mm256_setzero_pd(), x))));
+    }
+    __attribute__((target("avx2,fma"))) static __m256 logisticLanes(__m256 x) {
+        const __m256 one = _mm256_set1_ps(1.0f);
+        return _mm256_div_ps(one, _mm256_add_ps(one, exponentialLanes(_mm256_sub_ps(_mm256_setzero_ps(), x))));
+    }
+    /* two registers a pass so the long polynomial chains overlap */
+    template<__m256d (*LANES)(__m256d)>
+    __attribute__((target("avx2,fma"))) static void mapAvx2(const double* x, double* out, const size_t& n) {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256d a = LANES(_mm256_loadu_pd(x + i));
+            __m256d b = LANES(_mm256_loadu_pd(x + i + 4));
+            _mm256_storeu_pd(out + i, a);
+            _mm256_storeu_pd(out + i + 4, b);
+        }
+        for (; i + 4 <= n; i += 4) {
+            _mm256_storeu_pd(out + i, LANES(_mm256_loadu_pd(x + i)));
+        }
+        if (i < n) {
+            double tail[4] = {};
+            for (size_t j = i; j < n; j++) { tail[j - i] = x[j]; }
+            _mm256_storeu_pd(tail, LANES(_mm256_loadu_pd(tail)));
+            for (size_t j = i; j < n; j++) { out[j] = tail[j - i]; }
+        }
+    }
+    template<__m256 (*LANES)(__m256)>
+    __attribute__((target("avx2,fma"))) static void mapAvx2(const float* x, float* out, const size_t& n) {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m256 a = LANES(_mm256_loadu_ps(x + i));
+            __m256 b = LANES(_mm256_loadu_ps(x + i + 8));
+            _mm256_storeu_ps(out + i, a);
+            _mm256_storeu_ps(out + i + 8, b);
+        }
+        for (; i + 8 <= n; i += 8) {
+            _mm256_storeu_ps(out + i, LANES(_mm256_loadu_ps(x + i)));
+        }
+        if (i < n) {
+            float tail[8] = {};
+            for (size_t j = i; j < n; j++) { tail[j - i] = x[j]; }
+            _mm256_storeu_ps(tail, LANES(_mm256_loadu_ps(tail)));
+            for (size_t j = i; j < n; j++) { out[j] = tail[j - i]; }
+        }
+    }
+    __attribute__((target("avx2,fma"))) static void exponentialAvx2(const double* x, double* out, const size_t& n) { mapAvx2<exponentialLanes>(x, out, n); }
+    __attribute__((target("avx2,fma"))) static void exponentialAvx2(const float* x, float* out, const size_t& n) { mapAvx2<exponentialLanes>(x, out, n); }
+    __attribute__((target("avx2,fma"))) static void logisticAvx2(const double* x, double* out, const size_t& n) { mapAvx2<logisticLanes>(x, out, n); }
+    __attribute__((target("avx2,fma"))) static void logisticAvx2(const float* x, float* out, const size_t& n) { mapAvx2<logisticLanes>(x, out, n); }
+    __attribute__((target("avx2,fma"))) static void momentumStepAvx2(double* w, const double* g, double* v, const size_t& n, const double& momentum, const double& vScale, const double& gScale) {
+        __m256d vm = _mm256_set1_pd(momentum), vv = _mm256_set1_pd(vScale), vg = _mm256_set1_pd(gScale);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256d gi = _mm256_loadu_pd(g + i);
+            __m256d vi = _mm256_fmadd_pd(vm, _mm256_loadu_pd(v + i), gi);
+            _mm256_storeu_pd(v + i, vi);
+            _mm256_storeu_pd(w + i, _mm256_sub_pd(_mm256_loadu_pd(w + i), _mm256_fmadd_pd(vv, vi, _mm256_mul_pd(vg, gi))));
+        }
+        momentumStepScalar(w + i, g + i, v + i, n - i, momentum, vScale, gScale);
+    }
+    __attribute__((target("avx2,fma"))) static void momentumStepAvx2(float* w, const float* g, float* v, const size_t& n, const float& momentum, const float& vScale, const float& gScale) {
+        __m256 vm = _mm256_set1_ps(momentum), vv = _mm256_set1_ps(vScale), vg = _mm256_set1_ps(gScale);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256 gi = _mm256_loadu_ps(g + i);
+            __m256 vi = _mm256_fmadd_ps(vm, _mm256_loadu_ps(v + i), gi);
+            _mm256_storeu_ps(v + i, vi);
+            _mm256_storeu_ps(w + i, _mm256_sub_ps(_mm256_loadu_ps(w + i), _mm256_fmadd_ps(vv, vi, _mm256_mul_ps(vg, gi))));
+        }
+        momentumStepScalar(w + i, g + i, v + i, n - i, momentum, vScale, gScale);
+    }
+    __attribute__((target("avx2,fma"))) static void adamStepAvx2(double* w, const double* g, double* m, double* v, const size_t& n, const adamConstants<double>& c) {
+        __m256d b1 = _mm256_set1_pd(c.beta1), a1 = _mm256_set1_pd(1.0 - c.beta1), b2 = _mm256_set1_pd(c.beta2), a2 = _mm256_set1_pd(1.0 - c.beta2);
+        __m256d step = _mm256_set1_pd(c.stepSize), c2 = _mm256_set1_pd(c.correction2), eps = _mm256_set1_pd(c.epsilon), keep = _mm256_set1_pd(c.keep);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256d gi = _mm256_loadu_pd(g + i);
+            __m256d mi = _mm256_fmadd_pd(b1, _mm256_loadu_pd(m + i), _mm256_mul_pd(a1, gi));
+            __m256d vi = _mm256_fmadd_pd(b2, _mm256_loadu_pd(v + i), _mm256_mul_pd(a2, _mm256_mul_pd(gi, gi)));
+            _mm256_storeu_pd(m + i, mi);
+            _mm256_storeu_pd(v + i, vi);
+            __m256d den = _mm256_add_pd(_mm256_sqrt_pd(_mm256_mul_pd(c2, vi)), eps);
+            _mm256_storeu_pd(w + i, _mm256_fmsub_pd(keep, _mm256_loadu_pd(w + i), _mm256_div_pd(_mm256_mul_pd(step, mi), den)));
+        }
+        adamStepScalar(w + i, g + i, m + i, v + i, n - i, c);
+    }
+    __attribute__((target("avx2,fma"))) static void adamStepAvx2(float* w, const float* g, float* m, float* v, const size_t& n, const adamConstants<float>& c) {
+        __m256 b1 = _mm256_set1_ps(c.beta1), a1 = _mm256_set1_ps(1.0f - c.beta1), b2 = _mm256_set1_ps(c.beta2), a2 = _mm256_set1_ps(1.0f - c.beta2);
+        __m256 step = _mm256_set1_ps(c.stepSize), c2 = _mm256_set1_ps(c.correction2), eps = _mm256_set1_ps(c.epsilon), keep = _mm256_set1_ps(c.keep);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256 gi = _mm256_loadu_ps(g + i);
+            __m256 mi = _mm256_fmadd_ps(b1, _mm256_loadu_ps(m + i), _mm256_mul_ps(a1, gi));
+            __m256 vi = _mm256_fmadd_ps(b2, _mm256_loadu_ps(v + i), _mm256_mul_ps(a2, _mm256_mul_ps(gi, gi)));
+            _mm256_storeu_ps(m + i, mi);
+            _mm256_storeu_ps(v + i, vi);
+            __m256 den = _mm256_add_ps(_mm256_sqrt_ps(_mm256_mul_ps(c2, vi)), eps);
+            _mm256_storeu_ps(w + i, _mm256_fmsub_ps(keep, _mm256_loadu_ps(w + i), _mm256_div_ps(_mm256_mul_ps(step, mi), den)));
+        }
+        adamStepScalar(w + i, g + i, m + i, v + i, n - i, c);
+    }
+
+    /* also used at the AVX-512 level - byte compares need AVX-512BW, which avx512f does not promise */
+    __attribute__((target("avx2"))) static void packOnesAvx2(const char* src, unsigned char* dst, const size_t& n) {
+        const __m256i one = _mm256_set1_epi8('1');
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            uint32_t bits = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(src + i)), one));
+            memcpy(dst + (i >> 3), &bits, 4);
+        }
+        packOnesScalar(src + i, dst + (i >> 3), n - i);
+    }
+
+    /*---------------------------------------------*/
+    /** AVX-512 - eight doubles / sixteen floats per register, masked tails **/
+    /*---------------------------------------------*/
+    /* GCC 12's avx512fintrin.h starts the pass-through operand of the reduce, max/min and scalef intrinsics as
+    *  "__Y = __Y", which -Wall reports as uninitialized once they are inlined here. The value is never read. */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+    __attribute__((target("avx512f"))) static double dotAvx512(const double* a, const double* b, const size_t& n) {
+        __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), acc0);
+            acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8), acc1);
+        }
+        for (; i < n; i += 8) {
+            __mmask8 mask = tailMask8(n - i);
+            acc0 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, a + i), _mm512_maskz_loadu_pd(mask, b + i), acc0);
+        }
+        return _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+    }
+    __attribute__((target("avx512f"))) static float dotAvx512(const float* a, const float* b, const size_t& n) {
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+            acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+        }
+        for (; i < n; i += 16) {
+            __mmask16 mask = tailMask16(n - i);
+            acc0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), acc0);
+        }
+        return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+    }
+    __attribute__((target("avx512f"))) static void axpyAvx512(const double& alpha, const double* x, double* y, const size_t& n) {
+        __m512d va = _mm512_set1_pd(alpha);
+        for (size_t i = 0; i < n; i += 8) {
+            __mmask8 mask = tailMask8(n - i);
+            __m512d vy = _mm512_maskz_loadu_pd(mask, y + i);
+            _mm512_mask_storeu_pd(y + i, mask, _mm512_fmadd_pd(va, _mm512_maskz_loadu_pd(mask, x + i), vy));
+        }
+    }
+    __attribute__((target("avx512f"))) static void axpyAvx512(const float& alpha, const float* x, float* y, const size_t& n) {
+        __m512 va = _mm512_set1_ps(alpha);
+        for (size_t i = 0; i < n; i += 16) {
+            __mmask16 mask = tailMask16(n - i);
+            __m512 vy = _mm512_maskz_loadu_ps(mask, y + i);
+            _mm512_mask_storeu_ps(y + i, mask, _mm512_fmadd_ps(va, _mm512_maskz_loadu_ps(mask, x + i), vy));
+        }
+    }
+    __attribute__((target("avx512f"))) static void axpyIntoAvx512(const double& alpha, const double* x, const double* y, double* out, const size_t& n) {
+        __m512d va = _mm512_set1_pd(alpha);
+        for (size_t i = 0; i < n; i += 8) {
+            __mmask8 mask = tailMask8(n - i);
+            __m512d vy = _mm512_maskz_loadu_pd(mask, y + i);
+            _mm512_mask_storeu_pd(out + i, mask, _mm512_fmadd_pd(va, _mm512_maskz_loadu_pd(mask, x + i), vy));
+        }
+    }
+    __attribute__((target("avx512f"))) static void axpyIntoAvx512(const float& alpha, const float* x, const float* y, float* out, const size_t& n) {
+        __m512 va = _mm512_set1_ps(alpha);
+        for (size_t i = 0; i < n; i += 16) {
+            __mmask16 mask = tailMask16(n - i);
+            __m512 vy = _mm512_maskz_loadu_ps(mask, y + i);
+            _mm512_mask_storeu_ps(out + i, mask, _mm512_fmadd_ps(va, _mm512_maskz_loadu_ps(mask, x + i), vy));
+        }
+    }
+    __attribute__((target("avx512f"))) static void rectifyAvx512(const double* s, double* y, const size_t& n, const double& slope) {
+        __m512d zero = _mm512_setzero_pd(), vs = _mm512_set1_pd(slope);
+        for (size_t i = 0; i < n; i += 8) {
+            __mmask8 mask = tailMask8(n - i);
+            __m512d v = _mm512_maskz_loadu_pd(mask, s + i);
+            _mm512_mask_storeu_pd(y + i, mask, _mm512_add_pd(_mm512_max_pd(v, zero), _mm512_mul_pd(vs, _mm512_min_pd(v, zero))));
+        }
+    }
+    __attribute__((target("avx512f"))) static void rectifyAvx512(const float* s, float* y, const size_t& n, const float& slope) {
+        __m512 zero = _mm512_setzero_ps(), vs = _mm512_set1_ps(slope);
+        for (size_t i = 0; i < n; i += 16) {
+            __mmask16 mask = tailMask16(n - i);
+            __m512 v = _mm512_maskz_loadu_ps(mask, s + i);
+            _mm512_mask_storeu_ps(y + i, mask, _mm512_add_ps(_mm512_max_ps(v, zero), _mm512_mul_ps(vs, _mm512_min_ps(v, zero))));
+        }
+    }
+    __attribute__((target("avx512f"))) static __m512d exponentialLanes(__m512d x) {
+        const __m512d round = _mm512_set1_pd(EXP_ROUND_64);
+        x = _mm512_min_pd(_mm512_max_pd(x, _mm512_set1_pd(EXP_MIN_64)), _mm512_set1_pd(EXP_MAX_64));
+        __m512d k = _mm512_sub_pd(_mm512_fmadd_pd(x, _mm512_set1_pd(EXP_LOG2E), round), round);
+        __m512d r = _mm512_fnmadd_pd(k, _mm512_set1_pd(EXP_LN2_LO), _mm512_fnmadd_pd(k, _mm512_set1_pd(EXP_LN2_HI), x));
+        __m512d p = _mm512_set1_pd(EXP_TAYLOR_64[0]);
+#pragma GCC unroll 16
+        for (int t = 1; t < EXP_TERMS_64; t++) {
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(EXP_TAYLOR_64[t]));
+        }
+        return _mm512_scalef_pd(p, k);
+    }
+    __attribute__((target("avx512f"))) static __m512 exponentialLanes(__m512 x) {
+        const __m512 round = _mm512_set1_ps(EXP_ROUND_32);
+        x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(EXP_MIN_32)), _mm512_set1_ps(EXP_MAX_32));
+        __m512 k = _mm512_sub_ps(_mm512_fmadd_ps(x, _mm512_set1_ps((float)EXP_LOG2E), round), round);
+        __m512 r = _mm512_fnmadd_ps(k, _mm512_set1_ps((float)EXP_LN2_LO), _mm512_fnmadd_ps(k, _mm512_set1_ps((float)EXP_LN2_HI), x));
+        __m512 p = _mm512_set1_ps(EXP_TAYLOR_32[0]);
+#pragma GCC unroll 16
+        for (int t = 1; t < EXP_TERMS_32; t++) {
+            p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_TAYLOR_32[t]));
+        }
+        return _mm512_scalef_ps(p, k);
+    }
+    __attribute__((target("avx512f"))) static __m512d logisticLanes(__m512d x) {
+        const __m512d one = _mm512_set1_pd(1.0);
+        return _mm512_div_pd(one, _mm512_add_pd(one, exponentialLanes(_mm512_sub_pd(_mm512_setzero_pd(), x))));
+    }
+    __attribute__((target("avx512f"))) static __m512 logisticLanes(__m512 x) {
+        const __m512 one = _mm512_set1_ps(1.0f);
+        return _mm512_div_ps(one, _mm512_add_ps(one, exponentialLanes(_mm512_sub_ps(_mm512_setzero_ps(), x))));
+    }
+    template<__m512d (*LANES)(__m512d)>
+    __attribute__((target("avx512f"))) static void mapAvx512(const double* x, double* out, const size_t& n) {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m512d a = LANES(_mm512_loadu_pd(x + i));
+            __m512d b = LANES(_mm512_loadu_pd(x + i + 8));
+            _mm512_storeu_pd(out + i, a);
+            _mm512_storeu_pd(out + i + 8, b);
+        }
+        for (; i < n; i += 8) {
+            __mmask8 mask = tailMask8(n - i);
+            _mm512_mask_storeu_pd(out + i, mask, LANES(_mm512_maskz_loadu_pd(mask, x + i)));
+        }
+    }
+    template<__m512 (*LANES)(__m512)>
+    __attribute__((target("avx512f"))) static void mapAvx512(const float* x, float* out, const size_t& n) {
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            __m512 a = LANES(_mm512_loadu_ps(x + i));
+            __m512 b = LANES(_mm512_loadu_ps(x + i + 16));
+            _mm512_storeu_ps(out + i, a);
+            _mm512_storeu_ps(out + i + 16, b);
+        }
+        for (; i < n; i += 16) {
+            __mmask16 mask = tailMask16(n - i);
+            _mm512_mask_storeu_ps(out + i, mask, LANES(_mm512_maskz_loadu_ps(mask, x + i)));
+        }
+    }
+    __attribute__((target("avx512f"))) static void exponentialAvx512(const double* x, double* out, const size_t& n) { mapAvx512<exponentialLanes>(x, out, n); }
+    __attribute__((target("avx512f"))) static void exponentialAvx512(const float* x, float* out, const size_t& n) { mapAvx512<exponentialLanes>(x, out, n); }
+    __attribute__((target("avx512f"))) static void logisticAvx512(const double* x, double* out, const size_t& n) { mapAvx512<logisticLanes>(x, out, n); }
+    __attribute__((target("avx512f"))) static void logisticAvx512(const float* x, float* out, const size_t& n) { mapAvx512<logisticLanes>(x, out, n); }
+    __attribute__((target("avx512f"))) static void momentumStepAvx512(double* w, const double* g, double* v, const size_t& n, const double& momentum, const double& vScale, const double& gScale) {
+        __m512d vm = _mm512_set1_pd(momentum), vv = _mm512_set1_pd(vScale), vg = _mm512_set1_pd(gScale);
+        for (size_t i = 0; i < n; i += 8) {
+            __mmask8 mask = tailMask8(n - i);
+            __m512d gi = _mm512_maskz_loadu_pd(mask, g + i);
+            __m512d vi = _mm512_fmadd_pd(vm, _mm512_maskz_loadu_pd(mask, v + i), gi);
+            _mm512_mask_storeu_pd(v + i, mask, vi);
+            _mm512_mask_storeu_pd(w + i, mask, _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, w + i), _mm512_fmadd_pd(vv, vi, _mm512_mul_pd(vg, gi))));
+        }
+    }
+    __attribute__((target("avx512f"))) static void momentumStepAvx512(float* w, const float* g, float* v, const size_t& n, const float& momentum, const float& vScale, const float& gScale) {
+        __m512 vm = _mm512_set1_ps(momentum), vv = _mm512_set1_ps(vScale), vg = _mm512_set1_ps(gScale);
+        for (size_t i = 0; i < n; i += 16) {
+            __mmask16 mask = tailMask16(n - i);
+            __m512 gi = _mm512_maskz_loadu_ps(mask, g + i);
+            __m512 vi = _mm512_fmadd_ps(vm, _mm512_maskz_loadu_ps(mask, v + i), gi);
+            _mm512_mask_storeu_ps(v + i, mask, vi);
+            _mm512_mask_storeu_ps(w + i, mask, _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, w + i), _mm512_fmadd_ps(vv, vi, _mm512_mul_ps(vg, gi))));
+        }
+    }
+    __attribute__((target("avx512f"))) static void adamStepAvx512(double* w, const double* g, double* m, double* v, const size_t& n, const adamConstants<double>& c) {
+        __m512d b1 = _mm512_set1_pd(c.beta1), a1 = _mm512_set1_pd(1.0 - c.beta1), b2 = _mm512_set1_pd(c.beta2), a2 = _mm512_set1_pd(1.0 - c.beta2);
+        __m512d step = _mm512_set1_pd(c.stepSize), c2 = _mm512_set1_pd(c.correction2), eps = _mm512_set1_pd(c.epsilon), keep = _mm512_set1_pd(c.keep);
+        for (size_t i = 0; i < n; i += 8) {
+            __mmask8 mask = tailMask8(n - i);
+            __m512d gi = _mm512_maskz_loadu_pd(mask, g + i);
+            __m512d mi = _mm512_fmadd_pd(b1, _mm512_maskz_loadu_pd(mask, m + i), _mm512_mul_pd(a1, gi));
+            __m512d vi = _mm512_fmadd_pd(b2, _mm512_maskz_loadu_pd(mask, v + i), _mm512_mul_pd(a2, _mm512_mul_pd(gi, gi)));
+            _mm512_mask_storeu_pd(m + i, mask, mi);
+            _mm512_mask_storeu_pd(v + i, mask, vi);
+            __m512d den = _mm512_add_pd(_mm512_sqrt_pd(_mm512_mul_pd(c2, vi)), eps);
+            _mm512_mask_storeu_pd(w + i, mask, _mm512_fmsub_pd(keep, _mm512_maskz_loadu_pd(mask, w + i), _mm512_div_pd(_mm512_mul_pd(step, mi), den)));
+        }
+    }
+    __attribute__((target("avx512f"))) static void adamStepAvx512(float* w, const float* g, float* m, float* v, const size_t& n, const adamConstants<float>& c) {
+        __m512 b1 = _mm512_set1_ps(c.beta1), a1 = _mm512_set1_ps(1.0f - c.beta1), b2 = _mm512_set1_ps(c.beta2), a2 = _mm512_set1_ps(1.0f - c.beta2);
+        __m512 step = _mm512_set1_ps(c.stepSize), c2 = _mm512_set1_ps(c.correction2), eps = _mm512_set1_ps(c.epsilon), keep = _mm512_set1_ps(c.keep);
+        for (size_t i = 0; i < n; i += 16) {
+            __mmask16 mask = tailMask16(n - i);
+            __m512 gi = _mm512_maskz_loadu_ps(mask, g + i);
+            __m512 mi = _mm512_fmadd_ps(b1, _mm512_maskz_loadu_ps(mask, m + i), _mm512_mul_ps(a1, gi));
+            __m512 vi = _mm512_fmadd_ps(b2, _mm512_maskz_loadu_ps(mask, v + i), _mm512_mul_ps(a2, _mm512_mul_ps(gi, gi)));
+            _mm512_mask_storeu_ps(m + i, mask, mi);
+            _mm512_mask_storeu_ps(v + i, mask, vi);
+            __m512 den = _mm512_add_ps(_mm512_sqrt_ps(_mm512_mul_ps(c2, vi)), eps);
+            _mm512_mask_storeu_ps(w + i, mask, _mm512_fmsub_ps(keep, _mm512_maskz_loadu_ps(mask, w + i), _mm512_div_ps(_mm512_mul_ps(step, mi), den)));
+        }
+    }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+};
+/************************************************************
+* ///////////////////////////|\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\
+* \\\\\\\\\\\\\\\\\\\\\\\\\\\|///////////////////////////////
+************************************************************/
+
+/* Static members - the scalar kernels until level is set up below */
+inline double (*SimdKernels::dot64)(const double*, const double*, const size_t&) = SimdKernels::dotScalar<double>;
+inline float (*SimdKernels::dot32)(const float*, const float*, const size_t&) = SimdKernels::dotScalar<float>;
+inline void (*SimdKernels::axpy64)(const double&, const double*, double*, const size_t&) = SimdKernels::axpyScalar<double>;
+inline void (*SimdKernels::axpy32)(const float&, const float*, float*, const size_t&) = SimdKernels::axpyScalar<float>;
+inline void (*SimdKernels::axpyInto64)(const double&, const double*, const double*, double*, const size_t&) = SimdKernels::axpyIntoScalar<double>;
+inline void (*SimdKernels::axpyInto32)(const float&, const float*, const float*, float*, const size_t&) = SimdKernels::axpyIntoScalar<float>;
+inline void (*SimdKernels::rectify64)(const double*, double*, const size_t&, const double&) = SimdKernels::rectifyScalar<double>;
+inline void (*SimdKernels::rectify32)(const float*, float*, const size_t&, const float&) = SimdKernels::rectifyScalar<float>;
+inline void (*SimdKernels::exponential64)(const double*, double*, const size_t&) = SimdKernels::exponentialScalar<double>;
+inline void (*SimdKernels::exponential32)(const float*, float*, const size_t&) = SimdKernels::exponentialScalar<float>;
+inline void (*SimdKernels::logistic64)(const double*, double*, const size_t&) = SimdKernels::logisticScalar<double>;
+inline void (*SimdKernels::logistic32)(const float*, float*, const size_t&) = SimdKernels::logisticScalar<float>;
+inline void (*SimdKernels::momentumStep64)(double*, const double*, double*, const size_t&, const double&, const double&, const double&) = SimdKernels::momentumStepScalar<double>;
+inline void (*SimdKernels::momentumStep32)(float*, const float*, float*, const size_t&, const float&, const float&, const float&) = SimdKernels::momentumStepScalar<float>;
+inline void (*SimdKernels::adamStep64)(double*, const double*, double*, double*, const size_t&, const adamConstants<double>&) = SimdKernels::adamStepScalar<double>;
+inline void (*SimdKernels::adamStep32)(float*, const float*, float*, float*, const size_t&, const adamConstants<float>&) = SimdKernels::adamStepScalar<float>;
+inline void (*SimdKernels::packOnes8)(const char*, unsigned char*, const size_t&) = SimdKernels::packOnesScalar;
+inline simdLevel SimdKernels::level = SimdKernels::use(SimdKernels::detect());
+
+/******************************************************************************
+ * detect
+-------------------------------------------------------------------------------
+ * CPUID (through the compiler's cpu builtins, which also check that the OS
+ * saves the wide registers) for the best level this machine can run
+*******************************************************************************/
+inline simdLevel SimdKernels::detect() {
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SIMD_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SIMD_SSE2;
+    }
+#endif
+    return SIMD_SCALAR;
+}
+
+/******************************************************************************
+ * use
+-------------------------------------------------------------------------------
+ * point every kernel at the variant for level, never above what detect()
+ * found
+*******************************************************************************/
+inline simdLevel SimdKernels::use(const simdLevel& requested) {
+    simdLevel best = detect();
+    simdLevel chosen = (requested < best) ? requested : best;
+
+    dot64 = dotScalar<double>;
+    dot32 = dotScalar<float>;
+    axpy64 = axpyScalar<double>;
+    axpy32 = axpyScalar<float>;
+    axpyInto64 = axpyIntoScalar<double>;
+    axpyInto32 = axpyIntoScalar<float>;
+    rectify64 = rectifyScalar<double>;
+    rectify32 = rectifyScalar<float>;
+    exponential64 = exponentialScalar<double>;
+    exponential32 = exponentialScalar<float>;
+    logistic64 = logisticScalar<double>;
+    logistic32 = logisticScalar<float>;
+    momentumStep64 = momentumStepScalar<double>;
+    momentumStep32 = momentumStepScalar<float>;
+    adamStep64 = adamStepScalar<double>;
+    adamStep32 = adamStepScalar<float>;
+    packOnes8 = packOnesScalar;
+#ifdef SIMD_X86
+    switch (chosen) {
+        case(SIMD_SSE2): {
+            dot64 = dotSse2; dot32 = dotSse2;
+            axpy64 = axpySse2; axpy32 = axpySse2;
+            axpyInto64 = axpyIntoSse2; axpyInto32 = axpyIntoSse2;
+            rectify64 = rectifySse2; rectify32 = rectifySse2;
+            exponential64 = exponentialSse2; exponential32 = exponentialSse2;
+            logistic64 = logisticSse2; logistic32 = logisticSse2;
+            momentumStep64 = momentumStepSse2; momentumStep32 = momentumStepSse2;
+            adamStep64 = adamStepSse2; adamStep32 = adamStepSse2;
+            packOnes8 = packOnesSse2;
+            break;
+        }
+        case(SIMD_AVX2): {
+            dot64 = dotAvx2; dot32 = dotAvx2;
+            axpy64 = axpyAvx2; axpy32 = axpyAvx2;
+            axpyInto64 = axpyIntoAvx2; axpyInto32 = axpyIntoAvx2;
+            rectify64 = rectifyAvx2; rectify32 = rectifyAvx2;
+            exponential64 = exponentialAvx2; exponential32 = exponentialAvx2;
+            logistic64 = logisticAvx2; logistic32 = logisticAvx2;
+            momentumStep64 = momentumStepAvx2; momentumStep32 = momentumStepAvx2;
+            adamStep64 = adamStepAvx2; adamStep32 = adamStepAvx2;
+            packOnes8 = packOnesAvx2;
+            break;
+        }
+        case(SIMD_AVX512): {
+            dot64 = dotAvx512; dot32 = dotAvx512;
+            axpy64 = axpyAvx512; axpy32 = axpyAvx512;
+            axpyInto64 = axpyIntoAvx512; axpyInto32 = axpyIntoAvx512;
+            rectify64 = rectifyAvx512; rectify32 = rectifyAvx512;
+            exponential64 = exponentialAvx512; exponential32 = exponentialAvx512;
+            logistic64 = logisticAvx512; logistic32 = logisticAvx512;
+            momentumStep64 = momentumStepAvx512; momentumStep32 = momentumStepAvx512;
+            adamStep64 = adamStepAvx512; adamStep32 = adamStepAvx512;
+            packOnes8 = packOnesAvx2;
+            break;
+        }
+        default: { break; }
+    }
+#endif
+    level = chosen;
+    return chosen;
+}